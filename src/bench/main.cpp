@@ -0,0 +1,401 @@
+// gvox-editor-bench: headless benchmarks for the core scene code. Builds
+// without GLFW or Daxa so it can run on GPU-less CI machines. Results are
+// written as JSON (to stdout, or to --output) so runs can be diffed between
+// releases, and progress goes to stderr.
+//
+//   gvox-editor-bench [--size N] [--iterations N] [--image-size N] [--image out.ppm]
+//                     [--tree-size N] [--strokes N] [--output results.json]
+
+#include <core/brick_map.hpp>
+#include <core/edit_history.hpp>
+#include <core/mesher.hpp>
+#include <core/parallel_fill.hpp>
+#include <core/scene.hpp>
+#include <core/scene_loader.hpp>
+#include <core/scene_writer.hpp>
+#include <core/thread_pool.hpp>
+#include <core/tree64.hpp>
+#include <renderer/cpu_renderer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchConfig {
+        int32_t size = 256;
+        int32_t iterations = 3;
+        uint32_t image_size = 512;
+        std::string_view image_path{};
+        int32_t tree_size = 1024;
+        int32_t stroke_count = 10000;
+        std::string_view output_path{};
+    };
+
+    struct BenchResult {
+        std::string name;
+        double value;
+        char const *unit;
+    };
+
+    // Flat list of named metrics. Names are slash-separated paths like
+    // "fill/random_batch/parallel", which keeps the JSON easy to diff.
+    struct BenchReport {
+        std::vector<BenchResult> results{};
+
+        void add(std::string name, double value, char const *unit) {
+            std::fprintf(stderr, "  %-40s %14.4f %s\n", name.c_str(), value, unit);
+            results.push_back({std::move(name), value, unit});
+        }
+
+        void write_json(std::FILE *file, BenchConfig const &config, size_t thread_count) const {
+            std::fprintf(file, "{\n");
+            std::fprintf(file, "  \"benchmark\": \"gvox-editor-bench\",\n");
+            std::fprintf(file, "  \"config\": {\"size\": %d, \"iterations\": %d, \"image_size\": %u, \"tree_size\": %d, \"strokes\": %d, \"threads\": %zu},\n",
+                         config.size, config.iterations, config.image_size, config.tree_size, config.stroke_count, thread_count);
+            std::fprintf(file, "  \"results\": [\n");
+            for (size_t i = 0; i < results.size(); ++i) {
+                auto const &result = results[i];
+                std::fprintf(file, "    {\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\"}%s\n",
+                             result.name.c_str(), result.value, result.unit, i + 1 < results.size() ? "," : "");
+            }
+            std::fprintf(file, "  ]\n}\n");
+        }
+    };
+
+    struct Scenario {
+        char const *name;
+        std::vector<FillCommand> commands;
+    };
+
+    auto voxel_count(std::span<FillCommand const> commands) -> double {
+        auto result = 0.0;
+        for (auto const &command : commands) {
+            result += static_cast<double>(command.box.extent[0]) * static_cast<double>(command.box.extent[1]) * static_cast<double>(command.box.extent[2]);
+        }
+        return result;
+    }
+
+    auto make_scenarios(int32_t size) -> std::vector<Scenario> {
+        auto result = std::vector<Scenario>{};
+        result.push_back({"aligned_box", {{.value = 1, .box = {.offset = {0, 0, 0}, .extent = {size, size, size}}}}});
+        result.push_back({"unaligned_box", {{.value = 1, .box = {.offset = {3, 5, 7}, .extent = {size - 11, size - 13, size - 15}}}}});
+
+        // Many small overlapping edits, like a brush stroke or a paste.
+        auto rng = std::mt19937{1234};
+        auto pos_dist = std::uniform_int_distribution<int32_t>{0, size - 1};
+        auto extent_dist = std::uniform_int_distribution<int32_t>{1, 32};
+        auto batch = Scenario{"random_batch", {}};
+        for (size_t i = 0; i < 4096; ++i) {
+            batch.commands.push_back({
+                .value = static_cast<uint32_t>(i + 1),
+                .box = {
+                    .offset = {pos_dist(rng), pos_dist(rng), pos_dist(rng)},
+                    .extent = {extent_dist(rng), extent_dist(rng), extent_dist(rng)},
+                },
+            });
+        }
+        result.push_back(std::move(batch));
+        return result;
+    }
+
+    // Rolling hills, one column per 4x4 voxels, for a surface-heavy scene.
+    // Columns get one of a few colors by height.
+    auto make_terrain(int32_t size) -> std::vector<FillCommand> {
+        constexpr auto COLORS = std::array<uint32_t, 4>{0x2f5f2f, 0x3f7f3f, 0x5f8f4f, 0x9f9f8f};
+        auto result = std::vector<FillCommand>{};
+        for (int32_t y = 0; y < size; y += 4) {
+            for (int32_t x = 0; x < size; x += 4) {
+                auto const fx = static_cast<float>(x) / static_cast<float>(size);
+                auto const fy = static_cast<float>(y) / static_cast<float>(size);
+                auto const height = static_cast<int32_t>((0.3f + 0.1f * std::sin(fx * 17.0f) + 0.1f * std::cos(fy * 13.0f)) * static_cast<float>(size));
+                auto const color = COLORS[static_cast<size_t>(height * 4 / std::max(size / 2, 1)) % COLORS.size()];
+                result.push_back({.value = color, .box = {.offset = {x, y, 0}, .extent = {4, 4, height}}});
+            }
+        }
+        return result;
+    }
+
+    struct LatencyStats {
+        double total_ms{};
+        double max_ms{};
+        size_t count{};
+
+        void add(Clock::time_point start) {
+            auto const ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            total_ms += ms;
+            max_ms = std::max(max_ms, ms);
+            ++count;
+        }
+        auto average_ms() const -> double { return count != 0 ? total_ms / static_cast<double>(count) : 0.0; }
+    };
+
+    template <typename FuncT>
+    auto time_best_of(int32_t iterations, FuncT &&func) -> double {
+        auto best = std::numeric_limits<double>::max();
+        for (int32_t i = 0; i < iterations; ++i) {
+            auto const start = Clock::now();
+            func();
+            auto const elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            best = std::min(best, elapsed);
+        }
+        return best;
+    }
+
+    auto brick_map_voxel_count(BrickMap const &brick_map) -> double {
+        return static_cast<double>(brick_map.stats().occupied_voxel_count);
+    }
+
+    void bench_container(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        // Voxel desc + gvox container creation plus the default scene's fills.
+        auto const seconds = time_best_of(config.iterations, [&]() {
+            auto scene = VoxelScene{thread_pool};
+        });
+        report.add("container/create_scene", seconds * 1e3, "ms");
+    }
+
+    void bench_fill(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        for (auto const &scenario : make_scenarios(config.size)) {
+            // The serial path is what a `gvox_fill` into the scene container
+            // ends up calling for each fill.
+            auto const serial_seconds = time_best_of(config.iterations, [&]() {
+                auto brick_map = BrickMap{};
+                for (auto const &command : scenario.commands) {
+                    brick_map.fill(command.value, command.box);
+                }
+            });
+            auto const parallel_seconds = time_best_of(config.iterations, [&]() {
+                auto brick_map = BrickMap{};
+                parallel_fill(thread_pool, brick_map, scenario.commands);
+            });
+            auto const voxels = voxel_count(scenario.commands);
+            auto const prefix = std::string{"fill/"} + scenario.name;
+            report.add(prefix + "/serial", voxels / serial_seconds * 1e-6, "Mvox/s");
+            report.add(prefix + "/parallel", voxels / parallel_seconds * 1e-6, "Mvox/s");
+        }
+    }
+
+    void bench_save_load(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        auto scene = BrickMap{};
+        parallel_fill(thread_pool, scene, make_terrain(config.size));
+        auto const voxels = brick_map_voxel_count(scene);
+        auto const path = std::filesystem::temp_directory_path() / "gvox-editor-bench.vox";
+
+        auto error = std::string{};
+        auto const save_seconds = time_best_of(config.iterations, [&]() {
+            error = save_vox(scene, path);
+        });
+        if (!error.empty()) {
+            std::fprintf(stderr, "save failed: %s\n", error.c_str());
+            return;
+        }
+        report.add("save/vox", voxels / save_seconds * 1e-6, "Mvox/s");
+        report.add("save/vox_file_size", static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0), "MiB");
+
+        auto loaded = BrickMap{};
+        auto const load_seconds = time_best_of(config.iterations, [&]() {
+            loaded = {};
+            auto loader = SceneLoader{path};
+            while (!loader.is_finished()) {
+                auto chunk = loader.poll();
+                if (!chunk) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (auto &[coord, brick] : chunk->bricks) {
+                    loaded.overlay(coord, std::move(brick));
+                }
+            }
+        });
+        report.add("load/vox", voxels / load_seconds * 1e-6, "Mvox/s");
+        report.add("load/vox_roundtrip_match", brick_map_voxel_count(loaded) == voxels ? 1.0 : 0.0, "bool");
+        std::filesystem::remove(path);
+    }
+
+    void bench_traversal(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        // Trace the random batch scene from the default editor camera.
+        auto scene = BrickMap{};
+        parallel_fill(thread_pool, scene, make_scenarios(config.size).back().commands);
+        auto camera = Camera{};
+        auto const center = static_cast<float>(config.size) * 0.5f;
+        auto const distance = static_cast<float>(config.size) * 1.6f;
+        camera.position = {center - std::cos(camera.yaw) * distance, center - std::sin(camera.yaw) * distance, center + static_cast<float>(config.size) * 0.7f};
+        auto renderer = CpuRenderer{thread_pool};
+        auto scene_tree = Tree64{};
+        scene_tree.build(thread_pool, scene);
+        for (auto use_packets : {false, true}) {
+            renderer.use_packets = use_packets;
+            auto images = std::array<CpuImage, 2>{};
+            for (auto use_tree : {false, true}) {
+                auto &image = images[use_tree ? 1 : 0];
+                image = {.width = config.image_size, .height = config.image_size};
+                auto best = CpuRenderStats{.seconds = std::numeric_limits<double>::max()};
+                for (int32_t i = 0; i < config.iterations; ++i) {
+                    auto const stats = renderer.render(scene, camera, image, use_tree ? &scene_tree : nullptr);
+                    best = stats.seconds < best.seconds ? stats : best;
+                }
+                auto const name = std::string{"traversal/"} + (use_packets ? "packet" : "scalar") + (use_tree ? "_tree64" : "");
+                report.add(name, best.rays_per_second() * 1e-6, "Mray/s");
+            }
+            // Skipping empty nodes must not change what the rays hit.
+            report.add(std::string{"traversal/"} + (use_packets ? "packet" : "scalar") + "_tree64_match", images[0].pixels == images[1].pixels ? 1.0 : 0.0, "bool");
+            if (use_packets && !config.image_path.empty() && !images[0].save_ppm(config.image_path)) {
+                std::fprintf(stderr, "failed to write %.*s\n", static_cast<int>(config.image_path.size()), config.image_path.data());
+            }
+        }
+
+        for (auto const &[name, commands] : {Scenario{"terrain", make_terrain(config.tree_size)}, make_scenarios(config.tree_size).back()}) {
+            auto brick_map = BrickMap{};
+            parallel_fill(thread_pool, brick_map, commands);
+            auto tree = Tree64{};
+            auto best_ms = std::numeric_limits<double>::max();
+            for (int32_t i = 0; i < config.iterations; ++i) {
+                tree.build(thread_pool, brick_map);
+                best_ms = std::min(best_ms, tree.stats.build_milliseconds);
+            }
+            auto const prefix = std::string{"tree64/"} + name;
+            report.add(prefix + "/build", best_ms, "ms");
+            report.add(prefix + "/nodes", static_cast<double>(tree.stats.node_count), "count");
+            report.add(prefix + "/node_bytes_per_voxel", static_cast<double>(tree.stats.memory_bytes) / brick_map_voxel_count(brick_map), "B/voxel");
+
+            // A brush-sized edit followed by a refit, as the editor's
+            // background tree job does after an edit.
+            brick_map.dirty_bricks.clear();
+            auto const edit_center = config.tree_size / 2;
+            brick_map.fill(0, {.offset = {edit_center - 16, edit_center - 16, 0}, .extent = {32, 32, config.tree_size}});
+            auto const changed = brick_map.drain_dirty_bricks(std::numeric_limits<size_t>::max());
+            auto const refit_start = Clock::now();
+            tree.refit(thread_pool, brick_map, changed);
+            report.add(prefix + "/refit", std::chrono::duration<double, std::milli>(Clock::now() - refit_start).count(), "ms");
+        }
+    }
+
+    void bench_meshing(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        auto scene = BrickMap{};
+        parallel_fill(thread_pool, scene, make_terrain(config.size));
+        auto face_count = size_t{};
+        auto const seconds = time_best_of(config.iterations, [&]() {
+            face_count = mesh_brick_map(thread_pool, scene).faces.size();
+        });
+        report.add("meshing/terrain", brick_map_voxel_count(scene) / seconds * 1e-6, "Mvox/s");
+        report.add("meshing/terrain_faces", static_cast<double>(face_count), "count");
+    }
+
+    // A long editing session: brush strokes that wander over the terrain,
+    // each a handful of small paint or erase boxes, then undo and redo all.
+    void bench_edit_history(BenchReport &report, ThreadPool &thread_pool, BenchConfig const &config) {
+        auto brick_map = BrickMap{};
+        parallel_fill(thread_pool, brick_map, make_terrain(config.size));
+        auto history = EditHistory{};
+        auto rng = std::mt19937{42};
+        auto step_dist = std::uniform_int_distribution<int32_t>{-6, 6};
+        auto extent_dist = std::uniform_int_distribution<int32_t>{2, 12};
+        auto position = std::array{config.size / 2, config.size / 2, config.size / 3};
+        auto record_latency = LatencyStats{};
+        auto stroke = std::vector<FillCommand>{};
+        for (int32_t i = 0; i < config.stroke_count; ++i) {
+            stroke.clear();
+            auto const value = (i % 3) == 0 ? 0u : static_cast<uint32_t>(i + 1);
+            for (size_t j = 0; j < 8; ++j) {
+                for (auto &p : position) {
+                    p = std::clamp(p + step_dist(rng), 0, config.size - 1);
+                }
+                stroke.push_back({.value = value, .box = {.offset = position, .extent = {extent_dist(rng), extent_dist(rng), extent_dist(rng)}}});
+            }
+            auto const start = Clock::now();
+            history.begin_edit(brick_map, stroke);
+            parallel_fill(thread_pool, brick_map, stroke);
+            history.end_edit(brick_map);
+            record_latency.add(start);
+        }
+        auto const journal_stats = history.stats();
+        auto undo_latency = LatencyStats{};
+        for (auto start = Clock::now(); history.undo(brick_map); start = Clock::now()) {
+            undo_latency.add(start);
+        }
+        auto redo_latency = LatencyStats{};
+        for (auto start = Clock::now(); history.redo(brick_map); start = Clock::now()) {
+            redo_latency.add(start);
+        }
+        report.add("history/journal_memory", static_cast<double>(journal_stats.memory_bytes) / (1024.0 * 1024.0), "MiB");
+        report.add("history/edits_kept", static_cast<double>(journal_stats.undo_count), "count");
+        report.add("history/edits_evicted", static_cast<double>(journal_stats.evicted_count), "count");
+        report.add("history/edit_avg", record_latency.average_ms(), "ms");
+        report.add("history/edit_max", record_latency.max_ms, "ms");
+        report.add("history/undo_avg", undo_latency.average_ms(), "ms");
+        report.add("history/undo_max", undo_latency.max_ms, "ms");
+        report.add("history/redo_avg", redo_latency.average_ms(), "ms");
+        report.add("history/redo_max", redo_latency.max_ms, "ms");
+    }
+
+    void print_usage() {
+        std::fprintf(stderr,
+                     "usage: gvox-editor-bench [--size N] [--iterations N] [--image-size N] [--image out.ppm]\n"
+                     "                         [--tree-size N] [--strokes N] [--output results.json]\n");
+    }
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    auto config = BenchConfig{};
+    for (int i = 1; i < argc; i += 2) {
+        auto const arg = std::string_view{argv[i]};
+        if (i + 1 == argc) {
+            std::fprintf(stderr, "missing value for %s\n", argv[i]);
+            print_usage();
+            return 1;
+        }
+        if (arg == "--size") {
+            config.size = std::atoi(argv[i + 1]);
+        } else if (arg == "--iterations") {
+            config.iterations = std::atoi(argv[i + 1]);
+        } else if (arg == "--image-size") {
+            config.image_size = static_cast<uint32_t>(std::atoi(argv[i + 1]));
+        } else if (arg == "--image") {
+            config.image_path = argv[i + 1];
+        } else if (arg == "--tree-size") {
+            config.tree_size = std::atoi(argv[i + 1]);
+        } else if (arg == "--strokes") {
+            config.stroke_count = std::atoi(argv[i + 1]);
+        } else if (arg == "--output") {
+            config.output_path = argv[i + 1];
+        } else {
+            std::fprintf(stderr, "unknown argument %s\n", argv[i]);
+            print_usage();
+            return 1;
+        }
+    }
+
+    auto thread_pool = ThreadPool{};
+    std::fprintf(stderr, "gvox-editor-bench: %d^3, %zu threads, best of %d\n", config.size, thread_pool.thread_count(), config.iterations);
+    auto report = BenchReport{};
+    bench_container(report, thread_pool, config);
+    bench_fill(report, thread_pool, config);
+    bench_save_load(report, thread_pool, config);
+    bench_traversal(report, thread_pool, config);
+    bench_meshing(report, thread_pool, config);
+    bench_edit_history(report, thread_pool, config);
+
+    auto *output = stdout;
+    if (!config.output_path.empty()) {
+        output = std::fopen(std::string{config.output_path}.c_str(), "w");
+        if (output == nullptr) {
+            std::fprintf(stderr, "failed to open %.*s\n", static_cast<int>(config.output_path.size()), config.output_path.data());
+            return 1;
+        }
+    }
+    report.write_json(output, config, thread_pool.thread_count());
+    if (output != stdout) {
+        std::fclose(output);
+    }
+}
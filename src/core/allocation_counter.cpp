@@ -0,0 +1,78 @@
+#include <core/allocation_counter.hpp>
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local uint64_t allocation_count = 0;
+} // namespace
+
+auto thread_allocation_count() -> uint64_t {
+    return allocation_count;
+}
+
+#if GVOX_EDITOR_COUNT_ALLOCATIONS
+
+namespace {
+    auto counted_allocate(std::size_t size) -> void * {
+        ++allocation_count;
+        return std::malloc(size != 0 ? size : 1);
+    }
+    auto counted_allocate_aligned(std::size_t size, std::align_val_t alignment) -> void * {
+        ++allocation_count;
+        auto const align = static_cast<std::size_t>(alignment);
+        return std::aligned_alloc(align, (size + align - 1) / align * align);
+    }
+} // namespace
+
+auto operator new(std::size_t size) -> void * {
+    if (auto *result = counted_allocate(size)) {
+        return result;
+    }
+    throw std::bad_alloc{};
+}
+auto operator new[](std::size_t size) -> void * {
+    return operator new(size);
+}
+auto operator new(std::size_t size, std::nothrow_t const &) noexcept -> void * {
+    return counted_allocate(size);
+}
+auto operator new[](std::size_t size, std::nothrow_t const &) noexcept -> void * {
+    return counted_allocate(size);
+}
+auto operator new(std::size_t size, std::align_val_t alignment) -> void * {
+    if (auto *result = counted_allocate_aligned(size, alignment)) {
+        return result;
+    }
+    throw std::bad_alloc{};
+}
+auto operator new[](std::size_t size, std::align_val_t alignment) -> void * {
+    return operator new(size, alignment);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#if !defined(GVOX_EDITOR_COUNT_ALLOCATIONS)
+#define GVOX_EDITOR_COUNT_ALLOCATIONS 0
+#endif
+
+// Heap allocations made on the calling thread so far. Only counts when the
+// build replaces the global allocation functions
+// (GVOX_EDITOR_COUNT_ALLOCATIONS), and is always 0 otherwise.
+auto thread_allocation_count() -> uint64_t;
+
+inline constexpr bool ALLOCATION_COUNTING_ENABLED = GVOX_EDITOR_COUNT_ALLOCATIONS != 0;
+
+// Adds the allocations made on this thread while it is alive to `total`.
+struct AllocationScope {
+    uint64_t &total;
+    uint64_t start = thread_allocation_count();
+
+    explicit AllocationScope(uint64_t &a_total) : total{a_total} {}
+    ~AllocationScope() { total += thread_allocation_count() - start; }
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope(AllocationScope &&) = delete;
+    auto operator=(const AllocationScope &) -> AllocationScope & = delete;
+    auto operator=(AllocationScope &&) -> AllocationScope & = delete;
+};
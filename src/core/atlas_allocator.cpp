@@ -0,0 +1,64 @@
+#include <core/atlas_allocator.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+AtlasAllocator::AtlasAllocator(uint32_t a_width, uint32_t a_height)
+    : width{a_width},
+      height{a_height} {
+}
+
+auto AtlasAllocator::allocate(uint32_t rect_width, uint32_t rect_height) -> std::optional<AtlasRect> {
+    if (rect_width == 0 || rect_height == 0 || rect_width > width || rect_height > height) {
+        return std::nullopt;
+    }
+    auto const shelf_height = (rect_height + SHELF_HEIGHT_GRANULARITY - 1) / SHELF_HEIGHT_GRANULARITY * SHELF_HEIGHT_GRANULARITY;
+
+    // The shortest shelf that fits without wasting more than half its
+    // height. Empty shelves take any height, there is nothing to waste yet.
+    auto *best = static_cast<Shelf *>(nullptr);
+    for (auto &shelf : shelves) {
+        auto const fits = shelf.height >= shelf_height && (shelf.entry_count == 0 || shelf.height <= shelf_height + shelf_height / 2);
+        if (!fits || (best != nullptr && shelf.height >= best->height)) {
+            continue;
+        }
+        if (shelf.columns.capacity() - shelf.columns.used() >= rect_width) {
+            best = &shelf;
+        }
+    }
+    if (best != nullptr) {
+        if (auto x = best->columns.allocate(rect_width)) {
+            ++best->entry_count;
+            return AtlasRect{.x = *x, .y = best->y, .width = rect_width, .height = rect_height};
+        }
+    }
+    // Free space on the best shelf may be too fragmented, so fall back to a
+    // new shelf before giving up.
+    if (shelf_top + shelf_height > height) {
+        for (auto &shelf : shelves) {
+            if (shelf.height >= shelf_height && &shelf != best) {
+                if (auto x = shelf.columns.allocate(rect_width)) {
+                    ++shelf.entry_count;
+                    return AtlasRect{.x = *x, .y = shelf.y, .width = rect_width, .height = rect_height};
+                }
+            }
+        }
+        return std::nullopt;
+    }
+    auto &shelf = shelves.emplace_back(Shelf{.y = shelf_top, .height = shelf_height, .columns = RangeAllocator{width}});
+    shelf_top += shelf_height;
+    auto const x = shelf.columns.allocate(rect_width);
+    ++shelf.entry_count;
+    return AtlasRect{.x = *x, .y = shelf.y, .width = rect_width, .height = rect_height};
+}
+
+void AtlasAllocator::free(AtlasRect const &rect) {
+    auto iter = std::lower_bound(shelves.begin(), shelves.end(), rect.y, [](Shelf const &shelf, uint32_t y) { return shelf.y < y; });
+    assert(iter != shelves.end() && iter->y == rect.y);
+    iter->columns.free(rect.x, rect.width);
+    --iter->entry_count;
+    while (!shelves.empty() && shelves.back().entry_count == 0) {
+        shelf_top = shelves.back().y;
+        shelves.pop_back();
+    }
+}
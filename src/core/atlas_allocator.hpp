@@ -0,0 +1,46 @@
+#pragma once
+
+#include <core/range_allocator.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+struct AtlasRect {
+    uint32_t x{};
+    uint32_t y{};
+    uint32_t width{};
+    uint32_t height{};
+};
+
+// Packs rectangles into a fixed-size 2D area using shelves: horizontal strips
+// stacked from the top, each holding rectangles of about its height. Space
+// within a shelf is a RangeAllocator, so freed rectangles are reused, and
+// shelves left empty are either given back to the unused area (at the top of
+// the stack) or reused for any height that fits.
+class AtlasAllocator {
+  public:
+    // Shelf heights are rounded up to this, so similar sizes share shelves.
+    static inline constexpr uint32_t SHELF_HEIGHT_GRANULARITY = 4;
+
+    explicit AtlasAllocator(uint32_t a_width = 0, uint32_t a_height = 0);
+
+    auto allocate(uint32_t width, uint32_t height) -> std::optional<AtlasRect>;
+    void free(AtlasRect const &rect);
+
+    auto empty() const -> bool { return shelves.empty(); }
+
+  private:
+    struct Shelf {
+        uint32_t y{};
+        uint32_t height{};
+        RangeAllocator columns{};
+        uint32_t entry_count{};
+    };
+
+    uint32_t width{};
+    uint32_t height{};
+    // Sorted by y. Everything from `shelf_top` down is unused.
+    std::vector<Shelf> shelves{};
+    uint32_t shelf_top{};
+};
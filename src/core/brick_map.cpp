@@ -0,0 +1,273 @@
+#include <core/brick_map.hpp>
+
+#include <gvox/core.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    constexpr auto BRICK_MASK = VoxelBrick::SIZE - 1;
+
+    // The clipped voxel range [min, max) of `box` inside the brick at `coord`,
+    // in brick-local coordinates.
+    struct LocalRange {
+        std::array<int32_t, 3> min{};
+        std::array<int32_t, 3> max{};
+
+        auto covers_brick() const -> bool {
+            for (size_t i = 0; i < 3; ++i) {
+                if (min[i] != 0 || max[i] != VoxelBrick::SIZE) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    auto local_range(BrickCoord coord, VoxelBox const &box) -> LocalRange {
+        auto const brick_origin = std::array{coord.x, coord.y, coord.z};
+        auto result = LocalRange{};
+        for (size_t i = 0; i < 3; ++i) {
+            auto const origin = brick_origin[i] * VoxelBrick::SIZE;
+            result.min[i] = std::clamp(box.offset[i] - origin, 0, VoxelBrick::SIZE);
+            result.max[i] = std::clamp(box.offset[i] + box.extent[i] - origin, 0, VoxelBrick::SIZE);
+        }
+        return result;
+    }
+
+    auto make_dense(uint32_t value) -> std::shared_ptr<VoxelBrick> {
+        auto result = std::make_shared<VoxelBrick>();
+        result->voxels.fill(value);
+        return result;
+    }
+} // namespace
+
+auto BrickCoordHash::operator()(BrickCoord const &coord) const noexcept -> size_t {
+    // Large primes from "Optimized Spatial Hashing for Collision Detection of
+    // Deformable Objects" (Teschner et al.)
+    auto const x = static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) * 73856093u;
+    auto const y = static_cast<uint64_t>(static_cast<uint32_t>(coord.y)) * 19349663u;
+    auto const z = static_cast<uint64_t>(static_cast<uint32_t>(coord.z)) * 83492791u;
+    return static_cast<size_t>(x ^ y ^ z);
+}
+
+auto Brick::mutable_data() -> VoxelBrick & {
+    // A use count of 1 can't go up behind our back: other holders only get
+    // a reference by copying this Brick, which the caller owns.
+    if (data.use_count() != 1) {
+        data = std::make_shared<VoxelBrick>(*data);
+    }
+    return const_cast<VoxelBrick &>(*data);
+}
+
+auto BrickMap::sample(int32_t x, int32_t y, int32_t z) const -> uint32_t {
+    auto iter = bricks.find(brick_coord_of(x, y, z));
+    if (iter == bricks.end()) {
+        return 0;
+    }
+    return iter->second.get(VoxelBrick::index(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK));
+}
+
+void BrickMap::set(int32_t x, int32_t y, int32_t z, uint32_t value) {
+    fill(value, VoxelBox{.offset = {x, y, z}, .extent = {1, 1, 1}});
+}
+
+void BrickMap::fill(uint32_t value, VoxelBox const &box) {
+    if (box.is_empty()) {
+        return;
+    }
+    auto const [min_brick, max_brick] = brick_bounds(box);
+    for (int32_t bz = min_brick.z; bz <= max_brick.z; ++bz) {
+        for (int32_t by = min_brick.y; by <= max_brick.y; ++by) {
+            for (int32_t bx = min_brick.x; bx <= max_brick.x; ++bx) {
+                auto const coord = BrickCoord{bx, by, bz};
+                auto iter = bricks.find(coord);
+                if (iter == bricks.end()) {
+                    if (value == 0) {
+                        continue;
+                    }
+                    iter = bricks.emplace(coord, Brick{}).first;
+                }
+                if (fill_brick(iter->second, coord, value, box)) {
+                    dirty_bricks.insert(coord);
+                }
+                if (iter->second.is_empty()) {
+                    bricks.erase(iter);
+                }
+            }
+        }
+    }
+}
+
+void BrickMap::overlay(BrickCoord coord, Brick &&brick) {
+    if (brick.is_empty()) {
+        return;
+    }
+    dirty_bricks.insert(coord);
+    auto [iter, inserted] = bricks.try_emplace(coord);
+    auto &dst = iter->second;
+    if (inserted || dst.is_empty() || (brick.is_uniform() && brick.uniform_value != 0)) {
+        dst = std::move(brick);
+        return;
+    }
+    if (dst.is_uniform()) {
+        dst.data = make_dense(dst.uniform_value);
+    }
+    auto &dst_voxels = dst.mutable_data().voxels;
+    for (size_t i = 0; i < VoxelBrick::VOXEL_COUNT; ++i) {
+        auto const value = brick.get(i);
+        if (value != 0) {
+            dst_voxels[i] = value;
+        }
+    }
+    try_collapse(dst);
+}
+
+void BrickMap::clear() {
+    for (auto const &[coord, brick] : bricks) {
+        dirty_bricks.insert(coord);
+    }
+    bricks.clear();
+}
+
+auto BrickMap::drain_dirty_bricks(size_t max_count) -> std::vector<BrickCoord> {
+    auto result = std::vector<BrickCoord>{};
+    result.reserve(std::min(max_count, dirty_bricks.size()));
+    auto iter = dirty_bricks.begin();
+    while (iter != dirty_bricks.end() && result.size() < max_count) {
+        result.push_back(*iter);
+        iter = dirty_bricks.erase(iter);
+    }
+    return result;
+}
+
+auto BrickMap::fill_brick(Brick &brick, BrickCoord coord, uint32_t value, VoxelBox const &box) -> bool {
+    auto const range = local_range(coord, box);
+    if (range.covers_brick()) {
+        auto const changed = !brick.is_uniform() || brick.uniform_value != value;
+        brick.data.reset();
+        brick.uniform_value = value;
+        return changed;
+    }
+    if (brick.is_uniform()) {
+        if (brick.uniform_value == value) {
+            return false;
+        }
+        brick.data = make_dense(brick.uniform_value);
+    } else {
+        // Writing through mutable_data would copy a brick the edit history
+        // shares, so a fill that changes nothing must not get that far.
+        auto const &current = brick.data->voxels;
+        auto unchanged = true;
+        for (int32_t z = range.min[2]; z < range.max[2] && unchanged; ++z) {
+            for (int32_t y = range.min[1]; y < range.max[1] && unchanged; ++y) {
+                auto const row = current.begin() + static_cast<ptrdiff_t>(VoxelBrick::index(0, y, z));
+                unchanged = std::all_of(row + range.min[0], row + range.max[0], [value](uint32_t v) { return v == value; });
+            }
+        }
+        if (unchanged) {
+            return false;
+        }
+    }
+    auto &voxels = brick.mutable_data().voxels;
+    for (int32_t z = range.min[2]; z < range.max[2]; ++z) {
+        for (int32_t y = range.min[1]; y < range.max[1]; ++y) {
+            auto const row = VoxelBrick::index(0, y, z);
+            std::fill(voxels.begin() + static_cast<ptrdiff_t>(row) + range.min[0], voxels.begin() + static_cast<ptrdiff_t>(row) + range.max[0], value);
+        }
+    }
+    try_collapse(brick);
+    return true;
+}
+
+void BrickMap::try_collapse(Brick &brick) {
+    if (brick.is_uniform()) {
+        return;
+    }
+    auto const &voxels = brick.data->voxels;
+    auto const first = voxels[0];
+    if (std::all_of(voxels.begin() + 1, voxels.end(), [first](uint32_t v) { return v == first; })) {
+        brick.data.reset();
+        brick.uniform_value = first;
+    }
+}
+
+auto BrickMap::stats() const -> BrickMapStats {
+    auto result = BrickMapStats{};
+    auto box_min = std::array{std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()};
+    auto box_max = std::array{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()};
+
+    for (auto const &[coord, brick] : bricks) {
+        ++result.brick_count;
+        if (brick.is_uniform()) {
+            ++result.uniform_brick_count;
+            result.occupied_voxel_count += brick.uniform_value != 0 ? VoxelBrick::VOXEL_COUNT : 0;
+        } else {
+            ++result.dense_brick_count;
+            result.occupied_voxel_count += static_cast<uint64_t>(std::count_if(brick.data->voxels.begin(), brick.data->voxels.end(), [](uint32_t v) { return v != 0; }));
+        }
+        auto const c = std::array{coord.x, coord.y, coord.z};
+        for (size_t i = 0; i < 3; ++i) {
+            box_min[i] = std::min(box_min[i], c[i]);
+            box_max[i] = std::max(box_max[i], c[i]);
+        }
+    }
+
+    // Each table node holds the key/value pair plus the bucket chain pointer
+    // and cached hash, and the bucket array is one pointer per bucket.
+    using Node = std::pair<BrickCoord const, Brick>;
+    result.memory_bytes =
+        result.brick_count * (sizeof(Node) + sizeof(void *) + sizeof(size_t)) +
+        bricks.bucket_count() * sizeof(void *) +
+        result.dense_brick_count * sizeof(VoxelBrick);
+
+    if (result.brick_count != 0) {
+        auto box_voxels = size_t{1};
+        for (size_t i = 0; i < 3; ++i) {
+            box_voxels *= static_cast<size_t>(box_max[i] - box_min[i] + 1) * VoxelBrick::SIZE;
+        }
+        result.raw_container_bytes = box_voxels * sizeof(uint32_t);
+    }
+    return result;
+}
+
+auto gvox_container_brick_map_description() -> GvoxContainerDescription {
+    return GvoxContainerDescription{
+        .create = [](void **out_self, GvoxContainerCreateCbArgs const *args) -> GvoxResult {
+            auto const *config = static_cast<GvoxBrickMapContainerConfig const *>(args->config);
+            if (config == nullptr || config->brick_map == nullptr) {
+                return GVOX_ERROR_INVALID_ARGUMENT;
+            }
+            *out_self = new GvoxBrickMapContainerConfig{*config};
+            return GVOX_SUCCESS;
+        },
+        .destroy = [](void *self) { delete static_cast<GvoxBrickMapContainerConfig *>(self); },
+        .fill = [](void *self, void const *single_voxel_data, GvoxVoxelDesc src_voxel_desc, GvoxRange range) -> GvoxResult {
+            auto const &container = *static_cast<GvoxBrickMapContainerConfig const *>(self);
+            if (!is_valid_brick_map_fill(container.voxel_desc, single_voxel_data, src_voxel_desc, range)) {
+                return GVOX_ERROR_INVALID_ARGUMENT;
+            }
+            auto const box = voxel_box_from_range(range);
+            container.brick_map->fill(*static_cast<uint32_t const *>(single_voxel_data), box);
+            return GVOX_SUCCESS;
+        },
+        .move = nullptr,
+        .sample = nullptr,
+    };
+}
+
+auto is_valid_brick_map_fill(GvoxVoxelDesc container_voxel_desc, void const *single_voxel_data, GvoxVoxelDesc src_voxel_desc, GvoxRange const &range) -> bool {
+    // Voxels are read as the packed uint32_t of the container's own
+    // description, anything else would be misread.
+    return single_voxel_data != nullptr && src_voxel_desc == container_voxel_desc &&
+           range.offset.axis_n == 3 && range.extent.axis_n == 3;
+}
+
+auto voxel_box_from_range(GvoxRange const &range) -> VoxelBox {
+    auto result = VoxelBox{};
+    for (size_t i = 0; i < 3; ++i) {
+        result.offset[i] = static_cast<int32_t>(range.offset.axis[i]);
+        result.extent[i] = std::max(static_cast<int32_t>(range.extent.axis[i]), 1);
+    }
+    return result;
+}
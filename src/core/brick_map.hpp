@@ -0,0 +1,130 @@
+#pragma once
+
+#include <gvox/gvox.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Voxel storage for mostly-empty scenes. The world is split into 8x8x8 bricks
+// that live in a hash table keyed by brick coordinate. A brick whose voxels all
+// share one value is stored as just that value, and bricks that are entirely
+// empty (value 0) are not stored at all.
+
+struct BrickCoord {
+    int32_t x{};
+    int32_t y{};
+    int32_t z{};
+
+    auto operator==(BrickCoord const &) const -> bool = default;
+};
+
+struct BrickCoordHash {
+    auto operator()(BrickCoord const &coord) const noexcept -> size_t;
+};
+
+struct VoxelBrick {
+    static inline constexpr int32_t SIZE_LOG2 = 3;
+    static inline constexpr int32_t SIZE = 1 << SIZE_LOG2;
+    static inline constexpr size_t VOXEL_COUNT = static_cast<size_t>(SIZE * SIZE * SIZE);
+
+    std::array<uint32_t, VOXEL_COUNT> voxels{};
+
+    static auto index(int32_t x, int32_t y, int32_t z) -> size_t {
+        return static_cast<size_t>(x + y * SIZE + z * SIZE * SIZE);
+    }
+};
+
+// Copying a Brick is cheap: dense voxel data is shared between copies and
+// only duplicated when one of them is written through `mutable_data`. This is
+// what lets the edit history keep old versions of bricks around.
+struct Brick {
+    // Only meaningful when `data` is null.
+    uint32_t uniform_value{};
+    std::shared_ptr<VoxelBrick const> data{};
+
+    auto is_uniform() const -> bool { return data == nullptr; }
+    auto is_empty() const -> bool { return is_uniform() && uniform_value == 0; }
+    auto get(size_t voxel_index) const -> uint32_t { return data ? data->voxels[voxel_index] : uniform_value; }
+    // Dense voxels for writing, copied first if anyone else holds them.
+    auto mutable_data() -> VoxelBrick &;
+};
+
+struct VoxelBox {
+    std::array<int32_t, 3> offset{};
+    std::array<int32_t, 3> extent{};
+
+    auto is_empty() const -> bool { return extent[0] <= 0 || extent[1] <= 0 || extent[2] <= 0; }
+};
+
+struct BrickMapStats {
+    size_t brick_count{};
+    size_t uniform_brick_count{};
+    size_t dense_brick_count{};
+    uint64_t occupied_voxel_count{};
+    // Approximate heap footprint of the brick table and brick payloads.
+    size_t memory_bytes{};
+    // What a dense container covering the same bounding box would need.
+    size_t raw_container_bytes{};
+
+    auto bytes_per_occupied_voxel() const -> double {
+        return occupied_voxel_count != 0 ? static_cast<double>(memory_bytes) / static_cast<double>(occupied_voxel_count) : 0.0;
+    }
+};
+
+struct BrickMap {
+    std::unordered_map<BrickCoord, Brick, BrickCoordHash> bricks{};
+    // Bricks whose contents changed since the last `drain_dirty_bricks`.
+    // Removed bricks stay listed here so consumers see them disappear.
+    std::unordered_set<BrickCoord, BrickCoordHash> dirty_bricks{};
+
+    static auto brick_coord_of(int32_t x, int32_t y, int32_t z) -> BrickCoord {
+        return {x >> VoxelBrick::SIZE_LOG2, y >> VoxelBrick::SIZE_LOG2, z >> VoxelBrick::SIZE_LOG2};
+    }
+    // Inclusive range of brick coordinates touched by a non-empty box.
+    static auto brick_bounds(VoxelBox const &box) -> std::array<BrickCoord, 2> {
+        return {
+            brick_coord_of(box.offset[0], box.offset[1], box.offset[2]),
+            brick_coord_of(box.offset[0] + box.extent[0] - 1, box.offset[1] + box.extent[1] - 1, box.offset[2] + box.extent[2] - 1),
+        };
+    }
+
+    auto sample(int32_t x, int32_t y, int32_t z) const -> uint32_t;
+    void set(int32_t x, int32_t y, int32_t z, uint32_t value);
+    void fill(uint32_t value, VoxelBox const &box);
+    // Writes the non-empty voxels of `brick` over the brick at `coord`.
+    void overlay(BrickCoord coord, Brick &&brick);
+    void clear();
+
+    // Hands out up to `max_count` dirty bricks and clears them from the set.
+    auto drain_dirty_bricks(size_t max_count) -> std::vector<BrickCoord>;
+
+    auto stats() const -> BrickMapStats;
+
+    // Writes `value` into the part of `box` that overlaps the brick at `coord`
+    // and returns whether the brick changed. Only touches that one brick's
+    // entry, so calls on distinct bricks are independent of each other once
+    // the entry exists.
+    static auto fill_brick(Brick &brick, BrickCoord coord, uint32_t value, VoxelBox const &box) -> bool;
+    // Replaces dense storage with a single value if every voxel matches.
+    static void try_collapse(Brick &brick);
+};
+
+// Exposes a BrickMap as a gvox container so it can be written through
+// `gvox_fill`. The container does not own the map. Fills must use
+// `voxel_desc`, whose voxels are stored as one packed uint32_t.
+struct GvoxBrickMapContainerConfig {
+    GvoxVoxelDesc voxel_desc;
+    BrickMap *brick_map;
+};
+
+auto gvox_container_brick_map_description() -> GvoxContainerDescription;
+// Whether a fill can be applied to a brick map container described by
+// `container_voxel_desc`: a voxel to read, in that description, over a 3D range.
+auto is_valid_brick_map_fill(GvoxVoxelDesc container_voxel_desc, void const *single_voxel_data, GvoxVoxelDesc src_voxel_desc, GvoxRange const &range) -> bool;
+// Converts a 3D gvox range to a box. A zero extent addresses a single layer
+// along that axis, which is how the scene draws its axis lines.
+auto voxel_box_from_range(GvoxRange const &range) -> VoxelBox;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+// Pinhole camera in a Z-up world. Both the GPU viewport and the CPU renderer
+// build rays from `basis` the same way:
+//   u = ((x + 0.5) / width * 2 - 1) * tan_half_fov_y * width / height
+//   v = (1 - (y + 0.5) / height * 2) * tan_half_fov_y
+//   dir = normalize(forward + right * u + up * v)
+struct Camera {
+    std::array<float, 3> position{28.0f, -36.0f, 24.0f};
+    // Radians. Yaw is measured from +X towards +Y, pitch up from the XY plane.
+    float yaw = 2.2f;
+    float pitch = -0.45f;
+    float vertical_fov = 1.0f;
+
+    struct Basis {
+        std::array<float, 3> forward{};
+        std::array<float, 3> right{};
+        std::array<float, 3> up{};
+        float tan_half_fov_y{};
+    };
+
+    auto basis() const -> Basis {
+        auto const cos_pitch = std::cos(pitch);
+        auto result = Basis{};
+        result.forward = {cos_pitch * std::cos(yaw), cos_pitch * std::sin(yaw), std::sin(pitch)};
+        result.right = {std::sin(yaw), -std::cos(yaw), 0.0f};
+        result.up = {
+            result.right[1] * result.forward[2] - result.right[2] * result.forward[1],
+            result.right[2] * result.forward[0] - result.right[0] * result.forward[2],
+            result.right[0] * result.forward[1] - result.right[1] * result.forward[0],
+        };
+        result.tan_half_fov_y = std::tan(vertical_fov * 0.5f);
+        return result;
+    }
+};
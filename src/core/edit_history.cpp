@@ -0,0 +1,128 @@
+#include <core/edit_history.hpp>
+
+namespace {
+    auto same_contents(Brick const &a, Brick const &b) -> bool {
+        if (a.is_uniform() != b.is_uniform()) {
+            return false;
+        }
+        // Dense data is copied on write, so an untouched brick still points
+        // at the same voxels.
+        return a.is_uniform() ? a.uniform_value == b.uniform_value : a.data == b.data;
+    }
+
+    // Counts dense payloads on both sides even though the newest ones are
+    // shared with the scene, which makes this an upper bound.
+    auto record_memory_bytes(EditRecord const &record) -> size_t {
+        auto result = sizeof(EditRecord) + (record.before.size() + record.after.size()) * sizeof(BrickSnapshot);
+        for (auto const *snapshots : {&record.before, &record.after}) {
+            for (auto const &snapshot : *snapshots) {
+                result += snapshot.brick.is_uniform() ? 0 : sizeof(VoxelBrick);
+            }
+        }
+        return result;
+    }
+
+    void apply_snapshots(BrickMap &brick_map, std::span<BrickSnapshot const> snapshots) {
+        for (auto const &snapshot : snapshots) {
+            if (snapshot.brick.is_empty()) {
+                brick_map.bricks.erase(snapshot.coord);
+            } else {
+                brick_map.bricks.insert_or_assign(snapshot.coord, snapshot.brick);
+            }
+            brick_map.dirty_bricks.insert(snapshot.coord);
+        }
+    }
+} // namespace
+
+void EditHistory::begin_edit(BrickMap const &brick_map, std::span<FillCommand const> commands) {
+    for (auto const &command : commands) {
+        if (command.box.is_empty()) {
+            continue;
+        }
+        auto const [min_brick, max_brick] = BrickMap::brick_bounds(command.box);
+        for (int32_t bz = min_brick.z; bz <= max_brick.z; ++bz) {
+            for (int32_t by = min_brick.y; by <= max_brick.y; ++by) {
+                for (int32_t bx = min_brick.x; bx <= max_brick.x; ++bx) {
+                    auto const coord = BrickCoord{bx, by, bz};
+                    if (pending_before.contains(coord)) {
+                        continue;
+                    }
+                    auto iter = brick_map.bricks.find(coord);
+                    pending_before.emplace(coord, iter != brick_map.bricks.end() ? iter->second : Brick{});
+                }
+            }
+        }
+    }
+}
+
+void EditHistory::end_edit(BrickMap const &brick_map) {
+    auto record = EditRecord{};
+    for (auto &[coord, before] : pending_before) {
+        auto iter = brick_map.bricks.find(coord);
+        auto after = iter != brick_map.bricks.end() ? iter->second : Brick{};
+        if (same_contents(before, after)) {
+            continue;
+        }
+        record.before.push_back({.coord = coord, .brick = std::move(before)});
+        record.after.push_back({.coord = coord, .brick = std::move(after)});
+    }
+    pending_before.clear();
+    if (record.before.empty()) {
+        return;
+    }
+    record.memory_bytes = record_memory_bytes(record);
+    memory_bytes += record.memory_bytes;
+    undo_stack.push_back(std::move(record));
+    for (auto const &redo_record : redo_stack) {
+        memory_bytes -= redo_record.memory_bytes;
+    }
+    redo_stack.clear();
+    evict_to_budget();
+}
+
+auto EditHistory::undo(BrickMap &brick_map) -> bool {
+    if (undo_stack.empty()) {
+        return false;
+    }
+    auto record = std::move(undo_stack.back());
+    undo_stack.pop_back();
+    apply_snapshots(brick_map, record.before);
+    redo_stack.push_back(std::move(record));
+    return true;
+}
+
+auto EditHistory::redo(BrickMap &brick_map) -> bool {
+    if (redo_stack.empty()) {
+        return false;
+    }
+    auto record = std::move(redo_stack.back());
+    redo_stack.pop_back();
+    apply_snapshots(brick_map, record.after);
+    undo_stack.push_back(std::move(record));
+    return true;
+}
+
+void EditHistory::clear() {
+    undo_stack.clear();
+    redo_stack.clear();
+    pending_before.clear();
+    memory_bytes = 0;
+}
+
+auto EditHistory::stats() const -> EditHistoryStats {
+    return {
+        .undo_count = undo_stack.size(),
+        .redo_count = redo_stack.size(),
+        .memory_bytes = memory_bytes,
+        .evicted_count = evicted_count,
+    };
+}
+
+void EditHistory::evict_to_budget() {
+    // Always keep the newest edit, however big, so it can be undone.
+    while (memory_bytes > memory_budget_bytes && undo_stack.size() > 1) {
+        memory_bytes -= undo_stack.front().memory_bytes;
+        undo_stack.pop_front();
+        ++evicted_count;
+    }
+}
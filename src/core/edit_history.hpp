@@ -0,0 +1,65 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/parallel_fill.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct BrickSnapshot {
+    BrickCoord coord{};
+    // An empty brick stands for "not in the map".
+    Brick brick{};
+};
+
+// One undoable edit: the bricks it changed, before and after. Snapshots share
+// voxel data with the scene, so recording an edit costs a reference per brick
+// and the scene only copies the dense bricks it goes on to modify.
+struct EditRecord {
+    std::vector<BrickSnapshot> before{};
+    std::vector<BrickSnapshot> after{};
+    size_t memory_bytes{};
+};
+
+struct EditHistoryStats {
+    size_t undo_count{};
+    size_t redo_count{};
+    size_t memory_bytes{};
+    size_t evicted_count{};
+};
+
+// Undo/redo journal for a BrickMap. Every edit is bracketed by `begin_edit`
+// and `end_edit`, and undoing or redoing writes back only that edit's bricks,
+// so it costs time in proportion to the edit, not the scene. Once the
+// journal's memory goes over `memory_budget_bytes`, the oldest edits are
+// dropped first.
+class EditHistory {
+  public:
+    size_t memory_budget_bytes = size_t{512} << 20;
+    std::deque<EditRecord> undo_stack{};
+    std::vector<EditRecord> redo_stack{};
+    size_t memory_bytes{};
+    size_t evicted_count{};
+
+    // Snapshots every brick the commands can touch. Call right before they
+    // are applied to `brick_map`.
+    void begin_edit(BrickMap const &brick_map, std::span<FillCommand const> commands);
+    // Records what the bricks from `begin_edit` look like now. Bricks that
+    // ended up unchanged are left out, and an edit that changed nothing is
+    // not recorded.
+    void end_edit(BrickMap const &brick_map);
+
+    auto undo(BrickMap &brick_map) -> bool;
+    auto redo(BrickMap &brick_map) -> bool;
+    void clear();
+
+    auto stats() const -> EditHistoryStats;
+
+  private:
+    std::unordered_map<BrickCoord, Brick, BrickCoordHash> pending_before{};
+
+    void evict_to_budget();
+};
@@ -0,0 +1,98 @@
+#include <core/mesher.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+    constexpr auto NEIGHBOR_OFFSETS = std::array<std::array<int32_t, 3>, 6>{{
+        {-1, 0, 0},
+        {+1, 0, 0},
+        {0, -1, 0},
+        {0, +1, 0},
+        {0, 0, -1},
+        {0, 0, +1},
+    }};
+
+    // The brick and its six face neighbours. Voxels outside the brick are
+    // looked up in the neighbour on that side.
+    struct BrickNeighborhood {
+        Brick const *center{};
+        std::array<Brick const *, 6> neighbors{};
+
+        auto sample(std::array<int32_t, 3> local) const -> uint32_t {
+            auto const *brick = center;
+            for (size_t axis = 0; axis < 3; ++axis) {
+                if (local[axis] < 0) {
+                    brick = neighbors[axis * 2];
+                    local[axis] += VoxelBrick::SIZE;
+                } else if (local[axis] >= VoxelBrick::SIZE) {
+                    brick = neighbors[axis * 2 + 1];
+                    local[axis] -= VoxelBrick::SIZE;
+                }
+            }
+            return brick != nullptr ? brick->get(VoxelBrick::index(local[0], local[1], local[2])) : 0;
+        }
+    };
+
+    void mesh_brick(BrickCoord coord, BrickNeighborhood const &neighborhood, std::vector<MeshFace> &out_faces) {
+        auto const origin = std::array{coord.x * VoxelBrick::SIZE, coord.y * VoxelBrick::SIZE, coord.z * VoxelBrick::SIZE};
+        for (int32_t z = 0; z < VoxelBrick::SIZE; ++z) {
+            for (int32_t y = 0; y < VoxelBrick::SIZE; ++y) {
+                for (int32_t x = 0; x < VoxelBrick::SIZE; ++x) {
+                    auto const color = neighborhood.center->get(VoxelBrick::index(x, y, z));
+                    if (color == 0) {
+                        continue;
+                    }
+                    for (uint32_t direction = 0; direction < 6; ++direction) {
+                        auto const &offset = NEIGHBOR_OFFSETS[direction];
+                        if (neighborhood.sample({x + offset[0], y + offset[1], z + offset[2]}) != 0) {
+                            continue;
+                        }
+                        out_faces.push_back({
+                            .voxel = {origin[0] + x, origin[1] + y, origin[2] + z},
+                            .color = color,
+                            .direction = direction,
+                        });
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+auto mesh_brick_map(ThreadPool &thread_pool, BrickMap const &brick_map) -> VoxelMesh {
+    auto coords = std::vector<BrickCoord>{};
+    coords.reserve(brick_map.bricks.size());
+    for (auto const &[coord, brick] : brick_map.bricks) {
+        coords.push_back(coord);
+    }
+    std::sort(coords.begin(), coords.end(), [](BrickCoord const &a, BrickCoord const &b) {
+        return std::tie(a.z, a.y, a.x) < std::tie(b.z, b.y, b.x);
+    });
+
+    auto find_brick = [&](BrickCoord coord) -> Brick const * {
+        auto iter = brick_map.bricks.find(coord);
+        return iter != brick_map.bricks.end() ? &iter->second : nullptr;
+    };
+    auto per_brick_faces = std::vector<std::vector<MeshFace>>(coords.size());
+    thread_pool.parallel_for(coords.size(), [&](size_t i) {
+        auto const coord = coords[i];
+        auto neighborhood = BrickNeighborhood{.center = find_brick(coord)};
+        for (size_t direction = 0; direction < 6; ++direction) {
+            auto const &offset = NEIGHBOR_OFFSETS[direction];
+            neighborhood.neighbors[direction] = find_brick({coord.x + offset[0], coord.y + offset[1], coord.z + offset[2]});
+        }
+        mesh_brick(coord, neighborhood, per_brick_faces[i]);
+    });
+
+    auto result = VoxelMesh{};
+    auto face_count = size_t{};
+    for (auto const &faces : per_brick_faces) {
+        face_count += faces.size();
+    }
+    result.faces.reserve(face_count);
+    for (auto const &faces : per_brick_faces) {
+        result.faces.insert(result.faces.end(), faces.begin(), faces.end());
+    }
+    return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/thread_pool.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// One exposed voxel face. `direction` is the face normal: 0/1 for -X/+X,
+// 2/3 for -Y/+Y and 4/5 for -Z/+Z.
+struct MeshFace {
+    std::array<int32_t, 3> voxel{};
+    uint32_t color{};
+    uint32_t direction{};
+};
+
+struct VoxelMesh {
+    std::vector<MeshFace> faces{};
+};
+
+// Builds a face-culled surface mesh: every face of a filled voxel whose
+// neighbour is empty. Bricks are meshed independently on the thread pool and
+// the results concatenated in a stable order, so the output does not depend
+// on the thread count.
+auto mesh_brick_map(ThreadPool &thread_pool, BrickMap const &brick_map) -> VoxelMesh;
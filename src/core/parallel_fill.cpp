@@ -0,0 +1,127 @@
+#include <core/parallel_fill.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Tiles are 4x4x4 bricks (32^3 voxels), small enough to balance well and
+    // large enough that per-task overhead is negligible.
+    constexpr int32_t TILE_SIZE_LOG2 = 2;
+
+    struct Tile {
+        BrickCoord coord{};
+        std::vector<uint32_t> command_indices{};
+        // Structural changes are collected per tile and applied after the
+        // parallel pass, since the table itself is not safe to mutate
+        // concurrently.
+        std::vector<std::pair<BrickCoord, Brick>> inserts{};
+        std::vector<BrickCoord> erases{};
+        std::vector<BrickCoord> changed{};
+    };
+
+    auto tile_coord_of(BrickCoord brick) -> BrickCoord {
+        return {brick.x >> TILE_SIZE_LOG2, brick.y >> TILE_SIZE_LOG2, brick.z >> TILE_SIZE_LOG2};
+    }
+
+    auto overlaps(VoxelBox const &box, BrickCoord brick) -> bool {
+        auto const origin = std::array{brick.x * VoxelBrick::SIZE, brick.y * VoxelBrick::SIZE, brick.z * VoxelBrick::SIZE};
+        for (size_t i = 0; i < 3; ++i) {
+            if (box.offset[i] >= origin[i] + VoxelBrick::SIZE || box.offset[i] + box.extent[i] <= origin[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void process_tile(Tile &tile, BrickMap &brick_map, std::span<FillCommand const> commands) {
+        // Only walk the bricks that some command in this tile actually covers.
+        auto const tile_min = BrickCoord{tile.coord.x << TILE_SIZE_LOG2, tile.coord.y << TILE_SIZE_LOG2, tile.coord.z << TILE_SIZE_LOG2};
+        auto const tile_max = BrickCoord{tile_min.x + (1 << TILE_SIZE_LOG2) - 1, tile_min.y + (1 << TILE_SIZE_LOG2) - 1, tile_min.z + (1 << TILE_SIZE_LOG2) - 1};
+        auto min_brick = tile_max;
+        auto max_brick = tile_min;
+        for (auto command_index : tile.command_indices) {
+            auto const [lo, hi] = BrickMap::brick_bounds(commands[command_index].box);
+            min_brick = {std::min(min_brick.x, lo.x), std::min(min_brick.y, lo.y), std::min(min_brick.z, lo.z)};
+            max_brick = {std::max(max_brick.x, hi.x), std::max(max_brick.y, hi.y), std::max(max_brick.z, hi.z)};
+        }
+        min_brick = {std::max(min_brick.x, tile_min.x), std::max(min_brick.y, tile_min.y), std::max(min_brick.z, tile_min.z)};
+        max_brick = {std::min(max_brick.x, tile_max.x), std::min(max_brick.y, tile_max.y), std::min(max_brick.z, tile_max.z)};
+
+        for (int32_t bz = min_brick.z; bz <= max_brick.z; ++bz) {
+            for (int32_t by = min_brick.y; by <= max_brick.y; ++by) {
+                for (int32_t bx = min_brick.x; bx <= max_brick.x; ++bx) {
+                    auto const coord = BrickCoord{bx, by, bz};
+                    // `find` does not modify the table and the brick belongs to
+                    // this tile alone, so writing through the entry is safe.
+                    auto iter = brick_map.bricks.find(coord);
+                    auto const existed = iter != brick_map.bricks.end();
+                    auto local_brick = Brick{};
+                    auto &brick = existed ? iter->second : local_brick;
+                    auto changed = false;
+                    for (auto command_index : tile.command_indices) {
+                        auto const &command = commands[command_index];
+                        if (!overlaps(command.box, coord)) {
+                            continue;
+                        }
+                        changed |= BrickMap::fill_brick(brick, coord, command.value, command.box);
+                    }
+                    if (!changed) {
+                        continue;
+                    }
+                    tile.changed.push_back(coord);
+                    if (existed && brick.is_empty()) {
+                        tile.erases.push_back(coord);
+                    } else if (!existed && !brick.is_empty()) {
+                        tile.inserts.emplace_back(coord, std::move(local_brick));
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+void parallel_fill(ThreadPool &thread_pool, BrickMap &brick_map, std::span<FillCommand const> commands) {
+    auto tiles = std::vector<Tile>{};
+    auto tile_lookup = std::unordered_map<BrickCoord, size_t, BrickCoordHash>{};
+    for (size_t command_index = 0; command_index < commands.size(); ++command_index) {
+        auto const &box = commands[command_index].box;
+        if (box.is_empty()) {
+            continue;
+        }
+        auto const [min_brick, max_brick] = BrickMap::brick_bounds(box);
+        auto const min_tile = tile_coord_of(min_brick);
+        auto const max_tile = tile_coord_of(max_brick);
+        for (int32_t tz = min_tile.z; tz <= max_tile.z; ++tz) {
+            for (int32_t ty = min_tile.y; ty <= max_tile.y; ++ty) {
+                for (int32_t tx = min_tile.x; tx <= max_tile.x; ++tx) {
+                    auto const tile_coord = BrickCoord{tx, ty, tz};
+                    auto [iter, inserted] = tile_lookup.emplace(tile_coord, tiles.size());
+                    if (inserted) {
+                        tiles.push_back(Tile{.coord = tile_coord});
+                    }
+                    tiles[iter->second].command_indices.push_back(static_cast<uint32_t>(command_index));
+                }
+            }
+        }
+    }
+
+    thread_pool.parallel_for(tiles.size(), [&](size_t tile_index) {
+        process_tile(tiles[tile_index], brick_map, commands);
+    });
+
+    auto insert_count = size_t{};
+    for (auto const &tile : tiles) {
+        insert_count += tile.inserts.size();
+    }
+    brick_map.bricks.reserve(brick_map.bricks.size() + insert_count);
+    for (auto &tile : tiles) {
+        for (auto &[coord, brick] : tile.inserts) {
+            brick_map.bricks.emplace(coord, std::move(brick));
+        }
+        for (auto const &coord : tile.erases) {
+            brick_map.bricks.erase(coord);
+        }
+        brick_map.dirty_bricks.insert(tile.changed.begin(), tile.changed.end());
+    }
+}
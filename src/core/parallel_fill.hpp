@@ -0,0 +1,18 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/thread_pool.hpp>
+
+#include <span>
+
+struct FillCommand {
+    uint32_t value{};
+    VoxelBox box{};
+};
+
+// Applies a batch of fills to `brick_map` using `thread_pool`. The affected
+// region is cut into tiles of 4x4x4 bricks and each tile is processed by one
+// task, so no two tasks ever touch the same brick and no locking is needed.
+// Where fills in the batch overlap, later commands win, exactly as if they
+// had been applied one after another.
+void parallel_fill(ThreadPool &thread_pool, BrickMap &brick_map, std::span<FillCommand const> commands);
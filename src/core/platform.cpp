@@ -0,0 +1,208 @@
+#include <core/platform.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::filesystem::path const &path) {
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    auto file_size = LARGE_INTEGER{};
+    if (GetFileSizeEx(file, &file_size) == 0 || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return;
+    }
+    auto *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    data = static_cast<std::byte const *>(view);
+    size = static_cast<size_t>(file_size.QuadPart);
+    file_handle = file;
+    mapping_handle = mapping;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+    }
+}
+
+void MappedFile::advise_sequential() const {
+}
+
+void MappedFile::release_range(size_t offset, size_t length) const {
+    // Unlocking pages that aren't locked is the documented way to remove
+    // them from the working set.
+    VirtualUnlock(const_cast<std::byte *>(data + offset), length);
+}
+
+auto executable_path() -> std::filesystem::path {
+    auto buffer = std::wstring(MAX_PATH, L'\0');
+    while (true) {
+        auto const length = GetModuleFileNameW(nullptr, buffer.data(), static_cast<DWORD>(buffer.size()));
+        if (length == 0) {
+            return {};
+        }
+        // A full buffer means the path was cut short.
+        if (length < buffer.size()) {
+            buffer.resize(length);
+            return buffer;
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+auto peak_resident_memory_bytes() -> size_t {
+    auto counters = PROCESS_MEMORY_COUNTERS{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+auto process_cpu_seconds() -> double {
+    auto creation_time = FILETIME{};
+    auto exit_time = FILETIME{};
+    auto kernel_time = FILETIME{};
+    auto user_time = FILETIME{};
+    if (GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time) == 0) {
+        return 0.0;
+    }
+    // In units of 100ns.
+    auto const to_ticks = [](FILETIME const &time) { return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+    return static_cast<double>(to_ticks(kernel_time) + to_ticks(user_time)) * 1e-7;
+}
+
+#else
+
+MappedFile::MappedFile(std::filesystem::path const &path) {
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        close(fd);
+        return;
+    }
+    auto const file_size = static_cast<size_t>(file_stat.st_size);
+    auto *view = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        return;
+    }
+    data = static_cast<std::byte const *>(view);
+    size = file_size;
+    file_descriptor = fd;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap(const_cast<std::byte *>(data), size);
+        close(file_descriptor);
+    }
+}
+
+void MappedFile::advise_sequential() const {
+    madvise(const_cast<std::byte *>(data), size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::release_range(size_t offset, size_t length) const {
+    // madvise needs a page-aligned start, so only whole pages inside the
+    // range are released.
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto const begin = (offset + page_size - 1) / page_size * page_size;
+    auto const end = std::min(offset + length, size) / page_size * page_size;
+    if (end > begin) {
+        madvise(const_cast<std::byte *>(data + begin), end - begin, MADV_DONTNEED);
+    }
+}
+
+auto executable_path() -> std::filesystem::path {
+#if defined(__APPLE__)
+    auto size = uint32_t{};
+    _NSGetExecutablePath(nullptr, &size);
+    auto buffer = std::string(size, '\0');
+    if (_NSGetExecutablePath(buffer.data(), &size) != 0) {
+        return {};
+    }
+    buffer.resize(std::strlen(buffer.c_str()));
+    auto error = std::error_code{};
+    auto path = std::filesystem::canonical(buffer, error);
+    return error ? std::filesystem::path{buffer} : path;
+#else
+    auto error = std::error_code{};
+    auto path = std::filesystem::read_symlink("/proc/self/exe", error);
+    return error ? std::filesystem::path{} : path;
+#endif
+}
+
+auto peak_resident_memory_bytes() -> size_t {
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+auto process_cpu_seconds() -> double {
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    auto const to_seconds = [](timeval const &time) { return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6; };
+    return to_seconds(usage.ru_utime) + to_seconds(usage.ru_stime);
+}
+
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+auto MappedFile::operator=(MappedFile &&other) noexcept -> MappedFile & {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+#if defined(_WIN32)
+    std::swap(file_handle, other.file_handle);
+    std::swap(mapping_handle, other.mapping_handle);
+#else
+    std::swap(file_descriptor, other.file_descriptor);
+#endif
+    return *this;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of a whole file.
+struct MappedFile {
+    std::byte const *data{};
+    size_t size{};
+#if defined(_WIN32)
+    void *file_handle{};
+    void *mapping_handle{};
+#else
+    int file_descriptor = -1;
+#endif
+
+    MappedFile() = default;
+    explicit MappedFile(std::filesystem::path const &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+    auto operator=(MappedFile &&other) noexcept -> MappedFile &;
+
+    auto is_open() const -> bool { return data != nullptr; }
+    auto bytes() const -> std::span<std::byte const> { return {data, size}; }
+
+    // Hints that the mapping will be read front to back.
+    void advise_sequential() const;
+    // Lets the OS drop the resident pages backing [offset, offset + length),
+    // so a streaming reader doesn't hold the whole file in memory.
+    void release_range(size_t offset, size_t length) const;
+};
+
+// Full path of the running executable, or empty if the OS won't say.
+auto executable_path() -> std::filesystem::path;
+// Largest resident set size the process has reached so far.
+auto peak_resident_memory_bytes() -> size_t;
+// User plus kernel CPU time used by all threads of the process so far.
+auto process_cpu_seconds() -> double;
@@ -0,0 +1,74 @@
+#include <core/range_allocator.hpp>
+
+#include <cassert>
+
+RangeAllocator::RangeAllocator(uint32_t a_capacity) {
+    grow(a_capacity);
+}
+
+auto RangeAllocator::allocate(uint32_t size) -> std::optional<uint32_t> {
+    if (size == 0) {
+        return std::nullopt;
+    }
+    auto fit = free_by_size.lower_bound(size);
+    if (fit == free_by_size.end()) {
+        return std::nullopt;
+    }
+    auto const [range_size, offset] = *fit;
+    erase_free(free_by_offset.find(offset));
+    if (range_size > size) {
+        insert_free(offset + size, range_size - size);
+    }
+    used_ += size;
+    return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= capacity_ && size <= used_);
+    used_ -= size;
+    auto next = free_by_offset.lower_bound(offset);
+    if (next != free_by_offset.end() && next->first == offset + size) {
+        size += next->second;
+        next = std::next(next);
+        erase_free(std::prev(next));
+    }
+    if (next != free_by_offset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            erase_free(prev);
+        }
+    }
+    insert_free(offset, size);
+}
+
+void RangeAllocator::grow(uint32_t new_capacity) {
+    if (new_capacity <= capacity_) {
+        return;
+    }
+    auto const old_capacity = capacity_;
+    capacity_ = new_capacity;
+    // Counted as used so that `free` can merge it like any other range.
+    used_ += new_capacity - old_capacity;
+    free(old_capacity, new_capacity - old_capacity);
+}
+
+void RangeAllocator::insert_free(uint32_t offset, uint32_t size) {
+    free_by_offset.emplace(offset, size);
+    free_by_size.emplace(size, offset);
+}
+
+void RangeAllocator::erase_free(std::map<uint32_t, uint32_t>::iterator iter) {
+    auto [first, last] = free_by_size.equal_range(iter->second);
+    for (; first != last; ++first) {
+        if (first->second == iter->first) {
+            free_by_size.erase(first);
+            break;
+        }
+    }
+    free_by_offset.erase(iter);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+// Hands out [offset, offset + size) ranges of a linear space, such as the
+// elements of a GPU buffer. Free ranges are kept coalesced, and allocation
+// takes the smallest free range that fits, so long-lived allocations of
+// mixed sizes fragment the space as little as possible.
+class RangeAllocator {
+  public:
+    explicit RangeAllocator(uint32_t a_capacity = 0);
+
+    auto allocate(uint32_t size) -> std::optional<uint32_t>;
+    void free(uint32_t offset, uint32_t size);
+    // Adds [capacity, new_capacity) to the free space. Existing allocations
+    // keep their offsets.
+    void grow(uint32_t new_capacity);
+
+    auto capacity() const -> uint32_t { return capacity_; }
+    auto used() const -> uint32_t { return used_; }
+
+  private:
+    // Free ranges, once by offset to coalesce neighbours and once by size
+    // to find the best fit.
+    std::map<uint32_t, uint32_t> free_by_offset{};
+    std::multimap<uint32_t, uint32_t> free_by_size{};
+    uint32_t capacity_{};
+    uint32_t used_{};
+
+    void insert_free(uint32_t offset, uint32_t size);
+    void erase_free(std::map<uint32_t, uint32_t>::iterator iter);
+};
@@ -0,0 +1,62 @@
+#include <core/ring_allocator.hpp>
+
+namespace {
+    auto align_up(size_t value, size_t alignment) -> size_t {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+RingAllocator::RingAllocator(size_t a_capacity)
+    : capacity_{a_capacity} {}
+
+auto RingAllocator::allocate(size_t size, size_t alignment) -> std::optional<size_t> {
+    if (used_ + size > capacity_) {
+        return std::nullopt;
+    }
+    if (used_ == 0) {
+        head = 0;
+        tail = 0;
+    }
+    auto offset = align_up(head, alignment);
+    if (head > tail || used_ == 0) {
+        if (offset + size > capacity_) {
+            // Skip the rest of the space and continue from the start.
+            if (size > tail) {
+                return std::nullopt;
+            }
+            offset = 0;
+        }
+    } else if (offset + size > tail) {
+        return std::nullopt;
+    }
+    auto const consumed = offset >= head ? offset + size - head : capacity_ - head + size;
+    used_ += consumed;
+    frame_size += consumed;
+    head = offset + size;
+    return offset;
+}
+
+void RingAllocator::end_frame(uint64_t timeline_value) {
+    if (frame_size != 0) {
+        frames.push_back({.timeline_value = timeline_value, .end = head, .size = frame_size});
+        frame_size = 0;
+    }
+}
+
+void RingAllocator::reclaim(uint64_t completed_timeline_value) {
+    auto reclaimed = frames.begin();
+    for (; reclaimed != frames.end() && reclaimed->timeline_value <= completed_timeline_value; ++reclaimed) {
+        tail = reclaimed->end;
+        used_ -= reclaimed->size;
+    }
+    frames.erase(frames.begin(), reclaimed);
+}
+
+void RingAllocator::reset(size_t new_capacity) {
+    capacity_ = new_capacity;
+    head = 0;
+    tail = 0;
+    used_ = 0;
+    frame_size = 0;
+    frames.clear();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Hands out ranges of a circular space, such as a staging buffer, that are
+// freed a frame at a time. Allocations made between two `end_frame` calls
+// belong to one frame, and the frame's space is only reused once `reclaim`
+// reports its timeline value as reached.
+class RingAllocator {
+  public:
+    explicit RingAllocator(size_t a_capacity = 0);
+
+    // Returns the offset of the range, or nothing if the frames still in
+    // flight leave no room for it.
+    auto allocate(size_t size, size_t alignment) -> std::optional<size_t>;
+    // Closes the current frame. `timeline_value` is what the submission that
+    // consumes this frame's allocations signals once it completes.
+    void end_frame(uint64_t timeline_value);
+    // Frees the space of every frame whose timeline value has been reached.
+    void reclaim(uint64_t completed_timeline_value);
+    // Forgets every frame and starts over, empty, with `new_capacity`.
+    void reset(size_t new_capacity);
+
+    auto capacity() const -> size_t { return capacity_; }
+    auto used() const -> size_t { return used_; }
+    auto frames_in_flight() const -> size_t { return frames.size(); }
+
+  private:
+    struct FrameMark {
+        uint64_t timeline_value{};
+        size_t end{};
+        size_t size{};
+    };
+
+    size_t capacity_{};
+    // Allocation happens at `head`, and frames are freed from `tail`. `used_`
+    // tells a full ring from an empty one when they meet.
+    size_t head{};
+    size_t tail{};
+    size_t used_{};
+    size_t frame_size{};
+    // Oldest first. A vector, so steady-state frames don't allocate.
+    std::vector<FrameMark> frames{};
+};
@@ -4,9 +4,14 @@
 #include <gvox/format.h>
 #include <gvox/stream.h>
 
-#include <gvox/containers/raw.h>
+#include <core/parallel_fill.hpp>
 
-VoxelScene::VoxelScene() {
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+VoxelScene::VoxelScene(ThreadPool &a_thread_pool)
+    : thread_pool{a_thread_pool} {
     {
         auto const attribs = std::array{
             GvoxAttribute{
@@ -26,57 +31,170 @@ VoxelScene::VoxelScene() {
     }
 
     {
-        auto raw_container_conf = GvoxRawContainerConfig{
+        auto brick_map_container_conf = GvoxBrickMapContainerConfig{
             .voxel_desc = voxel_desc,
+            .brick_map = &brick_map,
         };
         auto const create_info = GvoxContainerCreateInfo{
             .struct_type = GVOX_STRUCT_TYPE_CONTAINER_CREATE_INFO,
             .next = nullptr,
-            .description = gvox_container_raw_description(),
+            .description = gvox_container_brick_map_description(),
             .cb_args = {
                 .struct_type = GVOX_STRUCT_TYPE_CONTAINER_CREATE_CB_ARGS,
                 .next = nullptr,
-                .config = &raw_container_conf,
+                .config = &brick_map_container_conf,
             },
         };
         auto result = gvox_create_container(&create_info, &main_container);
     }
 
     {
-        auto voxel_data = uint32_t{};
-        auto offset = GvoxOffset3D{0, 0, 0};
-        auto extent = GvoxExtent3D{8, 8, 8};
-        auto fill_info = GvoxFillInfo{
-            .struct_type = GVOX_STRUCT_TYPE_FILL_INFO,
-            .next = nullptr,
-            .src_data = &voxel_data,
-            .src_desc = voxel_desc,
-            .dst = main_container,
-            .range = {
-                {3, &offset.x},
-                {3, &extent.x},
-            },
+        auto const voxel_data = std::array<uint32_t, 4>{0x00000000, 0x000000ff, 0x0000ff00, 0x00ff0000};
+        auto const offsets = std::array{
+            GvoxOffset3D{0, 0, 0},
+            GvoxOffset3D{1, 0, 0},
+            GvoxOffset3D{0, 1, 0},
+            GvoxOffset3D{0, 0, 1},
         };
-        gvox_fill(&fill_info);
-
-        voxel_data = 0x000000ff;
-        offset = {1, 0, 0};
-        extent = {7, 0, 0};
-        gvox_fill(&fill_info);
-
-        voxel_data = 0x0000ff00;
-        offset = {0, 1, 0};
-        extent = {0, 7, 0};
-        gvox_fill(&fill_info);
-
-        voxel_data = 0x00ff0000;
-        offset = {0, 0, 1};
-        extent = {0, 0, 7};
-        gvox_fill(&fill_info);
+        auto const extents = std::array{
+            GvoxExtent3D{8, 8, 8},
+            GvoxExtent3D{7, 0, 0},
+            GvoxExtent3D{0, 7, 0},
+            GvoxExtent3D{0, 0, 7},
+        };
+        auto fill_infos = std::array<GvoxFillInfo, 4>{};
+        for (size_t i = 0; i < fill_infos.size(); ++i) {
+            fill_infos[i] = GvoxFillInfo{
+                .struct_type = GVOX_STRUCT_TYPE_FILL_INFO,
+                .next = nullptr,
+                .src_data = &voxel_data[i],
+                .src_desc = voxel_desc,
+                .dst = main_container,
+                .range = {
+                    {3, &offsets[i].x},
+                    {3, &extents[i].x},
+                },
+            };
+        }
+        fill(fill_infos);
     }
+    history.clear();
 }
 
 VoxelScene::~VoxelScene() {
+    thread_pool.wait(tree_job);
     gvox_destroy_voxel_desc(voxel_desc);
     gvox_destroy_container(main_container);
 }
+
+auto VoxelScene::memory_stats() const -> BrickMapStats {
+    return brick_map.stats();
+}
+
+void VoxelScene::fill(std::span<GvoxFillInfo const> fills) {
+    auto commands = std::vector<FillCommand>{};
+    auto flush = [&]() {
+        history.begin_edit(brick_map, commands);
+        parallel_fill(thread_pool, brick_map, commands);
+        commands.clear();
+    };
+    for (auto const &fill_info : fills) {
+        if (fill_info.dst != main_container) {
+            flush();
+            gvox_fill(&fill_info);
+            continue;
+        }
+        // The same checks the container's fill callback makes, since the
+        // parallel path reads the voxel directly.
+        if (!is_valid_brick_map_fill(voxel_desc, fill_info.src_data, fill_info.src_desc, fill_info.range)) {
+            std::cerr << "skipped a fill into the scene: it needs one voxel in the scene's voxel description over a 3D range" << std::endl;
+            continue;
+        }
+        commands.push_back(FillCommand{
+            .value = *static_cast<uint32_t const *>(fill_info.src_data),
+            .box = voxel_box_from_range(fill_info.range),
+        });
+    }
+    flush();
+    history.end_edit(brick_map);
+}
+
+auto VoxelScene::undo() -> bool {
+    return history.undo(brick_map);
+}
+
+auto VoxelScene::redo() -> bool {
+    return history.redo(brick_map);
+}
+
+void VoxelScene::load(std::filesystem::path const &path) {
+    loader.reset();
+    brick_map.clear();
+    thread_pool.wait(tree_job);
+    queued_tree_changes.clear();
+    tree = {};
+    history.clear();
+    loader_first_chunk_merged = false;
+    loader = std::make_unique<SceneLoader>(path);
+}
+
+void VoxelScene::update() {
+    if (!loader) {
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    // Merging is cheap per chunk, but a budget keeps a burst of queued
+    // chunks from stretching a single frame.
+    constexpr auto MERGE_BUDGET = std::chrono::milliseconds(2);
+    auto const merge_start = Clock::now();
+    while (Clock::now() - merge_start < MERGE_BUDGET) {
+        auto chunk = loader->poll();
+        if (!chunk) {
+            break;
+        }
+        for (auto &[coord, brick] : chunk->bricks) {
+            brick_map.overlay(coord, std::move(brick));
+        }
+        if (!loader_first_chunk_merged) {
+            loader_first_chunk_merged = true;
+            auto const elapsed = std::chrono::duration<double, std::milli>(Clock::now() - loader->stats().start_time).count();
+            std::cout << "loading " << loader->path.string() << ": first chunk visible after " << elapsed << " ms" << std::endl;
+        }
+    }
+    if (!loader->is_finished()) {
+        return;
+    }
+    if (auto error = loader->error(); !error.empty()) {
+        std::cerr << "loading " << loader->path.string() << " failed: " << error << std::endl;
+    } else {
+        auto const stats = loader->stats();
+        auto const elapsed = std::chrono::duration<double, std::milli>(stats.end_time - stats.start_time).count();
+        std::cout << "loaded " << loader->path.string() << ": " << stats.voxel_count << " voxels in " << stats.chunk_count << " chunks, "
+                  << elapsed << " ms, peak RSS " << (peak_resident_memory_bytes() >> 20) << " MiB" << std::endl;
+    }
+    loader.reset();
+}
+
+void VoxelScene::queue_tree_refit(std::span<BrickCoord const> changed_bricks) {
+    for (auto const &coord : changed_bricks) {
+        auto iter = brick_map.bricks.find(coord);
+        queued_tree_changes.push_back({.coord = coord, .brick = iter != brick_map.bricks.end() ? iter->second : Brick{}});
+    }
+    if (queued_tree_changes.empty() || tree_job.pending.load(std::memory_order_acquire) != 0) {
+        return;
+    }
+    std::swap(tree_job_changes, queued_tree_changes);
+    thread_pool.submit([this]() {
+        tree.refit(thread_pool, tree_job_changes);
+        tree_job_changes.clear();
+    }, &tree_job);
+}
+
+auto VoxelScene::synced_tree() -> Tree64 const & {
+    thread_pool.wait(tree_job);
+    if (!queued_tree_changes.empty()) {
+        tree.refit(thread_pool, queued_tree_changes);
+        queued_tree_changes.clear();
+    }
+    return tree;
+}
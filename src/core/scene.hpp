@@ -2,18 +2,62 @@
 
 #include <gvox/gvox.h>
 
-#include <daxa/daxa.hpp>
-#include <daxa/utils/task_graph.hpp>
+#include <core/brick_map.hpp>
+#include <core/edit_history.hpp>
+#include <core/scene_loader.hpp>
+#include <core/thread_pool.hpp>
+#include <core/tree64.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
 
 struct VoxelScene {
+    ThreadPool &thread_pool;
+    BrickMap brick_map{};
+    Tree64 tree{};
+    EditHistory history{};
     GvoxContainer main_container{};
     GvoxVoxelDesc voxel_desc{};
+    std::unique_ptr<SceneLoader> loader{};
+    bool loader_first_chunk_merged{};
+    // `tree` is refit by one job at a time on the thread pool. Changes are
+    // queued as brick snapshots, so the job never reads `brick_map` while the
+    // render thread edits it.
+    std::vector<Tree64Change> queued_tree_changes{};
+    std::vector<Tree64Change> tree_job_changes{};
+    ThreadPool::TaskGroup tree_job{};
 
-    VoxelScene();
+    explicit VoxelScene(ThreadPool &a_thread_pool);
     ~VoxelScene();
 
     VoxelScene(const VoxelScene &) = delete;
     VoxelScene(VoxelScene &&) = delete;
     auto operator=(const VoxelScene &) -> VoxelScene & = delete;
     auto operator=(VoxelScene &&) -> VoxelScene & = delete;
+
+    // Applies a batch of fills in order. Fills into `main_container` get the
+    // checks its fill callback makes, skipping invalid ones, and are then cut
+    // into brick tiles and run on the thread pool. Anything else is passed
+    // through to `gvox_fill`. Each call is one step in `history`.
+    void fill(std::span<GvoxFillInfo const> fills);
+    auto undo() -> bool;
+    auto redo() -> bool;
+
+    auto memory_stats() const -> BrickMapStats;
+
+    // Replaces the scene contents with the file at `path`. Decoding happens
+    // on a background thread, and `update` merges whatever has been decoded
+    // so far, so the scene fills in progressively.
+    void load(std::filesystem::path const &path);
+    void update();
+
+    // Queues bricks drained from `brick_map`'s dirty set for `tree`, and
+    // starts a refit job with everything queued if none is running. Loads
+    // stream into the tree the same way, through the dirty set.
+    void queue_tree_refit(std::span<BrickCoord const> changed_bricks);
+    // Waits for the refit job and applies what is still queued. `tree` must
+    // not be read any other way while the job may be running.
+    auto synced_tree() -> Tree64 const &;
 };
@@ -0,0 +1,330 @@
+#include <core/scene_loader.hpp>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+    // Voxels decoded per chunk. 64k voxels is 256 KiB of XYZI data, which
+    // keeps the first chunk quick to produce and the queue small.
+    constexpr size_t CHUNK_VOXEL_COUNT = size_t{1} << 16;
+
+    struct ByteReader {
+        std::span<std::byte const> bytes;
+        size_t offset{};
+
+        auto remaining() const -> size_t { return bytes.size() - offset; }
+
+        template <typename T>
+        auto read() -> T {
+            auto result = T{};
+            if (remaining() < sizeof(T)) {
+                offset = bytes.size();
+                return result;
+            }
+            std::memcpy(&result, bytes.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return result;
+        }
+
+        auto read_string() -> std::string_view {
+            auto const length = std::min(static_cast<size_t>(read<uint32_t>()), remaining());
+            auto result = std::string_view{reinterpret_cast<char const *>(bytes.data() + offset), length};
+            offset += length;
+            return result;
+        }
+    };
+
+    using VoxDict = std::unordered_map<std::string_view, std::string_view>;
+
+    auto read_dict(ByteReader &reader) -> VoxDict {
+        auto result = VoxDict{};
+        auto const pair_count = reader.read<uint32_t>();
+        for (uint32_t i = 0; i < pair_count && reader.remaining() != 0; ++i) {
+            auto key = reader.read_string();
+            result[key] = reader.read_string();
+        }
+        return result;
+    }
+
+    struct VoxChunk {
+        std::array<char, 4> id{};
+        uint32_t content_size{};
+        uint32_t children_size{};
+        size_t content_offset{};
+
+        auto is(char const *name) const -> bool { return std::memcmp(id.data(), name, 4) == 0; }
+    };
+
+    auto read_chunk(ByteReader &reader) -> VoxChunk {
+        auto result = VoxChunk{};
+        result.id = reader.read<std::array<char, 4>>();
+        result.content_size = reader.read<uint32_t>();
+        result.children_size = reader.read<uint32_t>();
+        result.content_offset = reader.offset;
+        return result;
+    }
+
+    struct VoxModel {
+        std::array<int32_t, 3> size{};
+        size_t voxel_data_offset{};
+        uint32_t voxel_count{};
+    };
+
+    struct VoxNode {
+        enum class Type { TRANSFORM, GROUP, SHAPE };
+        Type type{};
+        std::array<int32_t, 3> translation{};
+        std::vector<int32_t> children{};
+    };
+
+    struct VoxInstance {
+        uint32_t model_index{};
+        std::array<int32_t, 3> translation{};
+        bool centered{};
+    };
+
+    void collect_instances(std::unordered_map<int32_t, VoxNode> const &nodes, int32_t node_id, std::array<int32_t, 3> translation, std::vector<VoxInstance> &out_instances, uint32_t depth) {
+        auto iter = nodes.find(node_id);
+        // The depth limit guards against cycles in malformed files.
+        if (iter == nodes.end() || depth > 64) {
+            return;
+        }
+        auto const &node = iter->second;
+        switch (node.type) {
+        case VoxNode::Type::TRANSFORM:
+            for (size_t i = 0; i < 3; ++i) {
+                translation[i] += node.translation[i];
+            }
+            for (auto child : node.children) {
+                collect_instances(nodes, child, translation, out_instances, depth + 1);
+            }
+            break;
+        case VoxNode::Type::GROUP:
+            for (auto child : node.children) {
+                collect_instances(nodes, child, translation, out_instances, depth + 1);
+            }
+            break;
+        case VoxNode::Type::SHAPE:
+            for (auto model : node.children) {
+                out_instances.push_back({.model_index = static_cast<uint32_t>(model), .translation = translation, .centered = true});
+            }
+            break;
+        }
+    }
+
+    auto pack_color(uint8_t r, uint8_t g, uint8_t b) -> uint32_t {
+        auto const result = static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) | (static_cast<uint32_t>(b) << 16);
+        // 0 means empty in the scene, so pure black is nudged up by one step.
+        return result != 0 ? result : 0x00010101;
+    }
+} // namespace
+
+SceneLoader::SceneLoader(std::filesystem::path a_path)
+    : path{std::move(a_path)} {
+    load_stats.start_time = std::chrono::steady_clock::now();
+    thread = std::jthread([this](std::stop_token const &stop_token) { decode(stop_token); });
+}
+
+SceneLoader::~SceneLoader() {
+    // A `push` blocked on a full queue wakes up through its stop token.
+    thread.request_stop();
+}
+
+auto SceneLoader::poll() -> std::optional<LoadedChunk> {
+    auto lock = std::lock_guard{mutex};
+    if (queue.empty()) {
+        return std::nullopt;
+    }
+    auto result = std::move(queue.front());
+    queue.pop_front();
+    queue_cv.notify_all();
+    return result;
+}
+
+auto SceneLoader::is_finished() -> bool {
+    auto lock = std::lock_guard{mutex};
+    return decode_done && queue.empty();
+}
+
+auto SceneLoader::error() -> std::string {
+    auto lock = std::lock_guard{mutex};
+    return error_message;
+}
+
+auto SceneLoader::stats() -> SceneLoadStats {
+    auto lock = std::lock_guard{mutex};
+    return load_stats;
+}
+
+auto SceneLoader::push(LoadedChunk &&chunk, std::stop_token const &stop_token) -> bool {
+    auto lock = std::unique_lock{mutex};
+    if (!queue_cv.wait(lock, stop_token, [&]() { return queue.size() < MAX_QUEUED_CHUNKS; })) {
+        return false;
+    }
+    load_stats.voxel_count += chunk.voxel_count;
+    ++load_stats.chunk_count;
+    queue.push_back(std::move(chunk));
+    return true;
+}
+
+void SceneLoader::decode(std::stop_token const &stop_token) {
+    auto file = MappedFile(path);
+    auto fail = [&](std::string message) {
+        auto lock = std::lock_guard{mutex};
+        error_message = std::move(message);
+    };
+    if (!file.is_open()) {
+        fail("failed to open " + path.string());
+    } else {
+        {
+            auto lock = std::lock_guard{mutex};
+            load_stats.file_bytes = file.size;
+        }
+        file.advise_sequential();
+        auto const extension = path.extension();
+        if (extension == ".vox") {
+            decode_vox(file, stop_token);
+        } else if (extension == ".gvox") {
+            fail("loading .gvox scenes is not supported yet, only MagicaVoxel .vox");
+        } else {
+            fail("unsupported scene format " + extension.string());
+        }
+    }
+    auto lock = std::lock_guard{mutex};
+    decode_done = true;
+    load_stats.end_time = std::chrono::steady_clock::now();
+}
+
+void SceneLoader::decode_vox(MappedFile const &file, std::stop_token const &stop_token) {
+    auto reader = ByteReader{.bytes = file.bytes()};
+    if (reader.read<std::array<char, 4>>() != std::array{'V', 'O', 'X', ' '}) {
+        auto lock = std::lock_guard{mutex};
+        error_message = "not a MagicaVoxel file";
+        return;
+    }
+    reader.read<uint32_t>(); // version
+    auto const main_chunk = read_chunk(reader);
+    reader.offset = main_chunk.content_offset + main_chunk.content_size;
+
+    // First walk only the chunk headers. The palette comes after the voxel
+    // data in the file, and the scene graph decides where models go, so both
+    // are needed before any voxels can be decoded. Skipping the XYZI payloads
+    // here means this pass touches very little of the mapping.
+    auto models = std::vector<VoxModel>{};
+    auto nodes = std::unordered_map<int32_t, VoxNode>{};
+    auto palette = std::array<uint32_t, 256>{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        auto const gray = static_cast<uint8_t>(i);
+        palette[i] = pack_color(gray, gray, gray);
+    }
+    auto const children_end = std::min(reader.offset + main_chunk.children_size, file.size);
+    while (reader.offset + 12 <= children_end) {
+        auto const chunk = read_chunk(reader);
+        auto content = ByteReader{.bytes = file.bytes().subspan(chunk.content_offset, std::min(static_cast<size_t>(chunk.content_size), file.size - chunk.content_offset))};
+        if (chunk.is("SIZE")) {
+            auto &model = models.emplace_back();
+            for (auto &axis : model.size) {
+                axis = content.read<int32_t>();
+            }
+        } else if (chunk.is("XYZI") && !models.empty()) {
+            auto &model = models.back();
+            model.voxel_count = static_cast<uint32_t>(std::min(static_cast<size_t>(content.read<uint32_t>()), content.remaining() / 4));
+            model.voxel_data_offset = chunk.content_offset + content.offset;
+        } else if (chunk.is("RGBA")) {
+            // Color index i uses palette entry i - 1, and index 0 is never used.
+            for (size_t i = 1; i < 256; ++i) {
+                auto const rgba = content.read<std::array<uint8_t, 4>>();
+                palette[i] = pack_color(rgba[0], rgba[1], rgba[2]);
+            }
+        } else if (chunk.is("nTRN")) {
+            auto node = VoxNode{.type = VoxNode::Type::TRANSFORM};
+            auto const node_id = content.read<int32_t>();
+            read_dict(content);
+            node.children.push_back(content.read<int32_t>());
+            content.read<int32_t>(); // reserved
+            content.read<int32_t>(); // layer
+            if (content.read<uint32_t>() != 0) {
+                auto const frame = read_dict(content);
+                if (auto iter = frame.find("_t"); iter != frame.end()) {
+                    auto const t = std::string{iter->second};
+                    std::sscanf(t.c_str(), "%d %d %d", &node.translation[0], &node.translation[1], &node.translation[2]);
+                }
+            }
+            nodes[node_id] = std::move(node);
+        } else if (chunk.is("nGRP") || chunk.is("nSHP")) {
+            auto node = VoxNode{.type = chunk.is("nGRP") ? VoxNode::Type::GROUP : VoxNode::Type::SHAPE};
+            auto const node_id = content.read<int32_t>();
+            read_dict(content);
+            auto const child_count = content.read<uint32_t>();
+            for (uint32_t i = 0; i < child_count && content.remaining() != 0; ++i) {
+                node.children.push_back(content.read<int32_t>());
+                if (node.type == VoxNode::Type::SHAPE) {
+                    read_dict(content);
+                }
+            }
+            nodes[node_id] = std::move(node);
+        }
+        reader.offset = chunk.content_offset + chunk.content_size + chunk.children_size;
+    }
+
+    auto instances = std::vector<VoxInstance>{};
+    if (nodes.empty()) {
+        // Files without a scene graph just stack every model at the origin.
+        for (uint32_t i = 0; i < models.size(); ++i) {
+            instances.push_back({.model_index = i});
+        }
+    } else {
+        collect_instances(nodes, 0, {}, instances, 0);
+    }
+
+    for (auto const &instance : instances) {
+        if (instance.model_index >= models.size()) {
+            continue;
+        }
+        auto const &model = models[instance.model_index];
+        auto origin = instance.translation;
+        if (instance.centered) {
+            for (size_t i = 0; i < 3; ++i) {
+                origin[i] -= model.size[i] / 2;
+            }
+        }
+        for (size_t first_voxel = 0; first_voxel < model.voxel_count; first_voxel += CHUNK_VOXEL_COUNT) {
+            auto const slice_count = std::min(CHUNK_VOXEL_COUNT, model.voxel_count - first_voxel);
+            auto const slice_offset = model.voxel_data_offset + first_voxel * 4;
+            auto const slice = file.bytes().subspan(slice_offset, slice_count * 4);
+
+            auto bricks = std::unordered_map<BrickCoord, Brick, BrickCoordHash>{};
+            for (size_t i = 0; i < slice_count; ++i) {
+                auto const *voxel = reinterpret_cast<uint8_t const *>(slice.data() + i * 4);
+                auto const x = origin[0] + voxel[0];
+                auto const y = origin[1] + voxel[1];
+                auto const z = origin[2] + voxel[2];
+                auto &brick = bricks[BrickMap::brick_coord_of(x, y, z)];
+                if (brick.is_uniform()) {
+                    brick.data = std::make_shared<VoxelBrick>();
+                }
+                constexpr auto BRICK_MASK = VoxelBrick::SIZE - 1;
+                brick.mutable_data().voxels[VoxelBrick::index(x & BRICK_MASK, y & BRICK_MASK, z & BRICK_MASK)] = palette[voxel[3]];
+            }
+            file.release_range(slice_offset, slice.size());
+
+            auto chunk = LoadedChunk{.voxel_count = slice_count};
+            chunk.bricks.reserve(bricks.size());
+            for (auto &[coord, brick] : bricks) {
+                BrickMap::try_collapse(brick);
+                chunk.bricks.emplace_back(coord, std::move(brick));
+            }
+            {
+                auto lock = std::lock_guard{mutex};
+                load_stats.decoded_bytes += slice.size();
+            }
+            if (!push(std::move(chunk), stop_token)) {
+                return;
+            }
+        }
+    }
+}
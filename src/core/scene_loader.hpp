@@ -0,0 +1,73 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/platform.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A batch of decoded bricks, ready to be merged into the scene.
+struct LoadedChunk {
+    std::vector<std::pair<BrickCoord, Brick>> bricks{};
+    uint64_t voxel_count{};
+};
+
+struct SceneLoadStats {
+    uint64_t file_bytes{};
+    uint64_t decoded_bytes{};
+    uint64_t voxel_count{};
+    uint64_t chunk_count{};
+    std::chrono::steady_clock::time_point start_time{};
+    std::chrono::steady_clock::time_point end_time{};
+};
+
+// Memory-maps a voxel file and decodes it on a background thread. Decoded
+// chunks are queued until the owner picks them up with `poll`, so nothing
+// outside the loader thread is touched while decoding. The queue is bounded,
+// which keeps memory flat when decoding outruns the consumer.
+//
+// Supported formats: MagicaVoxel (.vox). Native .gvox files are not decoded
+// yet and fail with an error saying so.
+class SceneLoader {
+  public:
+    explicit SceneLoader(std::filesystem::path path);
+    ~SceneLoader();
+    SceneLoader(const SceneLoader &) = delete;
+    SceneLoader(SceneLoader &&) = delete;
+    auto operator=(const SceneLoader &) -> SceneLoader & = delete;
+    auto operator=(SceneLoader &&) -> SceneLoader & = delete;
+
+    auto poll() -> std::optional<LoadedChunk>;
+    // True once decoding has ended and every chunk has been polled.
+    auto is_finished() -> bool;
+    auto error() -> std::string;
+    auto stats() -> SceneLoadStats;
+
+    std::filesystem::path const path;
+
+  private:
+    static inline constexpr size_t MAX_QUEUED_CHUNKS = 16;
+
+    std::mutex mutex{};
+    // Waits on the decode thread's stop token as well, so cancelling can't
+    // slip in between its predicate check and going to sleep.
+    std::condition_variable_any queue_cv{};
+    std::deque<LoadedChunk> queue{};
+    bool decode_done{};
+    std::string error_message{};
+    SceneLoadStats load_stats{};
+    std::jthread thread{};
+
+    void decode(std::stop_token const &stop_token);
+    void decode_vox(MappedFile const &file, std::stop_token const &stop_token);
+    // Blocks while the queue is full. Returns false if the load was cancelled.
+    auto push(LoadedChunk &&chunk, std::stop_token const &stop_token) -> bool;
+};
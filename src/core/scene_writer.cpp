@@ -0,0 +1,213 @@
+#include <core/scene_writer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    constexpr int32_t MODEL_SIZE_LOG2 = 8;
+    constexpr int32_t MODEL_SIZE = 1 << MODEL_SIZE_LOG2;
+    constexpr size_t MAX_PALETTE_COLORS = 255;
+
+    struct ByteWriter {
+        std::vector<char> bytes{};
+
+        template <typename T>
+        void write(T const &value) {
+            auto const offset = bytes.size();
+            bytes.resize(offset + sizeof(T));
+            std::memcpy(bytes.data() + offset, &value, sizeof(T));
+        }
+
+        void write_string(std::string const &value) {
+            write(static_cast<uint32_t>(value.size()));
+            bytes.insert(bytes.end(), value.begin(), value.end());
+        }
+
+        void write_chunk(char const *id, ByteWriter const &content) {
+            bytes.insert(bytes.end(), id, id + 4);
+            write(static_cast<uint32_t>(content.bytes.size()));
+            write(uint32_t{0});
+            bytes.insert(bytes.end(), content.bytes.begin(), content.bytes.end());
+        }
+    };
+
+    // Palette index (1-255) for each color, either exact or quantized.
+    struct Palette {
+        std::unordered_map<uint32_t, uint8_t> exact_indices{};
+        bool quantized{};
+        std::array<uint32_t, 256> colors{};
+
+        explicit Palette(BrickMap const &brick_map) {
+            auto add = [&](uint32_t color) {
+                if (quantized || exact_indices.contains(color)) {
+                    return;
+                }
+                if (exact_indices.size() == MAX_PALETTE_COLORS) {
+                    quantized = true;
+                    return;
+                }
+                auto const index = static_cast<uint8_t>(exact_indices.size() + 1);
+                exact_indices.emplace(color, index);
+                colors[index] = color;
+            };
+            for (auto const &[coord, brick] : brick_map.bricks) {
+                if (brick.is_uniform()) {
+                    add(brick.uniform_value);
+                    continue;
+                }
+                for (auto voxel : brick.data->voxels) {
+                    if (voxel != 0) {
+                        add(voxel);
+                    }
+                }
+                if (quantized) {
+                    break;
+                }
+            }
+            if (quantized) {
+                for (uint32_t q = 0; q < MAX_PALETTE_COLORS; ++q) {
+                    auto const r = ((q & 0x7) * 255) / 7;
+                    auto const g = (((q >> 3) & 0x7) * 255) / 7;
+                    auto const b = (((q >> 6) & 0x3) * 255) / 3;
+                    colors[q + 1] = r | (g << 8) | (b << 16);
+                }
+            }
+        }
+
+        auto index_of(uint32_t color) const -> uint8_t {
+            if (!quantized) {
+                return exact_indices.at(color);
+            }
+            auto const q = ((color & 0xff) >> 5) | (((color >> 8) & 0xff) >> 5 << 3) | (((color >> 16) & 0xff) >> 6 << 6);
+            // White (q = 255) shares the last slot with its neighbour.
+            return static_cast<uint8_t>(std::min(q, static_cast<uint32_t>(MAX_PALETTE_COLORS - 1)) + 1);
+        }
+    };
+
+    struct ModelCoordLess {
+        auto operator()(BrickCoord const &a, BrickCoord const &b) const -> bool {
+            return std::tie(a.z, a.y, a.x) < std::tie(b.z, b.y, b.x);
+        }
+    };
+} // namespace
+
+auto save_vox(BrickMap const &brick_map, std::filesystem::path const &path) -> std::string {
+    auto const palette = Palette(brick_map);
+
+    // XYZI payloads per 256^3 model, keyed by model coordinate.
+    auto models = std::map<BrickCoord, std::vector<std::array<uint8_t, 4>>, ModelCoordLess>{};
+    constexpr auto BRICKS_PER_MODEL_LOG2 = MODEL_SIZE_LOG2 - VoxelBrick::SIZE_LOG2;
+    for (auto const &[coord, brick] : brick_map.bricks) {
+        auto &voxels = models[{coord.x >> BRICKS_PER_MODEL_LOG2, coord.y >> BRICKS_PER_MODEL_LOG2, coord.z >> BRICKS_PER_MODEL_LOG2}];
+        for (int32_t z = 0; z < VoxelBrick::SIZE; ++z) {
+            for (int32_t y = 0; y < VoxelBrick::SIZE; ++y) {
+                for (int32_t x = 0; x < VoxelBrick::SIZE; ++x) {
+                    auto const color = brick.get(VoxelBrick::index(x, y, z));
+                    if (color == 0) {
+                        continue;
+                    }
+                    constexpr auto MODEL_MASK = MODEL_SIZE - 1;
+                    voxels.push_back({
+                        static_cast<uint8_t>((coord.x * VoxelBrick::SIZE + x) & MODEL_MASK),
+                        static_cast<uint8_t>((coord.y * VoxelBrick::SIZE + y) & MODEL_MASK),
+                        static_cast<uint8_t>((coord.z * VoxelBrick::SIZE + z) & MODEL_MASK),
+                        palette.index_of(color),
+                    });
+                }
+            }
+        }
+    }
+
+    auto children = ByteWriter{};
+    for (auto const &[model_coord, voxels] : models) {
+        auto size = ByteWriter{};
+        for (size_t i = 0; i < 3; ++i) {
+            size.write(MODEL_SIZE);
+        }
+        children.write_chunk("SIZE", size);
+        auto xyzi = ByteWriter{};
+        xyzi.write(static_cast<uint32_t>(voxels.size()));
+        for (auto const &voxel : voxels) {
+            xyzi.write(voxel);
+        }
+        children.write_chunk("XYZI", xyzi);
+    }
+
+    // Scene graph: root transform 0 -> group 1 -> (transform -> shape) per
+    // model. Shapes are centered on their transform's translation.
+    auto const model_count = static_cast<int32_t>(models.size());
+    {
+        auto root = ByteWriter{};
+        root.write(int32_t{0});
+        root.write(uint32_t{0});
+        root.write(int32_t{1});
+        root.write(int32_t{-1});
+        root.write(int32_t{-1});
+        root.write(uint32_t{0});
+        children.write_chunk("nTRN", root);
+        auto group = ByteWriter{};
+        group.write(int32_t{1});
+        group.write(uint32_t{0});
+        group.write(static_cast<uint32_t>(model_count));
+        for (int32_t i = 0; i < model_count; ++i) {
+            group.write(2 + i * 2);
+        }
+        children.write_chunk("nGRP", group);
+    }
+    auto model_index = int32_t{};
+    for (auto const &[model_coord, voxels] : models) {
+        auto const transform_id = 2 + model_index * 2;
+        auto transform = ByteWriter{};
+        transform.write(transform_id);
+        transform.write(uint32_t{0});
+        transform.write(transform_id + 1);
+        transform.write(int32_t{-1});
+        transform.write(int32_t{-1});
+        transform.write(uint32_t{1});
+        transform.write(uint32_t{1});
+        transform.write_string("_t");
+        transform.write_string(std::to_string(model_coord.x * MODEL_SIZE + MODEL_SIZE / 2) + " " +
+                               std::to_string(model_coord.y * MODEL_SIZE + MODEL_SIZE / 2) + " " +
+                               std::to_string(model_coord.z * MODEL_SIZE + MODEL_SIZE / 2));
+        children.write_chunk("nTRN", transform);
+        auto shape = ByteWriter{};
+        shape.write(transform_id + 1);
+        shape.write(uint32_t{0});
+        shape.write(uint32_t{1});
+        shape.write(model_index);
+        shape.write(uint32_t{0});
+        children.write_chunk("nSHP", shape);
+        ++model_index;
+    }
+
+    auto rgba = ByteWriter{};
+    for (size_t i = 1; i <= 256; ++i) {
+        auto const color = i < palette.colors.size() ? palette.colors[i] : 0u;
+        rgba.write(color | 0xff000000u);
+    }
+    children.write_chunk("RGBA", rgba);
+
+    auto file_bytes = ByteWriter{};
+    file_bytes.bytes.insert(file_bytes.bytes.end(), {'V', 'O', 'X', ' '});
+    file_bytes.write(uint32_t{150});
+    file_bytes.bytes.insert(file_bytes.bytes.end(), {'M', 'A', 'I', 'N'});
+    file_bytes.write(uint32_t{0});
+    file_bytes.write(static_cast<uint32_t>(children.bytes.size()));
+    file_bytes.bytes.insert(file_bytes.bytes.end(), children.bytes.begin(), children.bytes.end());
+
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file) {
+        return "failed to open " + path.string();
+    }
+    file.write(file_bytes.bytes.data(), static_cast<std::streamsize>(file_bytes.bytes.size()));
+    if (!file) {
+        return "failed to write " + path.string();
+    }
+    return {};
+}
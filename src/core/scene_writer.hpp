@@ -0,0 +1,12 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+
+#include <filesystem>
+#include <string>
+
+// Writes `brick_map` as a MagicaVoxel (.vox) file that SceneLoader reads back
+// to the same voxels. The scene is cut into 256^3 models placed by the scene
+// graph. The format has a 255-color palette, so scenes with more colors are
+// quantized to 3-3-2 bit RGB. Returns an error message, empty on success.
+auto save_vox(BrickMap const &brick_map, std::filesystem::path const &path) -> std::string;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Fixed-size records addressed by a stable 1-based id, so 0 can stand for
+// "none". Records live in chunks that never move, and freed slots are
+// chained into an intrusive free list, so inserting and erasing only touch
+// the heap when every chunk is full.
+template <typename T, size_t CHUNK_SIZE = 256>
+class Slab {
+  public:
+    auto insert(T value) -> size_t {
+        if (free_head == 0) {
+            auto &chunk = chunks.emplace_back(std::make_unique<std::array<Slot, CHUNK_SIZE>>());
+            auto const first_id = (chunks.size() - 1) * CHUNK_SIZE + 1;
+            for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                (*chunk)[i].next_free = i + 1 < CHUNK_SIZE ? first_id + i + 1 : 0;
+            }
+            free_head = first_id;
+        }
+        auto const id = free_head;
+        auto &slot = slot_at(id);
+        free_head = slot.next_free;
+        slot.value = std::move(value);
+        slot.occupied = true;
+        return id;
+    }
+
+    void erase(size_t id) {
+        auto &slot = slot_at(id);
+        assert(slot.occupied);
+        slot.value = T{};
+        slot.occupied = false;
+        slot.next_free = free_head;
+        free_head = id;
+    }
+
+    auto contains(size_t id) const -> bool {
+        return id != 0 && id <= chunks.size() * CHUNK_SIZE && slot_at(id).occupied;
+    }
+
+    auto operator[](size_t id) -> T & { return slot_at(id).value; }
+    auto operator[](size_t id) const -> T const & { return slot_at(id).value; }
+
+    template <typename F>
+    void for_each(F &&f) const {
+        for (auto const &chunk : chunks) {
+            for (auto const &slot : *chunk) {
+                if (slot.occupied) {
+                    f(slot.value);
+                }
+            }
+        }
+    }
+
+  private:
+    struct Slot {
+        T value{};
+        size_t next_free{};
+        bool occupied{};
+    };
+
+    std::vector<std::unique_ptr<std::array<Slot, CHUNK_SIZE>>> chunks{};
+    size_t free_head{};
+
+    auto slot_at(size_t id) -> Slot & { return (*chunks[(id - 1) / CHUNK_SIZE])[(id - 1) % CHUNK_SIZE]; }
+    auto slot_at(size_t id) const -> Slot const & { return (*chunks[(id - 1) / CHUNK_SIZE])[(id - 1) % CHUNK_SIZE]; }
+};
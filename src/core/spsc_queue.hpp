@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Pushing to a full queue fails instead of blocking, so the producer
+// never waits on the consumer.
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+  public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue(SpscQueue &&) = delete;
+    auto operator=(const SpscQueue &) -> SpscQueue & = delete;
+    auto operator=(SpscQueue &&) -> SpscQueue & = delete;
+
+    // Producer only.
+    auto try_push(T const &value) -> bool {
+        auto const tail_index = tail.load(std::memory_order_relaxed);
+        if (tail_index - head.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        slots[tail_index & (CAPACITY - 1)] = value;
+        tail.store(tail_index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    auto try_pop() -> std::optional<T> {
+        auto const head_index = head.load(std::memory_order_relaxed);
+        if (head_index == tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        auto value = std::optional<T>{slots[head_index & (CAPACITY - 1)]};
+        head.store(head_index + 1, std::memory_order_release);
+        return value;
+    }
+
+  private:
+    std::array<T, CAPACITY> slots{};
+    // On separate cache lines, each is written by one side only.
+    alignas(64) std::atomic<size_t> head{};
+    alignas(64) std::atomic<size_t> tail{};
+};
@@ -0,0 +1,71 @@
+#include <core/startup_profiler.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+StartupProfiler::StartupProfiler()
+    : start_time{Clock::now()} {
+}
+
+auto StartupProfiler::now_ms() const -> double {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+}
+
+auto StartupProfiler::begin_phase(std::string_view name) -> size_t {
+    phase_list.push_back({.name = std::string{name}, .start_ms = now_ms(), .depth = current_depth});
+    ++current_depth;
+    return phase_list.size() - 1;
+}
+
+void StartupProfiler::end_phase(size_t phase_index) {
+    auto &phase = phase_list[phase_index];
+    phase.ms = now_ms() - phase.start_ms;
+    --current_depth;
+}
+
+void StartupProfiler::mark(std::string_view name) {
+    if (milestone_ms(name)) {
+        return;
+    }
+    milestones.push_back({.name = std::string{name}, .ms = now_ms()});
+}
+
+auto StartupProfiler::milestone_ms(std::string_view name) const -> std::optional<double> {
+    auto const iter = std::find_if(milestones.begin(), milestones.end(), [&](StartupMilestone const &milestone) { return milestone.name == name; });
+    if (iter == milestones.end()) {
+        return std::nullopt;
+    }
+    return iter->ms;
+}
+
+void StartupProfiler::print() const {
+    std::printf("Startup:\n");
+    for (auto const &phase : phase_list) {
+        auto const indent = static_cast<int>(phase.depth * 2 + 2);
+        std::printf("%*s%-*s %8.2f ms\n", indent, "", std::max(32 - indent, 0), phase.name.c_str(), phase.ms);
+    }
+    for (auto const &milestone : milestones) {
+        std::printf("  %-30s at %8.2f ms\n", milestone.name.c_str(), milestone.ms);
+    }
+    std::fflush(stdout);
+}
+
+auto StartupProfiler::write_json(std::filesystem::path const &path) const -> bool {
+    auto *file = std::fopen(path.string().c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    // Names are ours, none of them need escaping.
+    std::fprintf(file, "{\n  \"phases\": [");
+    for (size_t i = 0; i < phase_list.size(); ++i) {
+        auto const &phase = phase_list[i];
+        std::fprintf(file, "%s\n    {\"name\": \"%s\", \"start_ms\": %.3f, \"ms\": %.3f, \"depth\": %u}",
+                     i == 0 ? "" : ",", phase.name.c_str(), phase.start_ms, phase.ms, phase.depth);
+    }
+    std::fprintf(file, "\n  ],\n  \"milestones\": [");
+    for (size_t i = 0; i < milestones.size(); ++i) {
+        std::fprintf(file, "%s\n    {\"name\": \"%s\", \"ms\": %.3f}", i == 0 ? "" : ",", milestones[i].name.c_str(), milestones[i].ms);
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+    return std::fclose(file) == 0;
+}
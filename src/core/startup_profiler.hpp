@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct StartupPhase {
+    std::string name{};
+    // Milliseconds since the profiler was created.
+    double start_ms{};
+    double ms{};
+    // Phases started inside another phase are nested one level deeper.
+    uint32_t depth{};
+};
+
+struct StartupMilestone {
+    std::string name{};
+    double ms{};
+};
+
+// Times the phases of startup, and milestones like the first presented
+// frame, relative to when it was created. Not thread-safe: phases come
+// from the thread constructing the app, milestones from whichever thread
+// reaches them, but never at the same time.
+class StartupProfiler {
+  public:
+    StartupProfiler();
+    ~StartupProfiler() = default;
+    StartupProfiler(const StartupProfiler &) = delete;
+    StartupProfiler(StartupProfiler &&) = delete;
+    auto operator=(const StartupProfiler &) -> StartupProfiler & = delete;
+    auto operator=(StartupProfiler &&) -> StartupProfiler & = delete;
+
+    auto begin_phase(std::string_view name) -> size_t;
+    void end_phase(size_t phase_index);
+    // Times `function` as a phase and returns its result, which makes it
+    // usable in member initializer lists.
+    template <typename F>
+    auto time(std::string_view name, F &&function) -> decltype(function()) {
+        struct Scope {
+            StartupProfiler &profiler;
+            size_t phase_index;
+            ~Scope() { profiler.end_phase(phase_index); }
+        } scope{*this, begin_phase(name)};
+        return function();
+    }
+
+    // Records the first time `name` is reached, later calls are ignored.
+    void mark(std::string_view name);
+    auto milestone_ms(std::string_view name) const -> std::optional<double>;
+
+    auto phases() const -> std::vector<StartupPhase> const & { return phase_list; }
+    void print() const;
+    auto write_json(std::filesystem::path const &path) const -> bool;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start_time{};
+    std::vector<StartupPhase> phase_list{};
+    std::vector<StartupMilestone> milestones{};
+    uint32_t current_depth{};
+
+    auto now_ms() const -> double;
+};
+
+// Times one phase for as long as it is alive.
+struct StartupPhaseScope {
+    StartupProfiler &profiler;
+    size_t phase_index;
+
+    StartupPhaseScope(StartupProfiler &a_profiler, std::string_view name)
+        : profiler{a_profiler}, phase_index{profiler.begin_phase(name)} {}
+    ~StartupPhaseScope() {
+        profiler.end_phase(phase_index);
+    }
+    StartupPhaseScope(const StartupPhaseScope &) = delete;
+    StartupPhaseScope(StartupPhaseScope &&) = delete;
+    auto operator=(const StartupPhaseScope &) -> StartupPhaseScope & = delete;
+    auto operator=(StartupPhaseScope &&) -> StartupPhaseScope & = delete;
+};
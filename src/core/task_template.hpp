@@ -1,6 +1,13 @@
 #pragma once
 
 #include <core/core.inl>
+#include <core/thread_pool.hpp>
+#include <renderer/frame_profiler.hpp>
+#include <renderer/shader_cache.hpp>
+
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
 
 template <typename T>
 struct TaskStatePushConstantSize {
@@ -12,16 +19,61 @@ struct TaskStatePushConstantSize<void> {
     static inline constexpr size_t SIZE = 0;
 };
 
+// Tasks without compile-time variants have the one empty permutation.
+struct NoTaskPermutation {
+    auto key() const -> uint64_t { return 0; }
+    auto defines() const -> std::vector<daxa::ShaderDefine> { return {}; }
+};
+
+// A TaskImpl can declare `using Permutation = ...;`, a set of flags that
+// become shader defines, plus a `Permutation const *permutation` in its
+// `Self` to pick one at dispatch. The permutation type needs `key()`, unique
+// per flag combination, and `defines()`.
+template <typename TaskImplT>
+struct TaskPermutationOf {
+    using Type = NoTaskPermutation;
+};
+
+template <typename TaskImplT>
+    requires requires { typename TaskImplT::Permutation; }
+struct TaskPermutationOf<TaskImplT> {
+    using Type = TaskImplT::Permutation;
+};
+
 template <typename TaskImplT>
 struct TaskStateTemplate {
-    daxa::PipelineManager &pipeline_manager;
-    std::shared_ptr<daxa::ComputePipeline> pipeline{};
     using Self = TaskImplT::Self;
     using PushConstant = TaskImplT::PushConstant;
+    using Permutation = TaskPermutationOf<TaskImplT>::Type;
+
+    // Compiles are numbered, so a slow compile of an older source never
+    // replaces a newer one.
+    struct PipelineEntry {
+        Permutation permutation{};
+        std::shared_ptr<daxa::ComputePipeline> pipeline{};
+        uint64_t generation{};
+    };
+
+    daxa::PipelineManager &pipeline_manager;
+    ShaderCache &shader_cache;
+    ThreadPool &thread_pool;
+    ThreadPool::TaskGroup compile_tasks{};
+    // Each permutation compiles on the thread pool the first time it's
+    // used, and is kept by key from then on. An entry without a pipeline is
+    // still compiling, or failed to.
+    std::mutex pipelines_mutex{};
+    std::unordered_map<uint64_t, PipelineEntry> pipelines{};
+    // Finished compiles, swapped in by `apply_compiled_pipelines`.
+    std::unordered_map<uint64_t, PipelineEntry> compiled_pipelines{};
+    uint64_t next_generation = 1;
+    // Dispatched while the requested permutation is still compiling.
+    std::shared_ptr<daxa::ComputePipeline> last_pipeline{};
 
-    void compile_pipeline() {
+    void compile_pipeline(Permutation const &permutation, uint64_t generation) {
         auto defines = TaskImplT::get_defines();
-        auto compile_result = pipeline_manager.add_compute_pipeline({
+        auto permutation_defines = permutation.defines();
+        defines.insert(defines.end(), permutation_defines.begin(), permutation_defines.end());
+        auto compile_result = shader_cache.add_compute_pipeline(pipeline_manager, {
             .shader_info = {
                 .source = daxa::ShaderFile{TaskImplT::SHADER_FILE},
                 .compile_options = {.defines = defines},
@@ -30,22 +82,110 @@ struct TaskStateTemplate {
             .name = TaskImplT::name,
         });
         if (compile_result.is_err() || !compile_result.value()->is_valid()) {
+            // Whatever pipeline the permutation had keeps running.
             std::cerr << compile_result.message() << std::endl;
             return;
         }
-        pipeline = compile_result.value();
+        auto lock = std::lock_guard{pipelines_mutex};
+        auto &compiled = compiled_pipelines[permutation.key()];
+        if (generation > compiled.generation) {
+            release_pipeline(compiled.pipeline);
+            compiled = {.permutation = permutation, .pipeline = compile_result.value(), .generation = generation};
+        } else {
+            release_pipeline(compile_result.value());
+        }
+    }
+
+    // Drops a pipeline that lost to a newer one from the PipelineManager, or
+    // every reload would add to what it keeps and recompiles. Frames in
+    // flight hold their own reference.
+    void release_pipeline(std::shared_ptr<daxa::ComputePipeline> const &replaced) {
+        if (replaced) {
+            shader_cache.remove_compute_pipeline(pipeline_manager, replaced);
+        }
+    }
+
+    // Looks up the permutation's pipeline, starting its compile if it's the
+    // first time it's asked for.
+    auto pipeline(Permutation const &permutation) -> std::shared_ptr<daxa::ComputePipeline> {
+        auto lock = std::lock_guard{pipelines_mutex};
+        auto [iter, inserted] = pipelines.try_emplace(permutation.key());
+        if (inserted) {
+            iter->second.permutation = permutation;
+            auto const generation = next_generation++;
+            thread_pool.submit([this, permutation, generation]() { compile_pipeline(permutation, generation); }, &compile_tasks);
+        }
+        return iter->second.pipeline;
+    }
+
+    // The default permutation starts compiling right away, so the first
+    // frames can present before it's ready. Until then the task records
+    // nothing.
+    TaskStateTemplate(daxa::PipelineManager &a_pipeline_manager, ShaderCache &a_shader_cache, ThreadPool &a_thread_pool)
+        : pipeline_manager{a_pipeline_manager}, shader_cache{a_shader_cache}, thread_pool{a_thread_pool} {
+        pipeline(Permutation{});
+    }
+    ~TaskStateTemplate() {
+        thread_pool.wait(compile_tasks);
+    }
+
+    TaskStateTemplate(const TaskStateTemplate &) = delete;
+    TaskStateTemplate(TaskStateTemplate &&) = delete;
+    auto operator=(const TaskStateTemplate &) -> TaskStateTemplate & = delete;
+    auto operator=(TaskStateTemplate &&) -> TaskStateTemplate & = delete;
+
+    // Recompiles every permutation used so far, in the background, after
+    // the shader sources changed.
+    void reload() {
+        auto lock = std::lock_guard{pipelines_mutex};
+        for (auto const &[key, entry] : pipelines) {
+            auto const permutation = entry.permutation;
+            auto const generation = next_generation++;
+            thread_pool.submit([this, permutation, generation]() { compile_pipeline(permutation, generation); }, &compile_tasks);
+        }
+    }
+
+    // Swaps in the pipelines that finished compiling, and returns whether
+    // there were any. Call between frames, so a frame never mixes pipelines
+    // built from different sources.
+    auto apply_compiled_pipelines() -> bool {
+        auto lock = std::lock_guard{pipelines_mutex};
+        auto applied = false;
+        for (auto &[key, compiled] : compiled_pipelines) {
+            auto &entry = pipelines[key];
+            if (compiled.generation > entry.generation) {
+                release_pipeline(entry.pipeline);
+                entry = std::move(compiled);
+                applied = true;
+            } else {
+                release_pipeline(compiled.pipeline);
+            }
+        }
+        compiled_pipelines.clear();
+        return applied;
     }
 
-    TaskStateTemplate(daxa::PipelineManager &a_pipeline_manager)
-        : pipeline_manager{a_pipeline_manager} {
-        compile_pipeline();
+    // Whether every requested compile has finished, successfully or not,
+    // and been applied.
+    auto is_compiled() -> bool {
+        auto lock = std::lock_guard{pipelines_mutex};
+        return compile_tasks.pending.load(std::memory_order_acquire) == 0 && compiled_pipelines.empty();
     }
 
     void record_commands(daxa::TaskInterface const &ti, daxa::CommandRecorder &recorder, Self &self) {
-        if (!pipeline || !*pipeline || !pipeline->is_valid()) {
+        auto current_pipeline = std::shared_ptr<daxa::ComputePipeline>{};
+        if constexpr (requires { self.permutation; }) {
+            current_pipeline = pipeline(*self.permutation);
+        } else {
+            current_pipeline = pipeline(Permutation{});
+        }
+        if (current_pipeline && *current_pipeline && current_pipeline->is_valid()) {
+            last_pipeline = current_pipeline;
+        }
+        if (!last_pipeline) {
             return;
         }
-        recorder.set_pipeline(*pipeline);
+        recorder.set_pipeline(*last_pipeline);
         TaskImplT::dispatch(ti, recorder, self);
     }
 };
@@ -55,8 +195,10 @@ struct TaskTemplate : TaskImplT::Uses {
     TaskStateTemplate<TaskImplT> *state;
     using Self = TaskImplT::Self;
     Self self;
+    FrameProfiler *profiler{};
     void callback(daxa::TaskInterface const &ti) {
         auto &recorder = ti.get_recorder();
+        auto profile_scope = ProfileTaskScope(profiler, TaskImplT::name, recorder);
         recorder.set_uniform_buffer(ti.uses.get_uniform_buffer_info());
         state->record_commands(ti, recorder, self);
     }
@@ -0,0 +1,163 @@
+#include <core/thread_pool.hpp>
+
+namespace {
+    // Index of the queue owned by the current thread, or SIZE_MAX when the
+    // current thread is not a pool worker.
+    thread_local size_t current_worker_index = SIZE_MAX;
+    thread_local ThreadPool const *current_worker_pool = nullptr;
+} // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    queues.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this, i]() { worker_main(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        auto lock = std::lock_guard{sleep_mutex};
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    workers.clear();
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskGroup *group) {
+    if (group != nullptr) {
+        group->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Workers push onto their own queue so nested work stays cache-local;
+    // everyone else spreads tasks round-robin.
+    auto queue_index = current_worker_pool == this ? current_worker_index : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    queued_task_count.fetch_add(1, std::memory_order_release);
+    {
+        auto &queue = *queues[queue_index];
+        auto lock = std::lock_guard{queue.mutex};
+        queue.tasks.push_back(Task{.function = std::move(task), .group = group});
+    }
+    {
+        // Taking the lock orders this notify after a worker's predicate check.
+        auto lock = std::lock_guard{sleep_mutex};
+    }
+    sleep_cv.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &group) {
+    auto const own_queue = current_worker_pool == this ? current_worker_index : 0;
+    while (group.pending.load(std::memory_order_acquire) != 0) {
+        if (try_run_one_of(group, own_queue)) {
+            continue;
+        }
+        // Nothing left to help with, the rest is running elsewhere.
+        auto lock = std::unique_lock{group.mutex};
+        group.done_cv.wait(lock, [&group]() { return group.pending.load(std::memory_order_acquire) == 0; });
+    }
+    // The task that finished last may still hold the mutex. Once it's
+    // released, nothing touches the group anymore and the caller may
+    // destroy it.
+    auto lock = std::lock_guard{group.mutex};
+}
+
+void ThreadPool::parallel_for(size_t count, std::function<void(size_t)> const &body) {
+    if (count == 0) {
+        return;
+    }
+    // A few chunks per thread gives the stealing something to balance with.
+    auto const chunk_count = std::min(count, thread_count() * 4);
+    auto const chunk_size = (count + chunk_count - 1) / chunk_count;
+    auto group = TaskGroup{};
+    for (size_t begin = 0; begin < count; begin += chunk_size) {
+        auto const end = std::min(begin + chunk_size, count);
+        auto chunk = [&body, begin, end]() {
+            for (size_t i = begin; i < end; ++i) {
+                body(i);
+            }
+        };
+        submit(chunk, &group);
+    }
+    wait(group);
+}
+
+auto ThreadPool::try_pop(size_t queue_index, Task &out_task) -> bool {
+    auto &queue = *queues[queue_index];
+    auto lock = std::lock_guard{queue.mutex};
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    out_task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+auto ThreadPool::try_steal(size_t thief_index, Task &out_task) -> bool {
+    for (size_t i = 1; i < queues.size(); ++i) {
+        auto &queue = *queues[(thief_index + i) % queues.size()];
+        auto lock = std::unique_lock{queue.mutex, std::try_to_lock};
+        if (!lock.owns_lock() || queue.tasks.empty()) {
+            continue;
+        }
+        out_task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+auto ThreadPool::try_run_one(size_t queue_index) -> bool {
+    auto task = Task{};
+    if (!try_pop(queue_index, task) && !try_steal(queue_index, task)) {
+        return false;
+    }
+    run(task);
+    return true;
+}
+
+auto ThreadPool::try_run_one_of(TaskGroup &group, size_t queue_index) -> bool {
+    auto task = Task{};
+    for (size_t i = 0; i < queues.size() && task.group == nullptr; ++i) {
+        auto &queue = *queues[(queue_index + i) % queues.size()];
+        auto lock = std::lock_guard{queue.mutex};
+        // Newest first, like `try_pop`.
+        auto iter = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), [&group](Task const &queued) { return queued.group == &group; });
+        if (iter != queue.tasks.rend()) {
+            task = std::move(*iter);
+            queue.tasks.erase(std::next(iter).base());
+        }
+    }
+    if (task.group == nullptr) {
+        return false;
+    }
+    run(task);
+    return true;
+}
+
+void ThreadPool::run(Task &task) {
+    queued_task_count.fetch_sub(1, std::memory_order_relaxed);
+    task.function();
+    if (task.group != nullptr) {
+        auto lock = std::lock_guard{task.group->mutex};
+        if (task.group->pending.fetch_sub(1, std::memory_order_release) == 1) {
+            task.group->done_cv.notify_all();
+        }
+    }
+}
+
+void ThreadPool::worker_main(size_t worker_index) {
+    current_worker_index = worker_index;
+    current_worker_pool = this;
+    while (true) {
+        if (try_run_one(worker_index)) {
+            continue;
+        }
+        auto lock = std::unique_lock{sleep_mutex};
+        sleep_cv.wait(lock, [this]() { return stopping || queued_task_count.load(std::memory_order_acquire) != 0; });
+        if (stopping) {
+            break;
+        }
+    }
+}
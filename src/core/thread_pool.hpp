@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Each worker owns a queue that it pops from the
+// back, and idle workers steal from the front of the other queues. Threads
+// that wait on a group (`wait`, `parallel_for`) run that group's queued tasks
+// instead of blocking, so it is safe to nest parallel work inside a task. They
+// never pick up unrelated work, so waiting on a short job can't end up running
+// a long one that happens to share the pool.
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u));
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+    auto operator=(ThreadPool &&) -> ThreadPool & = delete;
+
+    // Counts outstanding tasks so a caller can wait on a subset of the work.
+    // The last task to finish signals `done_cv` while holding `mutex`.
+    struct TaskGroup {
+        std::atomic<size_t> pending{};
+        std::mutex mutex{};
+        std::condition_variable done_cv{};
+    };
+
+    void submit(std::function<void()> task, TaskGroup *group = nullptr);
+    void wait(TaskGroup &group);
+    // Runs `body(i)` for every i in [0, count) and returns when all are done.
+    void parallel_for(size_t count, std::function<void(size_t)> const &body);
+
+    auto thread_count() const -> size_t { return workers.size(); }
+
+  private:
+    struct Task {
+        std::function<void()> function{};
+        TaskGroup *group{};
+    };
+    struct WorkerQueue {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues{};
+    std::vector<std::jthread> workers{};
+    std::atomic<size_t> queued_task_count{};
+    std::atomic<size_t> next_queue{};
+    std::mutex sleep_mutex{};
+    std::condition_variable sleep_cv{};
+    bool stopping{};
+
+    auto try_pop(size_t queue_index, Task &out_task) -> bool;
+    auto try_steal(size_t thief_index, Task &out_task) -> bool;
+    auto try_run_one(size_t queue_index) -> bool;
+    // Like `try_run_one`, but only runs a task of `group`.
+    auto try_run_one_of(TaskGroup &group, size_t queue_index) -> bool;
+    void run(Task &task);
+    void worker_main(size_t worker_index);
+};
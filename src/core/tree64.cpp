@@ -0,0 +1,386 @@
+#include <core/tree64.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    // Keys hold one 6-bit child index per level, so this bounds the depth.
+    constexpr uint32_t MAX_DEPTH = 10;
+    constexpr size_t TOP_LEVEL_BUCKET_COUNT = 64;
+    // A refit touching more than 1/REBUILD_BATCH_DIVISOR of the leaves is
+    // cheaper as one sorted build than as that many single insertions.
+    constexpr size_t REBUILD_BATCH_DIVISOR = 2;
+
+    auto leaf_value(Brick const &brick) -> uint32_t {
+        return brick.is_uniform() ? (Tree64::LEAF_UNIFORM_BIT | brick.uniform_value) : 0u;
+    }
+
+    auto make_leaf(Brick const &brick) -> Tree64Node {
+        return {.child_mask = Tree64::brick_cell_mask(brick), .first_child = leaf_value(brick)};
+    }
+
+    // Child index of `local` within a node whose children are 4^level bricks
+    // wide.
+    auto child_bit_at(BrickCoord local, uint32_t level) -> uint32_t {
+        auto const shift = level * 2;
+        return ((static_cast<uint32_t>(local.x) >> shift) & 3u) +
+               ((static_cast<uint32_t>(local.y) >> shift) & 3u) * 4u +
+               ((static_cast<uint32_t>(local.z) >> shift) & 3u) * 16u;
+    }
+
+    // Child indices of every level from the root down, packed from the top
+    // bits, so sorting by key groups siblings in mask-bit order.
+    auto leaf_key(BrickCoord local, uint32_t depth) -> uint64_t {
+        auto result = uint64_t{};
+        for (auto level = depth; level-- > 0;) {
+            result = (result << 6) | child_bit_at(local, level);
+        }
+        return result;
+    }
+
+    auto child_rank(uint64_t child_mask, uint32_t child_bit) -> uint32_t {
+        return static_cast<uint32_t>(std::popcount(child_mask & ((uint64_t{1} << child_bit) - 1)));
+    }
+} // namespace
+
+auto Tree64::brick_cell_mask(Brick const &brick) -> uint64_t {
+    if (brick.is_uniform()) {
+        return brick.uniform_value != 0 ? ~uint64_t{0} : 0;
+    }
+    auto result = uint64_t{};
+    auto const &voxels = brick.data->voxels;
+    for (int32_t z = 0; z < VoxelBrick::SIZE; ++z) {
+        for (int32_t y = 0; y < VoxelBrick::SIZE; ++y) {
+            for (int32_t x = 0; x < VoxelBrick::SIZE; ++x) {
+                if (voxels[VoxelBrick::index(x, y, z)] != 0) {
+                    result |= uint64_t{1} << ((x >> 1) + (y >> 1) * 4 + (z >> 1) * 16);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void Tree64::build(ThreadPool &thread_pool, BrickMap const &brick_map) {
+    auto const start = std::chrono::steady_clock::now();
+    auto bricks = std::vector<std::pair<BrickCoord, Brick const *>>{};
+    bricks.reserve(brick_map.bricks.size());
+    for (auto const &[coord, brick] : brick_map.bricks) {
+        if (!brick.is_empty()) {
+            bricks.emplace_back(coord, &brick);
+        }
+    }
+    // Bottom level: the per-brick work, in parallel.
+    auto leaves = std::vector<Leaf>(bricks.size());
+    thread_pool.parallel_for(bricks.size(), [&](size_t i) {
+        leaves[i] = {.coord = bricks[i].first, .node = make_leaf(*bricks[i].second)};
+    });
+    std::erase_if(leaves, [](Leaf const &leaf) { return leaf.node.child_mask == 0; });
+    build_from_leaves(thread_pool, std::move(leaves));
+    stats.build_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Tree64::build_from_leaves(ThreadPool &thread_pool, std::vector<Leaf> leaves) {
+    nodes.clear();
+    dead_node_count = 0;
+    stats = {};
+    if (leaves.empty()) {
+        return;
+    }
+
+    auto bounds_min = BrickCoord{std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()};
+    auto bounds_max = BrickCoord{std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()};
+    for (auto const &leaf : leaves) {
+        bounds_min = {std::min(bounds_min.x, leaf.coord.x), std::min(bounds_min.y, leaf.coord.y), std::min(bounds_min.z, leaf.coord.z)};
+        bounds_max = {std::max(bounds_max.x, leaf.coord.x), std::max(bounds_max.y, leaf.coord.y), std::max(bounds_max.z, leaf.coord.z)};
+    }
+    auto const max_extent = std::max({bounds_max.x - bounds_min.x, bounds_max.y - bounds_min.y, bounds_max.z - bounds_min.z}) + 1;
+    origin = bounds_min;
+    depth = 1;
+    while (depth < MAX_DEPTH && (int64_t{1} << (2 * depth)) < max_extent) {
+        ++depth;
+    }
+    if ((int64_t{1} << (2 * depth)) < max_extent) {
+        // Scenes this large would need 128-bit keys. Leave the tree empty,
+        // which traversal treats as "no acceleration".
+        return;
+    }
+
+    thread_pool.parallel_for(leaves.size(), [&](size_t i) {
+        auto &leaf = leaves[i];
+        leaf.key = leaf_key({leaf.coord.x - origin.x, leaf.coord.y - origin.y, leaf.coord.z - origin.z}, depth);
+    });
+
+    // Bucket by root child, then sort the buckets in parallel.
+    {
+        auto const top_shift = 6 * (depth - 1);
+        auto bucket_offsets = std::array<size_t, TOP_LEVEL_BUCKET_COUNT + 1>{};
+        for (auto const &leaf : leaves) {
+            ++bucket_offsets[(leaf.key >> top_shift) + 1];
+        }
+        for (size_t i = 1; i < bucket_offsets.size(); ++i) {
+            bucket_offsets[i] += bucket_offsets[i - 1];
+        }
+        auto sorted = std::vector<Leaf>(leaves.size());
+        auto cursors = bucket_offsets;
+        for (auto const &leaf : leaves) {
+            sorted[cursors[leaf.key >> top_shift]++] = leaf;
+        }
+        thread_pool.parallel_for(TOP_LEVEL_BUCKET_COUNT, [&](size_t bucket) {
+            std::sort(sorted.begin() + static_cast<ptrdiff_t>(bucket_offsets[bucket]),
+                      sorted.begin() + static_cast<ptrdiff_t>(bucket_offsets[bucket + 1]),
+                      [](Leaf const &a, Leaf const &b) { return a.key < b.key; });
+        });
+        leaves = std::move(sorted);
+    }
+
+    // Reduce level by level. levels[0] is the leaves, levels[depth] the root.
+    auto levels = std::vector<std::vector<Tree64Node>>(depth + 1);
+    auto keys = std::vector<uint64_t>(leaves.size());
+    levels[0].resize(leaves.size());
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        keys[i] = leaves[i].key;
+        levels[0][i] = leaves[i].node;
+    }
+    for (uint32_t level = 1; level <= depth; ++level) {
+        auto &parents = levels[level];
+        auto parent_keys = std::vector<uint64_t>{};
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto const parent_key = keys[i] >> 6;
+            if (parent_keys.empty() || parent_keys.back() != parent_key) {
+                parent_keys.push_back(parent_key);
+                parents.push_back({.first_child = static_cast<uint32_t>(i)});
+            }
+            parents.back().child_mask |= uint64_t{1} << (keys[i] & 63);
+        }
+        keys = std::move(parent_keys);
+    }
+
+    // Flatten top to bottom and turn per-level child indices into global ones.
+    auto level_base = std::vector<uint32_t>(depth + 1);
+    auto node_count = size_t{};
+    for (auto level = depth + 1; level-- > 0;) {
+        level_base[level] = static_cast<uint32_t>(node_count);
+        node_count += levels[level].size();
+    }
+    nodes.resize(node_count);
+    thread_pool.parallel_for(depth + 1, [&](size_t level) {
+        auto const child_base = level > 0 ? level_base[level - 1] : 0u;
+        auto *out = nodes.data() + level_base[level];
+        for (auto node : levels[level]) {
+            if (level > 0) {
+                node.first_child += child_base;
+            }
+            *out++ = node;
+        }
+    });
+
+    stats.leaf_count = leaves.size();
+    update_stats();
+}
+
+auto Tree64::refit(ThreadPool &thread_pool, std::span<Tree64Change const> changes) -> bool {
+    auto const start = std::chrono::steady_clock::now();
+    auto leaves = std::vector<Leaf>(changes.size());
+    thread_pool.parallel_for(changes.size(), [&](size_t i) {
+        leaves[i] = {.coord = changes[i].coord, .node = make_leaf(changes[i].brick)};
+    });
+
+    auto rebuild = nodes.empty() || changes.size() > stats.leaf_count / REBUILD_BATCH_DIVISOR ||
+                   std::any_of(leaves.begin(), leaves.end(), [this](Leaf const &leaf) { return leaf.node.child_mask != 0 && !contains(leaf.coord); });
+    if (!rebuild) {
+        for (auto const &leaf : leaves) {
+            stats.leaf_count = static_cast<size_t>(static_cast<int64_t>(stats.leaf_count) + set_leaf(leaf.coord, leaf.node));
+        }
+        update_stats();
+        rebuild = dead_node_count > nodes.size() - dead_node_count;
+        if (!rebuild) {
+            return false;
+        }
+        // The changes are in the tree now, the rebuild only compacts it.
+        leaves.clear();
+    }
+
+    auto merged = collect_leaves();
+    auto merged_indices = std::unordered_map<BrickCoord, size_t, BrickCoordHash>{};
+    merged_indices.reserve(merged.size());
+    for (size_t i = 0; i < merged.size(); ++i) {
+        merged_indices.emplace(merged[i].coord, i);
+    }
+    for (auto const &leaf : leaves) {
+        auto [iter, inserted] = merged_indices.try_emplace(leaf.coord, merged.size());
+        if (inserted) {
+            merged.push_back(leaf);
+        } else {
+            merged[iter->second].node = leaf.node;
+        }
+    }
+    std::erase_if(merged, [](Leaf const &leaf) { return leaf.node.child_mask == 0; });
+    build_from_leaves(thread_pool, std::move(merged));
+    stats.build_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+auto Tree64::refit(ThreadPool &thread_pool, BrickMap const &brick_map, std::span<BrickCoord const> changed_bricks) -> bool {
+    auto changes = std::vector<Tree64Change>{};
+    changes.reserve(changed_bricks.size());
+    for (auto const &coord : changed_bricks) {
+        auto iter = brick_map.bricks.find(coord);
+        changes.push_back({.coord = coord, .brick = iter != brick_map.bricks.end() ? iter->second : Brick{}});
+    }
+    return refit(thread_pool, changes);
+}
+
+auto Tree64::empty_cube_level(BrickCoord coord) const -> int32_t {
+    if (!contains(coord)) {
+        return 0;
+    }
+    auto const local = BrickCoord{coord.x - origin.x, coord.y - origin.y, coord.z - origin.z};
+    auto node = uint32_t{};
+    for (auto level = depth; level-- > 0;) {
+        auto const &parent = nodes[node];
+        auto const child_bit = child_bit_at(local, level);
+        if ((parent.child_mask & (uint64_t{1} << child_bit)) == 0) {
+            return static_cast<int32_t>(level);
+        }
+        node = parent.first_child + child_rank(parent.child_mask, child_bit);
+    }
+    return -1;
+}
+
+auto Tree64::collect_leaves() const -> std::vector<Leaf> {
+    auto result = std::vector<Leaf>{};
+    result.reserve(stats.leaf_count);
+    if (nodes.empty()) {
+        return result;
+    }
+    struct Pending {
+        uint32_t node{};
+        uint32_t level{};
+        BrickCoord local{};
+    };
+    auto stack = std::vector<Pending>{{.node = 0, .level = depth}};
+    while (!stack.empty()) {
+        auto const pending = stack.back();
+        stack.pop_back();
+        if (pending.level == 0) {
+            auto const coord = BrickCoord{origin.x + pending.local.x, origin.y + pending.local.y, origin.z + pending.local.z};
+            result.push_back({.coord = coord, .node = nodes[pending.node]});
+            continue;
+        }
+        auto const &parent = nodes[pending.node];
+        auto const shift = 2 * (pending.level - 1);
+        auto child = parent.first_child;
+        for (auto mask = parent.child_mask; mask != 0; mask &= mask - 1) {
+            auto const child_bit = static_cast<int32_t>(std::countr_zero(mask));
+            auto const local = BrickCoord{
+                pending.local.x + ((child_bit & 3) << shift),
+                pending.local.y + (((child_bit >> 2) & 3) << shift),
+                pending.local.z + ((child_bit >> 4) << shift),
+            };
+            stack.push_back({.node = child++, .level = pending.level - 1, .local = local});
+        }
+    }
+    return result;
+}
+
+auto Tree64::contains(BrickCoord coord) const -> bool {
+    if (nodes.empty()) {
+        return false;
+    }
+    auto const size = int64_t{1} << (2 * depth);
+    auto const inside = [size](int32_t value, int32_t min) { return value >= min && int64_t{value} - min < size; };
+    return inside(coord.x, origin.x) && inside(coord.y, origin.y) && inside(coord.z, origin.z);
+}
+
+auto Tree64::set_leaf(BrickCoord coord, Tree64Node leaf) -> int32_t {
+    auto const local = BrickCoord{coord.x - origin.x, coord.y - origin.y, coord.z - origin.z};
+    auto const removing = leaf.child_mask == 0;
+    // The parent at each level on the way down, for clearing bits on the
+    // way back up.
+    auto parents = std::array<uint32_t, MAX_DEPTH>{};
+    auto node = uint32_t{};
+    for (auto level = depth; level-- > 0;) {
+        auto const child_bit = child_bit_at(local, level);
+        parents[level] = node;
+        if ((nodes[node].child_mask & (uint64_t{1} << child_bit)) == 0) {
+            if (removing) {
+                return 0;
+            }
+            // Nothing below here yet, add the chain of nodes down to the leaf.
+            node = insert_child(node, child_bit);
+            while (level-- > 0) {
+                auto const child = static_cast<uint32_t>(nodes.size());
+                nodes[node] = {.child_mask = uint64_t{1} << child_bit_at(local, level), .first_child = child};
+                nodes.emplace_back();
+                node = child;
+            }
+            nodes[node] = leaf;
+            return 1;
+        }
+        node = nodes[node].first_child + child_rank(nodes[node].child_mask, child_bit);
+    }
+    if (!removing) {
+        nodes[node] = leaf;
+        return 0;
+    }
+    // Remove the leaf, then every ancestor it leaves empty. The root stays.
+    for (uint32_t level = 0; level < depth; ++level) {
+        auto const parent = parents[level];
+        remove_child(parent, child_bit_at(local, level));
+        if (parent == 0 || nodes[parent].child_mask != 0) {
+            break;
+        }
+    }
+    return -1;
+}
+
+auto Tree64::insert_child(uint32_t parent, uint32_t child_bit) -> uint32_t {
+    auto const old_mask = nodes[parent].child_mask;
+    auto const first = nodes[parent].first_child;
+    auto const count = static_cast<uint32_t>(std::popcount(old_mask));
+    auto const rank = child_rank(old_mask, child_bit);
+    auto const end = static_cast<uint32_t>(nodes.size());
+    if (count == 0) {
+        nodes.emplace_back();
+        nodes[parent].first_child = end;
+    } else if (first + count == end) {
+        // The block is already last, it can grow in place.
+        nodes.insert(nodes.begin() + first + rank, Tree64Node{});
+    } else {
+        // Move the block to the end, where it can grow.
+        nodes.reserve(nodes.size() + count + 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            nodes.push_back(nodes[first + i]);
+        }
+        nodes.insert(nodes.begin() + end + rank, Tree64Node{});
+        nodes[parent].first_child = end;
+        dead_node_count += count;
+    }
+    nodes[parent].child_mask = old_mask | (uint64_t{1} << child_bit);
+    return nodes[parent].first_child + rank;
+}
+
+void Tree64::remove_child(uint32_t parent, uint32_t child_bit) {
+    auto const old_mask = nodes[parent].child_mask;
+    auto const first = nodes[parent].first_child;
+    auto const count = static_cast<uint32_t>(std::popcount(old_mask));
+    auto const rank = child_rank(old_mask, child_bit);
+    auto const block = nodes.begin() + first;
+    std::copy(block + rank + 1, block + count, block + rank);
+    if (first + count == nodes.size()) {
+        nodes.pop_back();
+    } else {
+        ++dead_node_count;
+    }
+    nodes[parent].child_mask = old_mask & ~(uint64_t{1} << child_bit);
+}
+
+void Tree64::update_stats() {
+    stats.node_count = nodes.size() - dead_node_count;
+    stats.memory_bytes = nodes.size() * sizeof(Tree64Node);
+}
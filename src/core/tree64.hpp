@@ -0,0 +1,97 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/thread_pool.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// 64-ary tree over the bricks of a BrickMap, used to skip empty space. Every
+// node splits its cube 4x4x4, and `child_mask` bit `x + 4 * y + 16 * z` marks
+// the children that contain anything. Leaves are bricks, where the mask
+// covers the 2x2x2-voxel cells of the brick instead.
+//
+// Nodes live in one flat array that can be copied to the GPU as is: the root
+// is node 0 and the children of a node are stored next to each other in
+// mask-bit order. Child `i` is at
+// `first_child + popcount(child_mask & ((1 << i) - 1))`. A build lays the
+// levels out top to bottom. Refits insert and remove children in place, and a
+// sibling block that has to grow and isn't at the end of the array moves
+// there, leaving dead nodes behind until the next build.
+struct Tree64Node {
+    uint64_t child_mask{};
+    // Index of the first child for inner nodes. For leaves, the brick's value
+    // with Tree64::LEAF_UNIFORM_BIT set if it is uniform, else 0, the same
+    // encoding the viewport's brick table uses.
+    uint32_t first_child{};
+    uint32_t _pad{};
+};
+
+struct Tree64Stats {
+    size_t node_count{};
+    size_t leaf_count{};
+    size_t memory_bytes{};
+    double build_milliseconds{};
+};
+
+// A brick as it was when it changed. Refits read these instead of the
+// BrickMap, so the map can be edited while a refit runs elsewhere.
+struct Tree64Change {
+    BrickCoord coord{};
+    // Empty if the brick was removed.
+    Brick brick{};
+};
+
+struct Tree64 {
+    static inline constexpr uint32_t LEAF_UNIFORM_BIT = 0x80000000;
+
+    std::vector<Tree64Node> nodes{};
+    // Brick coordinate of the root's min corner. The root covers 4^depth
+    // bricks along each axis, and the leaves are at `depth` below it.
+    BrickCoord origin{};
+    uint32_t depth{};
+    // Nodes no parent points at anymore, left behind by refits.
+    size_t dead_node_count{};
+    Tree64Stats stats{};
+
+    auto empty() const -> bool { return nodes.empty() || nodes[0].child_mask == 0; }
+
+    // Builds the tree from scratch. Leaf masks are computed on the thread
+    // pool, the levels above are then reduced from the sorted leaves.
+    void build(ThreadPool &thread_pool, BrickMap const &brick_map);
+    // Brings the leaves of `changes` up to date, inserting and removing them
+    // and clearing the bits of parents that lose their last child. It rebuilds
+    // from the tree's own leaves instead when a brick lands outside the root,
+    // when the batch touches most of the tree, or when dead nodes outnumber
+    // live ones. Returns whether it rebuilt.
+    auto refit(ThreadPool &thread_pool, std::span<Tree64Change const> changes) -> bool;
+    // Same as above, taking the changed bricks from `brick_map`.
+    auto refit(ThreadPool &thread_pool, BrickMap const &brick_map, std::span<BrickCoord const> changed_bricks) -> bool;
+
+    // -1 if the brick at `coord` has a leaf. Otherwise the level L of the
+    // largest empty node around it, a cube of 4^L bricks aligned to 4^L from
+    // `origin`. Bricks outside the root get 0, just themselves.
+    auto empty_cube_level(BrickCoord coord) const -> int32_t;
+
+    // Occupancy of the 2x2x2-voxel cells of a brick, bit `x + 4 * y + 16 * z`.
+    static auto brick_cell_mask(Brick const &brick) -> uint64_t;
+
+  private:
+    struct Leaf {
+        uint64_t key{};
+        BrickCoord coord{};
+        Tree64Node node{};
+    };
+
+    void build_from_leaves(ThreadPool &thread_pool, std::vector<Leaf> leaves);
+    auto collect_leaves() const -> std::vector<Leaf>;
+    auto contains(BrickCoord coord) const -> bool;
+    // Writes one leaf, or removes it if `leaf` has an empty mask. Returns the
+    // change in leaf count.
+    auto set_leaf(BrickCoord coord, Tree64Node leaf) -> int32_t;
+    // Makes room for child `child_bit` of `parent` and returns its index.
+    auto insert_child(uint32_t parent, uint32_t child_bit) -> uint32_t;
+    void remove_child(uint32_t parent, uint32_t child_bit);
+    void update_stats();
+};
@@ -2,20 +2,58 @@
 #include <daxa/utils/pipeline_manager.hpp>
 #include <daxa/utils/task_graph.hpp>
 #include <fmt/format.h>
+#include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+#include <renderer/frame_profiler.hpp>
+#include <renderer/shader_cache.hpp>
+#include <renderer/shader_watcher.hpp>
 #include <renderer/viewport.hpp>
 #include <ui/app_ui.hpp>
+#include <ui/frame_scheduler.hpp>
 #include <core/scene.hpp>
+#include <core/startup_profiler.hpp>
+#include <core/thread_pool.hpp>
 
 struct VoxelApp {
+    // First, so it times everything else.
+    StartupProfiler startup_profiler;
+    // Set by `--startup-bench`, exits once the first frame is presented and
+    // the viewport pipelines are ready.
+    bool startup_bench{};
+    bool startup_reported{};
     daxa::Instance daxa_instance;
     daxa::Device daxa_device;
     daxa::PipelineManager pipeline_manager;
+    ShaderCache shader_cache;
+    FrameProfiler profiler;
+    ThreadPool thread_pool;
     VoxelScene scene;
     Viewport viewport;
+    FrameScheduler scheduler;
     AppUi ui;
+    // Saving a shader recompiles the viewport pipelines in the background.
+    ShaderWatcher shader_watcher;
     daxa::TaskGraph main_task_graph;
     daxa::TaskImage task_swapchain_image;
+    // Persistent, so frames the viewport skips (see Viewport::needs_render)
+    // blit its last render again.
+    daxa::ImageId viewport_render_image{};
+    daxa::TaskImage task_viewport_render_image;
+    std::chrono::steady_clock::time_point last_profiler_ui_update{};
+    // The viewport renders into an image allocated at a power-of-two size
+    // class of the window, so only resizes that cross a class boundary
+    // re-record the task graph, and only once the size has settled.
+    static inline constexpr auto RENDER_IMAGE_RESIZE_DEBOUNCE = std::chrono::milliseconds(150);
+    daxa_u32vec2 render_image_size{};
+    std::optional<std::chrono::steady_clock::time_point> render_image_resize_deadline{};
 
     VoxelApp();
     ~VoxelApp();
@@ -25,57 +63,140 @@ struct VoxelApp {
     auto operator=(const VoxelApp &) -> VoxelApp & = delete;
     auto operator=(VoxelApp &&) -> VoxelApp & = delete;
 
+    // Handles window events on the calling (main) thread while a render
+    // thread runs the frames, until the window is closed.
+    void run();
+    void render_loop(std::stop_token const &stop_token);
     void update();
     auto should_close() -> bool;
     void render();
+    void wait_for_next_frame();
+    void on_window_resized();
+    void report_startup();
     auto record_main_task_graph() -> daxa::TaskGraph;
 };
 
-auto main() -> int {
+namespace {
+    auto shader_compile_options() -> daxa::ShaderCompileOptions {
+        return {
+            .root_paths = {DAXA_SHADER_INCLUDE_DIR, "src"},
+            .language = daxa::ShaderLanguage::GLSL,
+            .enable_debug_info = true,
+        };
+    }
+
+    auto render_image_size_class(daxa_i32vec2 window_size) -> daxa_u32vec2 {
+        constexpr auto MIN_SIZE = 256u;
+        return {
+            std::bit_ceil(std::max(static_cast<uint32_t>(std::max(window_size.x, 1)), MIN_SIZE)),
+            std::bit_ceil(std::max(static_cast<uint32_t>(std::max(window_size.y, 1)), MIN_SIZE)),
+        };
+    }
+} // namespace
+
+auto main(int argc, char **argv) -> int {
     auto app = VoxelApp();
-    while (true) {
-        app.update();
-        if (app.should_close()) {
-            break;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view{argv[i]} == "--startup-bench") {
+            app.startup_bench = true;
+            continue;
         }
-        app.render();
+        auto const phase = StartupPhaseScope(app.startup_profiler, "scene load");
+        app.scene.load(argv[i]);
     }
+    app.run();
 }
 
 VoxelApp::VoxelApp()
-    : daxa_instance{daxa::create_instance({})},
-      daxa_device{daxa_instance.create_device({.name = "device"})},
-      pipeline_manager{[this]() {
-          auto result = daxa::PipelineManager({
+    : daxa_instance{startup_profiler.time("instance", []() { return daxa::create_instance({}); })},
+      daxa_device{startup_profiler.time("device", [this]() { return daxa_instance.create_device({.name = "device"}); })},
+      pipeline_manager{startup_profiler.time("pipeline manager", [this]() {
+          return daxa::PipelineManager({
               .device = daxa_device,
-              .shader_compile_options = {
-                  .root_paths = {DAXA_SHADER_INCLUDE_DIR, "src"},
-                  .language = daxa::ShaderLanguage::GLSL,
-                  .enable_debug_info = true,
-              },
+              .shader_compile_options = shader_compile_options(),
               .register_null_pipelines_when_first_compile_fails = true,
               .name = "pipeline_manager",
           });
-          return result;
-      }()},
-      viewport{pipeline_manager},
-      ui{daxa_device},
-      task_swapchain_image{daxa::TaskImageInfo{.swapchain_image = true}} {
-    ui.app_windows[0].on_resize = [&]() {
-        main_task_graph = record_main_task_graph();
-        render();
+      })},
+      shader_cache{daxa_device, "gvox-editor-cache/shaders", shader_compile_options()},
+      profiler{startup_profiler.time("frame profiler", [this]() { return FrameProfiler(daxa_device); })},
+      thread_pool{startup_profiler.time("thread pool", []() { return ThreadPool(); })},
+      scene{startup_profiler.time("scene", [this]() { return VoxelScene(thread_pool); })},
+      viewport{startup_profiler.time("viewport", [this]() { return Viewport(daxa_device, pipeline_manager, shader_cache, thread_pool, scene); })},
+      ui{startup_profiler.time("ui", [this]() { return AppUi(daxa_device, thread_pool, [this]() { scheduler.wake(); }, startup_profiler); })},
+      shader_watcher{{"src"}, [this]() {
+                         viewport.reload_pipelines();
+                         scheduler.wake();
+                     }},
+      task_swapchain_image{daxa::TaskImageInfo{.swapchain_image = true}},
+      task_viewport_render_image{daxa::TaskImageInfo{.name = "viewport_render_image"}} {
+    ui.on_undo = [this]() { scene.undo(); };
+    ui.on_redo = [this]() { scene.redo(); };
+    ui.on_dump_trace = [this]() {
+        auto const path = std::filesystem::path{"gvox-editor-trace.json"};
+        if (profiler.write_chrome_trace(path)) {
+            std::cout << "Wrote frame trace to " << std::filesystem::absolute(path).string() << std::endl;
+        } else {
+            std::cerr << "Failed to write frame trace to " << path.string() << std::endl;
+        }
     };
+    ui.on_cycle_shading_mode = [this]() { viewport.cycle_shading_mode(); };
+    ui.on_cycle_debug_view = [this]() { viewport.cycle_debug_view(); };
+    ui.app_windows[0].on_resize = [this]() { on_window_resized(); };
+    ui.app_windows[0].on_event = [this]() { scheduler.wake(); };
+    auto const phase = StartupPhaseScope(startup_profiler, "task graph");
     main_task_graph = record_main_task_graph();
 }
 
 VoxelApp::~VoxelApp() {
     ui.app_windows.clear();
     daxa_device.wait_idle();
+    if (!viewport_render_image.is_empty()) {
+        daxa_device.destroy_image(viewport_render_image);
+    }
     daxa_device.collect_garbage();
 }
 
+void VoxelApp::run() {
+    auto render_thread = std::jthread([this](std::stop_token const &stop_token) { render_loop(stop_token); });
+    // Input only ever waits on this loop, never on a frame.
+    while (!should_close()) {
+        glfwWaitEvents();
+        ui.apply_main_thread_requests();
+    }
+    render_thread.request_stop();
+    scheduler.wake();
+    render_thread.join();
+    // The window was closed before the pipelines were ready.
+    if (!startup_reported) {
+        report_startup();
+    }
+}
+
+void VoxelApp::render_loop(std::stop_token const &stop_token) {
+    while (!stop_token.stop_requested()) {
+        update();
+        render();
+        wait_for_next_frame();
+    }
+}
+
 void VoxelApp::update() {
     ui.update();
+    scene.update();
+
+    auto const now = std::chrono::steady_clock::now();
+    if (now - last_profiler_ui_update > std::chrono::milliseconds(250)) {
+        ui.set_profiler_summary(profiler.average_frame_ms(60), profiler.summary(60), scheduler.stats());
+        last_profiler_ui_update = now;
+    }
+    if (!startup_reported && startup_profiler.milestone_ms("first frame") && viewport.pipelines_compiled()) {
+        report_startup();
+        if (startup_bench) {
+            ui.should_close.store(true);
+            glfwPostEmptyEvent();
+        }
+    }
 }
 
 void VoxelApp::render() {
@@ -84,9 +205,67 @@ void VoxelApp::render() {
     if (swapchain_image.is_empty()) {
         return;
     }
+    profiler.begin_frame();
+    if (render_image_resize_deadline && std::chrono::steady_clock::now() >= *render_image_resize_deadline) {
+        render_image_resize_deadline.reset();
+        main_task_graph = record_main_task_graph();
+    }
     task_swapchain_image.set_images({.images = {&swapchain_image, 1}});
+    viewport.update(app_window.swapchain.current_cpu_timeline_value(), app_window.swapchain.gpu_timeline_semaphore().value());
     main_task_graph.execute({});
     daxa_device.collect_garbage();
+    if (!startup_reported) {
+        startup_profiler.mark("first frame");
+    }
+}
+
+void VoxelApp::wait_for_next_frame() {
+    // A scene streaming in, a backlog of bricks still to upload, or the
+    // pipelines still compiling, needs frames until it's done. Otherwise only
+    // the UI can ask for one.
+    auto const scene_busy = scene.loader != nullptr || !scene.brick_map.dirty_bricks.empty() || !viewport.pipelines_compiled();
+    auto const resize_pending = render_image_resize_deadline.has_value();
+    scheduler.wait(scene_busy || resize_pending ? 0.0 : ui.next_update_delay());
+}
+
+void VoxelApp::on_window_resized() {
+    auto const window_size = ui.app_windows[0].size;
+    viewport.set_output_size({static_cast<uint32_t>(window_size.x), static_cast<uint32_t>(window_size.y)}, render_image_size);
+    auto const size_class = render_image_size_class(window_size);
+    if (size_class.x == render_image_size.x && size_class.y == render_image_size.y) {
+        render_image_resize_deadline.reset();
+        return;
+    }
+    // Until then, the viewport renders what fits and the blit scales it up.
+    render_image_resize_deadline = std::chrono::steady_clock::now() + RENDER_IMAGE_RESIZE_DEBOUNCE;
+}
+
+void VoxelApp::report_startup() {
+    if (viewport.pipelines_compiled()) {
+        startup_profiler.mark("pipelines ready");
+    }
+    // A cold start compiles every shader, a warm one loads them all from the
+    // shader cache.
+    auto const app_stats = shader_cache.stats();
+    auto const ui_stats = ui.render_interface.shader_cache_stats();
+    auto const hit_count = app_stats.hit_count + ui_stats.hit_count;
+    auto const miss_count = app_stats.miss_count + ui_stats.miss_count;
+    std::cout << (miss_count == 0 ? "Warm" : "Cold") << " start: "
+              << hit_count << " shader stages cached, " << miss_count << " compiled, "
+              << app_stats.milliseconds + ui_stats.milliseconds << " ms creating pipelines" << std::endl;
+    // Without batching, every draw RmlUi issues is its own indexed draw.
+    auto const ui_render_stats = ui.render_interface.stats();
+    std::cout << "UI: " << ui_render_stats.draw_count << " draws issued as " << ui_render_stats.batch_count << " indirect batches" << std::endl;
+    // A warm start loads every face size's glyph pages from the font cache.
+    auto const font_stats = ui.font_engine.stats();
+    std::cout << "Fonts: " << font_stats.loaded_size_count << " sizes cached, " << font_stats.baked_size_count << " rasterised, "
+              << font_stats.rasterised_glyph_count << " glyphs rasterised" << std::endl;
+    startup_profiler.print();
+    auto const path = std::filesystem::path{"gvox-editor-startup.json"};
+    if (!startup_profiler.write_json(path)) {
+        std::cerr << "Failed to write startup report to " << path.string() << std::endl;
+    }
+    startup_reported = true;
 }
 
 auto VoxelApp::should_close() -> bool {
@@ -107,6 +286,7 @@ auto VoxelApp::record_main_task_graph() -> daxa::TaskGraph {
         },
         .task = [this](daxa::TaskInterface task_runtime) {
             auto &recorder = task_runtime.get_recorder();
+            auto const profile_scope = ProfileTaskScope(&profiler, "clear screen", recorder);
             auto swapchain_image = task_runtime.uses[task_swapchain_image].image();
             auto swapchain_image_full_slice = daxa_device.info_image_view(swapchain_image.default_view()).value().slice;
             recorder.clear_image({
@@ -118,28 +298,41 @@ auto VoxelApp::record_main_task_graph() -> daxa::TaskGraph {
         },
         .name = "clear screen",
     });
-    auto viewport_render_image = task_graph.create_transient_image({
+    render_image_size = render_image_size_class(app_window.size);
+    viewport.set_output_size({static_cast<uint32_t>(app_window.size.x), static_cast<uint32_t>(app_window.size.y)}, render_image_size);
+    // The image of the previous recording may still be in use by frames in
+    // flight, destroying it waits for them.
+    if (!viewport_render_image.is_empty()) {
+        daxa_device.destroy_image(viewport_render_image);
+    }
+    viewport_render_image = daxa_device.create_image({
         .format = daxa::Format::R16G16B16A16_SFLOAT,
-        .size = {static_cast<uint32_t>(app_window.size.x), static_cast<uint32_t>(app_window.size.y), 1},
+        .size = {render_image_size.x, render_image_size.y, 1},
+        .usage = daxa::ImageUsageFlagBits::SHADER_STORAGE | daxa::ImageUsageFlagBits::TRANSFER_SRC,
         .name = "viewport_render_image",
     });
-    viewport.render(task_graph, viewport_render_image);
+    task_viewport_render_image.set_images({.images = {&viewport_render_image, 1}});
+    task_graph.use_persistent_image(task_viewport_render_image);
+    viewport.invalidate();
+    viewport.render(task_graph, task_viewport_render_image, &profiler);
 
     task_graph.add_task({
         .uses = {
-            daxa::TaskImageUse<daxa::TaskImageAccess::TRANSFER_READ>{viewport_render_image},
+            daxa::TaskImageUse<daxa::TaskImageAccess::TRANSFER_READ>{task_viewport_render_image},
             daxa::TaskImageUse<daxa::TaskImageAccess::TRANSFER_WRITE>{task_swapchain_image},
         },
-        .task = [viewport_render_image, this](daxa::TaskInterface const &ti) {
+        .task = [this](daxa::TaskInterface const &ti) {
             auto &recorder = ti.get_recorder();
-            auto image_size = ti.get_device().info_image(ti.uses[viewport_render_image].image()).value().size;
+            auto const profile_scope = ProfileTaskScope(&profiler, "blit_image_to_image", recorder);
+            auto const src_size = viewport.render_size;
+            auto const dst_size = ti.get_device().info_image(ti.uses[task_swapchain_image].image()).value().size;
             recorder.blit_image_to_image({
-                .src_image = ti.uses[viewport_render_image].image(),
-                .src_image_layout = ti.uses[task_swapchain_image].layout(),
+                .src_image = ti.uses[task_viewport_render_image].image(),
+                .src_image_layout = ti.uses[task_viewport_render_image].layout(),
                 .dst_image = ti.uses[task_swapchain_image].image(),
                 .dst_image_layout = ti.uses[task_swapchain_image].layout(),
-                .src_offsets = {{{0, 0, 0}, {static_cast<int32_t>(image_size.x), static_cast<int32_t>(image_size.y), 1}}},
-                .dst_offsets = {{{0, 0, 0}, {static_cast<int32_t>(image_size.x), static_cast<int32_t>(image_size.y), 1}}},
+                .src_offsets = {{{0, 0, 0}, {static_cast<int32_t>(src_size.x), static_cast<int32_t>(src_size.y), 1}}},
+                .dst_offsets = {{{0, 0, 0}, {static_cast<int32_t>(dst_size.x), static_cast<int32_t>(dst_size.y), 1}}},
                 .filter = daxa::Filter::LINEAR,
             });
         },
@@ -152,6 +345,7 @@ auto VoxelApp::record_main_task_graph() -> daxa::TaskGraph {
         },
         .task = [this](daxa::TaskInterface task_runtime) {
             auto &recorder = task_runtime.get_recorder();
+            auto const profile_scope = ProfileTaskScope(&profiler, "ui draw", recorder);
             ui.render(recorder, task_runtime.uses[task_swapchain_image].image());
         },
         .name = "ui draw",
@@ -0,0 +1,444 @@
+#include <renderer/cpu_renderer.hpp>
+#include <renderer/simd.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+
+namespace {
+    constexpr uint32_t TILE_SIZE = 16;
+    constexpr float BRICK_SIZE = static_cast<float>(VoxelBrick::SIZE);
+    // Nudge used to land strictly inside the cell a ray has just entered.
+    constexpr float T_EPSILON = 1e-4f;
+    constexpr std::array<float, 3> LIGHT_DIRECTION = {0.40f, 0.55f, 0.73f};
+    constexpr std::array<float, 3> BACKGROUND_COLOR = {0.2f, 0.1f, 0.4f};
+
+    auto argmin_axis(std::array<float, 3> const &t) -> int32_t {
+        if (t[0] <= t[1] && t[0] <= t[2]) {
+            return 0;
+        }
+        return t[1] <= t[2] ? 1 : 2;
+    }
+
+    struct SceneSpan {
+        float t_enter{};
+        float t_exit{};
+        int32_t entry_axis = -1;
+    };
+
+    // Where the ray overlaps the scene bounds, clipped to t >= 0.
+    auto clip_to_bounds(CpuSceneBounds const &bounds, CpuRay const &ray) -> SceneSpan {
+        auto const lo = std::array{bounds.min.x, bounds.min.y, bounds.min.z};
+        auto const hi = std::array{bounds.max.x + 1, bounds.max.y + 1, bounds.max.z + 1};
+        auto result = SceneSpan{.t_enter = 0.0f, .t_exit = std::numeric_limits<float>::max()};
+        for (size_t i = 0; i < 3; ++i) {
+            auto const t0 = (static_cast<float>(lo[i]) * BRICK_SIZE - ray.origin[i]) * ray.inv_direction[i];
+            auto const t1 = (static_cast<float>(hi[i]) * BRICK_SIZE - ray.origin[i]) * ray.inv_direction[i];
+            auto const t_near = std::min(t0, t1);
+            if (t_near > result.t_enter) {
+                result.t_enter = t_near;
+                result.entry_axis = static_cast<int32_t>(i);
+            }
+            result.t_exit = std::min(result.t_exit, std::max(t0, t1));
+        }
+        return result;
+    }
+
+    // Voxel-level DDA inside one dense brick, starting where the ray entered it.
+    auto trace_brick(VoxelBrick const &brick, BrickCoord coord, CpuRay const &ray, float t_start, int32_t entry_axis, CpuRayHit &out_hit) -> bool {
+        auto const origin = std::array{coord.x * VoxelBrick::SIZE, coord.y * VoxelBrick::SIZE, coord.z * VoxelBrick::SIZE};
+        auto voxel = std::array<int32_t, 3>{};
+        auto step = std::array<int32_t, 3>{};
+        auto t_max = std::array<float, 3>{};
+        auto t_delta = std::array<float, 3>{};
+        for (size_t i = 0; i < 3; ++i) {
+            auto const p = ray.origin[i] + ray.direction[i] * (t_start + T_EPSILON);
+            voxel[i] = std::clamp(static_cast<int32_t>(std::floor(p)) - origin[i], 0, VoxelBrick::SIZE - 1);
+            step[i] = ray.direction[i] >= 0.0f ? 1 : -1;
+            auto const boundary = static_cast<float>(origin[i] + voxel[i] + (step[i] > 0 ? 1 : 0));
+            t_max[i] = (boundary - ray.origin[i]) * ray.inv_direction[i];
+            t_delta[i] = std::abs(ray.inv_direction[i]);
+        }
+        auto t = t_start;
+        auto axis = entry_axis;
+        while (true) {
+            auto const value = brick.voxels[VoxelBrick::index(voxel[0], voxel[1], voxel[2])];
+            if (value != 0) {
+                out_hit = {.t = t, .voxel = value, .normal_axis = axis, .normal_sign = axis >= 0 ? -static_cast<float>(step[static_cast<size_t>(axis)]) : 0.0f};
+                return true;
+            }
+            axis = argmin_axis(t_max);
+            auto const a = static_cast<size_t>(axis);
+            t = t_max[a];
+            voxel[a] += step[a];
+            if (voxel[a] < 0 || voxel[a] >= VoxelBrick::SIZE) {
+                return false;
+            }
+            t_max[a] += t_delta[a];
+        }
+    }
+
+    // Checks the brick a lane is in. Returns true if the lane is done.
+    auto visit_brick(BrickMap const &brick_map, BrickCoord coord, CpuRay const &ray, float t, int32_t axis, float step_sign, CpuRayHit &out_hit) -> bool {
+        auto iter = brick_map.bricks.find(coord);
+        if (iter == brick_map.bricks.end()) {
+            return false;
+        }
+        auto const &brick = iter->second;
+        if (brick.is_uniform()) {
+            if (brick.uniform_value == 0) {
+                return false;
+            }
+            out_hit = {.t = t, .voxel = brick.uniform_value, .normal_axis = axis, .normal_sign = axis >= 0 ? -step_sign : 0.0f};
+            return true;
+        }
+        return trace_brick(*brick.data, coord, ray, t, axis, out_hit);
+    }
+
+    // Moves a brick-level DDA to where the ray leaves the empty tree node
+    // around `cell`. Returns false if that node is just the brick itself, or
+    // the brick isn't empty.
+    auto skip_empty_node(Tree64 const &tree, CpuRay const &ray, std::array<int32_t, 3> &cell, std::array<int32_t, 3> const &step, std::array<float, 3> &t_max, float &t, int32_t &axis) -> bool {
+        auto const level = tree.empty_cube_level({cell[0], cell[1], cell[2]});
+        if (level <= 0) {
+            return false;
+        }
+        auto const shift = 2 * level;
+        auto const size = int32_t{1} << shift;
+        auto const tree_origin = std::array{tree.origin.x, tree.origin.y, tree.origin.z};
+        auto node_min = std::array<int32_t, 3>{};
+        auto node_exit = std::array<float, 3>{};
+        for (size_t i = 0; i < 3; ++i) {
+            node_min[i] = tree_origin[i] + (((cell[i] - tree_origin[i]) >> shift) << shift);
+            auto const boundary = static_cast<float>(node_min[i] + (step[i] > 0 ? size : 0)) * BRICK_SIZE;
+            node_exit[i] = (boundary - ray.origin[i]) * ray.inv_direction[i];
+        }
+        axis = argmin_axis(node_exit);
+        t = std::max(t, node_exit[static_cast<size_t>(axis)]);
+        for (size_t i = 0; i < 3; ++i) {
+            if (static_cast<int32_t>(i) == axis) {
+                cell[i] = step[i] > 0 ? node_min[i] + size : node_min[i] - 1;
+            } else {
+                auto const p = ray.origin[i] + ray.direction[i] * t;
+                cell[i] = std::clamp(static_cast<int32_t>(std::floor(p / BRICK_SIZE)), node_min[i], node_min[i] + size - 1);
+            }
+            auto const boundary = static_cast<float>(cell[i] + (step[i] > 0 ? 1 : 0)) * BRICK_SIZE;
+            t_max[i] = (boundary - ray.origin[i]) * ray.inv_direction[i];
+        }
+        return true;
+    }
+
+    auto pack_rgba8(std::array<float, 3> const &color) -> uint32_t {
+        auto result = uint32_t{0xff000000};
+        for (size_t i = 0; i < 3; ++i) {
+            auto const c = static_cast<uint32_t>(std::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            result |= c << (i * 8);
+        }
+        return result;
+    }
+
+    // Brick-level DDA for `simd::WIDTH` rays at once. The stepping state lives
+    // in vectors; looking bricks up in the hash table, walking dense bricks
+    // and skipping empty tree nodes is done per lane.
+    void trace_packet(BrickMap const &brick_map, Tree64 const *tree, CpuSceneBounds const &bounds, std::array<CpuRay, simd::WIDTH> const &rays, uint32_t lane_count, std::array<CpuRayHit, simd::WIDTH> &hits) {
+        using simd::FloatN;
+        constexpr auto W = simd::WIDTH;
+
+        auto active_lanes = uint32_t{};
+        alignas(32) auto cell_x = std::array<float, W>{};
+        alignas(32) auto cell_y = std::array<float, W>{};
+        alignas(32) auto cell_z = std::array<float, W>{};
+        alignas(32) auto step_x = std::array<float, W>{};
+        alignas(32) auto step_y = std::array<float, W>{};
+        alignas(32) auto step_z = std::array<float, W>{};
+        alignas(32) auto t_enter = std::array<float, W>{};
+        alignas(32) auto t_exit = std::array<float, W>{};
+        alignas(32) auto t_max_x = std::array<float, W>{};
+        alignas(32) auto t_max_y = std::array<float, W>{};
+        alignas(32) auto t_max_z = std::array<float, W>{};
+        auto axis = std::array<int32_t, W>{};
+
+        for (uint32_t lane = 0; lane < W; ++lane) {
+            hits[lane] = {};
+            if (lane >= lane_count) {
+                t_exit[lane] = -1.0f;
+                continue;
+            }
+            auto const &ray = rays[lane];
+            auto const span = clip_to_bounds(bounds, ray);
+            t_enter[lane] = span.t_enter;
+            t_exit[lane] = span.t_exit;
+            axis[lane] = span.entry_axis;
+            if (span.t_enter < span.t_exit) {
+                active_lanes |= 1u << lane;
+            }
+            auto const p = std::array{
+                ray.origin[0] + ray.direction[0] * (span.t_enter + T_EPSILON),
+                ray.origin[1] + ray.direction[1] * (span.t_enter + T_EPSILON),
+                ray.origin[2] + ray.direction[2] * (span.t_enter + T_EPSILON),
+            };
+            cell_x[lane] = std::clamp(std::floor(p[0] / BRICK_SIZE), static_cast<float>(bounds.min.x), static_cast<float>(bounds.max.x));
+            cell_y[lane] = std::clamp(std::floor(p[1] / BRICK_SIZE), static_cast<float>(bounds.min.y), static_cast<float>(bounds.max.y));
+            cell_z[lane] = std::clamp(std::floor(p[2] / BRICK_SIZE), static_cast<float>(bounds.min.z), static_cast<float>(bounds.max.z));
+            step_x[lane] = ray.direction[0] >= 0.0f ? 1.0f : -1.0f;
+            step_y[lane] = ray.direction[1] >= 0.0f ? 1.0f : -1.0f;
+            step_z[lane] = ray.direction[2] >= 0.0f ? 1.0f : -1.0f;
+        }
+
+        // Vectorized setup of the DDA increments.
+        auto const zero = simd::broadcast(0.0f);
+        auto const one = simd::broadcast(1.0f);
+        auto const brick_size = simd::broadcast(BRICK_SIZE);
+        auto const all_lanes = zero <= one;
+        auto load_lanes = [&](auto member) {
+            alignas(32) auto values = std::array<float, W>{};
+            for (uint32_t lane = 0; lane < W; ++lane) {
+                values[lane] = member(rays[lane]);
+            }
+            return simd::load(values.data());
+        };
+        auto const origin = simd::Vec3N{
+            load_lanes([](CpuRay const &r) { return r.origin[0]; }),
+            load_lanes([](CpuRay const &r) { return r.origin[1]; }),
+            load_lanes([](CpuRay const &r) { return r.origin[2]; }),
+        };
+        auto const inv_dir = simd::Vec3N{
+            load_lanes([](CpuRay const &r) { return r.inv_direction[0]; }),
+            load_lanes([](CpuRay const &r) { return r.inv_direction[1]; }),
+            load_lanes([](CpuRay const &r) { return r.inv_direction[2]; }),
+        };
+        auto cell = simd::Vec3N{simd::load(cell_x.data()), simd::load(cell_y.data()), simd::load(cell_z.data())};
+        auto const step = simd::Vec3N{simd::load(step_x.data()), simd::load(step_y.data()), simd::load(step_z.data())};
+        auto next_boundary = [&](FloatN c, FloatN s) { return (c + simd::select(zero < s, one, zero)) * brick_size; };
+        auto t_max = simd::Vec3N{
+            (next_boundary(cell.x, step.x) - origin.x) * inv_dir.x,
+            (next_boundary(cell.y, step.y) - origin.y) * inv_dir.y,
+            (next_boundary(cell.z, step.z) - origin.z) * inv_dir.z,
+        };
+        auto const t_delta = simd::Vec3N{simd::abs(inv_dir.x) * brick_size, simd::abs(inv_dir.y) * brick_size, simd::abs(inv_dir.z) * brick_size};
+        auto const t_exit_n = simd::load(t_exit.data());
+        auto t_cur = simd::load(t_enter.data());
+        alignas(32) auto t_cur_lanes = t_enter;
+
+        auto const max_steps = (bounds.max.x - bounds.min.x) + (bounds.max.y - bounds.min.y) + (bounds.max.z - bounds.min.z) + 3;
+        for (int32_t iteration = 0; iteration < max_steps && active_lanes != 0; ++iteration) {
+            simd::store(cell_x.data(), cell.x);
+            simd::store(cell_y.data(), cell.y);
+            simd::store(cell_z.data(), cell.z);
+            if (tree != nullptr) {
+                simd::store(t_max_x.data(), t_max.x);
+                simd::store(t_max_y.data(), t_max.y);
+                simd::store(t_max_z.data(), t_max.z);
+            }
+            auto skipped_lanes = uint32_t{};
+            for (uint32_t lane = 0; lane < W; ++lane) {
+                if ((active_lanes & (1u << lane)) == 0) {
+                    continue;
+                }
+                if (tree != nullptr) {
+                    auto lane_cell = std::array{static_cast<int32_t>(cell_x[lane]), static_cast<int32_t>(cell_y[lane]), static_cast<int32_t>(cell_z[lane])};
+                    auto const lane_step = std::array{static_cast<int32_t>(step_x[lane]), static_cast<int32_t>(step_y[lane]), static_cast<int32_t>(step_z[lane])};
+                    auto lane_t_max = std::array{t_max_x[lane], t_max_y[lane], t_max_z[lane]};
+                    while (t_cur_lanes[lane] < t_exit[lane] && skip_empty_node(*tree, rays[lane], lane_cell, lane_step, lane_t_max, t_cur_lanes[lane], axis[lane])) {
+                        skipped_lanes |= 1u << lane;
+                    }
+                    if (t_cur_lanes[lane] >= t_exit[lane]) {
+                        active_lanes &= ~(1u << lane);
+                        continue;
+                    }
+                    cell_x[lane] = static_cast<float>(lane_cell[0]);
+                    cell_y[lane] = static_cast<float>(lane_cell[1]);
+                    cell_z[lane] = static_cast<float>(lane_cell[2]);
+                    t_max_x[lane] = lane_t_max[0];
+                    t_max_y[lane] = lane_t_max[1];
+                    t_max_z[lane] = lane_t_max[2];
+                }
+                auto const coord = BrickCoord{static_cast<int32_t>(cell_x[lane]), static_cast<int32_t>(cell_y[lane]), static_cast<int32_t>(cell_z[lane])};
+                auto const a = axis[lane];
+                auto const step_sign = a == 0 ? step_x[lane] : a == 1 ? step_y[lane] : step_z[lane];
+                if (visit_brick(brick_map, coord, rays[lane], t_cur_lanes[lane], a, step_sign, hits[lane])) {
+                    active_lanes &= ~(1u << lane);
+                }
+            }
+            if (skipped_lanes != 0) {
+                cell = {simd::load(cell_x.data()), simd::load(cell_y.data()), simd::load(cell_z.data())};
+                t_max = {simd::load(t_max_x.data()), simd::load(t_max_y.data()), simd::load(t_max_z.data())};
+            }
+
+            // Step every lane to its next brick. Finished lanes step too, but
+            // their results are never read again.
+            auto const x_is_min = (t_max.x <= t_max.y) & (t_max.x <= t_max.z);
+            auto const y_is_min = simd::and_not(x_is_min, t_max.y <= t_max.z);
+            auto const z_is_min = simd::and_not(x_is_min | y_is_min, all_lanes);
+            t_cur = simd::select(x_is_min, t_max.x, simd::select(y_is_min, t_max.y, t_max.z));
+            cell.x = cell.x + (x_is_min & step.x);
+            cell.y = cell.y + (y_is_min & step.y);
+            cell.z = cell.z + (z_is_min & step.z);
+            t_max.x = t_max.x + (x_is_min & t_delta.x);
+            t_max.y = t_max.y + (y_is_min & t_delta.y);
+            t_max.z = t_max.z + (z_is_min & t_delta.z);
+            active_lanes &= simd::lane_mask(t_cur < t_exit_n);
+
+            simd::store(t_cur_lanes.data(), t_cur);
+            auto const x_bits = simd::lane_mask(x_is_min);
+            auto const y_bits = simd::lane_mask(y_is_min);
+            for (uint32_t lane = 0; lane < W; ++lane) {
+                axis[lane] = (x_bits & (1u << lane)) != 0 ? 0 : (y_bits & (1u << lane)) != 0 ? 1 : 2;
+            }
+        }
+    }
+} // namespace
+
+auto CpuImage::save_ppm(std::filesystem::path const &path) const -> bool {
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file << "P6\n"
+         << width << " " << height << "\n255\n";
+    for (auto pixel : pixels) {
+        auto const rgb = std::array{static_cast<char>(pixel & 0xff), static_cast<char>((pixel >> 8) & 0xff), static_cast<char>((pixel >> 16) & 0xff)};
+        file.write(rgb.data(), rgb.size());
+    }
+    return static_cast<bool>(file);
+}
+
+CpuRenderer::CpuRenderer(ThreadPool &a_thread_pool)
+    : thread_pool{a_thread_pool} {}
+
+auto CpuRenderer::compute_bounds(BrickMap const &brick_map) -> CpuSceneBounds {
+    auto result = CpuSceneBounds{
+        .min = {std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()},
+        .max = {std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()},
+    };
+    for (auto const &[coord, brick] : brick_map.bricks) {
+        result.min = {std::min(result.min.x, coord.x), std::min(result.min.y, coord.y), std::min(result.min.z, coord.z)};
+        result.max = {std::max(result.max.x, coord.x), std::max(result.max.y, coord.y), std::max(result.max.z, coord.z)};
+        result.empty = false;
+    }
+    return result;
+}
+
+auto CpuRenderer::make_ray(Camera::Basis const &basis, Camera const &camera, uint32_t x, uint32_t y, uint32_t width, uint32_t height) -> CpuRay {
+    auto const aspect = static_cast<float>(width) / static_cast<float>(height);
+    auto const u = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) * 2.0f - 1.0f) * basis.tan_half_fov_y * aspect;
+    auto const v = (1.0f - (static_cast<float>(y) + 0.5f) / static_cast<float>(height) * 2.0f) * basis.tan_half_fov_y;
+    auto result = CpuRay{.origin = camera.position};
+    auto length_squared = 0.0f;
+    for (size_t i = 0; i < 3; ++i) {
+        result.direction[i] = basis.forward[i] + basis.right[i] * u + basis.up[i] * v;
+        length_squared += result.direction[i] * result.direction[i];
+    }
+    auto const inv_length = 1.0f / std::sqrt(length_squared);
+    for (size_t i = 0; i < 3; ++i) {
+        result.direction[i] *= inv_length;
+        // Keep axis-parallel rays away from inf * 0 in the slab tests.
+        auto const d = std::abs(result.direction[i]) < 1e-20f ? 1e-20f : result.direction[i];
+        result.inv_direction[i] = 1.0f / d;
+    }
+    return result;
+}
+
+auto CpuRenderer::trace_ray(BrickMap const &brick_map, Tree64 const *tree, CpuSceneBounds const &bounds, CpuRay const &ray) -> CpuRayHit {
+    auto result = CpuRayHit{};
+    if (bounds.empty) {
+        return result;
+    }
+    auto const span = clip_to_bounds(bounds, ray);
+    if (span.t_enter >= span.t_exit) {
+        return result;
+    }
+    auto const bounds_min = std::array{bounds.min.x, bounds.min.y, bounds.min.z};
+    auto const bounds_max = std::array{bounds.max.x, bounds.max.y, bounds.max.z};
+    auto cell = std::array<int32_t, 3>{};
+    auto step = std::array<int32_t, 3>{};
+    auto t_max = std::array<float, 3>{};
+    auto t_delta = std::array<float, 3>{};
+    for (size_t i = 0; i < 3; ++i) {
+        auto const p = ray.origin[i] + ray.direction[i] * (span.t_enter + T_EPSILON);
+        cell[i] = std::clamp(static_cast<int32_t>(std::floor(p / BRICK_SIZE)), bounds_min[i], bounds_max[i]);
+        step[i] = ray.direction[i] >= 0.0f ? 1 : -1;
+        auto const boundary = static_cast<float>(cell[i] + (step[i] > 0 ? 1 : 0)) * BRICK_SIZE;
+        t_max[i] = (boundary - ray.origin[i]) * ray.inv_direction[i];
+        t_delta[i] = std::abs(ray.inv_direction[i]) * BRICK_SIZE;
+    }
+    auto t = span.t_enter;
+    auto axis = span.entry_axis;
+    while (true) {
+        if (tree != nullptr && skip_empty_node(*tree, ray, cell, step, t_max, t, axis)) {
+            if (t >= span.t_exit) {
+                return result;
+            }
+            continue;
+        }
+        auto const step_sign = axis >= 0 ? static_cast<float>(step[static_cast<size_t>(axis)]) : 0.0f;
+        if (visit_brick(brick_map, {cell[0], cell[1], cell[2]}, ray, t, axis, step_sign, result)) {
+            return result;
+        }
+        axis = argmin_axis(t_max);
+        auto const a = static_cast<size_t>(axis);
+        t = t_max[a];
+        if (t >= span.t_exit) {
+            return result;
+        }
+        cell[a] += step[a];
+        t_max[a] += t_delta[a];
+    }
+}
+
+auto CpuRenderer::shade(CpuRayHit const &hit) -> std::array<float, 3> {
+    if (hit.voxel == 0) {
+        return BACKGROUND_COLOR;
+    }
+    auto const diffuse = hit.normal_axis >= 0 ? std::max(hit.normal_sign * LIGHT_DIRECTION[static_cast<size_t>(hit.normal_axis)], 0.0f) : 0.0f;
+    auto const lighting = 0.35f + 0.65f * diffuse;
+    return {
+        static_cast<float>(hit.voxel & 0xff) / 255.0f * lighting,
+        static_cast<float>((hit.voxel >> 8) & 0xff) / 255.0f * lighting,
+        static_cast<float>((hit.voxel >> 16) & 0xff) / 255.0f * lighting,
+    };
+}
+
+auto CpuRenderer::render(BrickMap const &brick_map, Camera const &camera, CpuImage &image, Tree64 const *tree) -> CpuRenderStats {
+    auto const start = std::chrono::steady_clock::now();
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height);
+    auto const basis = camera.basis();
+    auto const bounds = compute_bounds(brick_map);
+
+    auto const tiles_x = (image.width + TILE_SIZE - 1) / TILE_SIZE;
+    auto const tiles_y = (image.height + TILE_SIZE - 1) / TILE_SIZE;
+    thread_pool.parallel_for(static_cast<size_t>(tiles_x) * tiles_y, [&](size_t tile_index) {
+        auto const x0 = static_cast<uint32_t>(tile_index % tiles_x) * TILE_SIZE;
+        auto const y0 = static_cast<uint32_t>(tile_index / tiles_x) * TILE_SIZE;
+        auto const x1 = std::min(x0 + TILE_SIZE, image.width);
+        auto const y1 = std::min(y0 + TILE_SIZE, image.height);
+        for (auto y = y0; y < y1; ++y) {
+            auto *row = image.pixels.data() + static_cast<size_t>(y) * image.width;
+            if (!use_packets || bounds.empty) {
+                for (auto x = x0; x < x1; ++x) {
+                    auto const hit = trace_ray(brick_map, tree, bounds, make_ray(basis, camera, x, y, image.width, image.height));
+                    row[x] = pack_rgba8(shade(hit));
+                }
+                continue;
+            }
+            for (auto x = x0; x < x1; x += static_cast<uint32_t>(simd::WIDTH)) {
+                auto const lane_count = std::min(static_cast<uint32_t>(simd::WIDTH), x1 - x);
+                auto rays = std::array<CpuRay, simd::WIDTH>{};
+                for (uint32_t lane = 0; lane < simd::WIDTH; ++lane) {
+                    rays[lane] = make_ray(basis, camera, std::min(x + lane, x1 - 1), y, image.width, image.height);
+                }
+                auto hits = std::array<CpuRayHit, simd::WIDTH>{};
+                trace_packet(brick_map, tree, bounds, rays, lane_count, hits);
+                for (uint32_t lane = 0; lane < lane_count; ++lane) {
+                    row[x + lane] = pack_rgba8(shade(hits[lane]));
+                }
+            }
+        }
+    });
+
+    return {
+        .ray_count = static_cast<uint64_t>(image.width) * image.height,
+        .seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+    };
+}
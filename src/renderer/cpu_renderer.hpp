@@ -0,0 +1,72 @@
+#pragma once
+
+#include <core/brick_map.hpp>
+#include <core/camera.hpp>
+#include <core/thread_pool.hpp>
+#include <core/tree64.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// RGBA8 image, row-major, top row first.
+struct CpuImage {
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<uint32_t> pixels{};
+
+    auto save_ppm(std::filesystem::path const &path) const -> bool;
+};
+
+struct CpuRay {
+    std::array<float, 3> origin{};
+    std::array<float, 3> direction{};
+    std::array<float, 3> inv_direction{};
+};
+
+struct CpuRayHit {
+    float t{};
+    // 0 on a miss.
+    uint32_t voxel{};
+    // Axis of the face that was hit, or -1 when the ray started inside a
+    // filled voxel.
+    int32_t normal_axis = -1;
+    float normal_sign{};
+};
+
+// Inclusive brick-coordinate bounds of everything stored in a BrickMap.
+struct CpuSceneBounds {
+    BrickCoord min{};
+    BrickCoord max{};
+    bool empty = true;
+};
+
+struct CpuRenderStats {
+    uint64_t ray_count{};
+    double seconds{};
+
+    auto rays_per_second() const -> double { return seconds > 0.0 ? static_cast<double>(ray_count) / seconds : 0.0; }
+};
+
+// Reference renderer for the viewport. It uses the same camera model, brick
+// traversal and shading as viewport.glsl, so its output can be compared
+// against the GPU path or used where there is no GPU (thumbnails, headless
+// golden images). The image is split into 16x16 tiles across the thread
+// pool, and each tile traces rays in SIMD packets of `simd::WIDTH`. Given a
+// Tree64 built over the same bricks, rays step over its empty nodes instead
+// of visiting every brick in them.
+struct CpuRenderer {
+    ThreadPool &thread_pool;
+    bool use_packets = true;
+
+    explicit CpuRenderer(ThreadPool &a_thread_pool);
+
+    auto render(BrickMap const &brick_map, Camera const &camera, CpuImage &image, Tree64 const *tree = nullptr) -> CpuRenderStats;
+
+    static auto compute_bounds(BrickMap const &brick_map) -> CpuSceneBounds;
+    static auto make_ray(Camera::Basis const &basis, Camera const &camera, uint32_t x, uint32_t y, uint32_t width, uint32_t height) -> CpuRay;
+    // Scalar traversal, one ray at a time.
+    static auto trace_ray(BrickMap const &brick_map, Tree64 const *tree, CpuSceneBounds const &bounds, CpuRay const &ray) -> CpuRayHit;
+    static auto shade(CpuRayHit const &hit) -> std::array<float, 3>;
+};
@@ -0,0 +1,213 @@
+#include <renderer/frame_profiler.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+
+namespace {
+    constexpr uint32_t CPU_TRACK = 1;
+    constexpr uint32_t GPU_TRACK = 2;
+
+    auto query_base(uint64_t frame_index) -> uint32_t {
+        return static_cast<uint32_t>(frame_index % FrameProfiler::QUERY_FRAME_COUNT) * FrameProfiler::MAX_TASKS_PER_FRAME * 2;
+    }
+
+    void write_json_string(std::FILE *file, std::string_view value) {
+        std::fputc('"', file);
+        for (auto c : value) {
+            if (c == '"' || c == '\\') {
+                std::fputc('\\', file);
+            }
+            std::fputc(c, file);
+        }
+        std::fputc('"', file);
+    }
+
+    void write_trace_event(std::FILE *file, bool &first, std::string_view name, uint32_t track, double start_ms, double duration_ms) {
+        std::fprintf(file, "%s\n    {\"name\": ", first ? "" : ",");
+        write_json_string(file, name);
+        std::fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", track, start_ms * 1e3, duration_ms * 1e3);
+        first = false;
+    }
+} // namespace
+
+FrameProfiler::FrameProfiler(daxa::Device a_device)
+    : device{std::move(a_device)},
+      start_time{Clock::now()},
+      history(HISTORY_FRAME_COUNT) {
+    query_pool = device.create_timeline_query_pool({
+        .query_count = QUERY_FRAME_COUNT * MAX_TASKS_PER_FRAME * 2,
+        .name = "frame_profiler",
+    });
+    timestamp_period_ns = static_cast<double>(device.properties().limits.timestamp_period);
+}
+
+auto FrameProfiler::now_ms() const -> double {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+}
+
+auto FrameProfiler::current_frame() -> FrameTiming & {
+    return history[(frame_count - 1) % HISTORY_FRAME_COUNT];
+}
+
+void FrameProfiler::begin_frame() {
+    auto const now = now_ms();
+    if (frame_count != 0) {
+        auto &previous = current_frame();
+        previous.cpu_ms = now - previous.cpu_start_ms;
+    }
+    // This frame reuses the query slot of the frame QUERY_FRAME_COUNT ago,
+    // so collect that frame's results first.
+    if (frame_count >= QUERY_FRAME_COUNT) {
+        resolve_gpu_timings(frame_count - QUERY_FRAME_COUNT);
+    }
+    auto &frame = history[frame_count % HISTORY_FRAME_COUNT];
+    frame.frame_index = frame_count;
+    frame.cpu_start_ms = now;
+    frame.cpu_ms = 0.0;
+    frame.tasks.clear();
+    query_slot_reset[frame_count % QUERY_FRAME_COUNT] = false;
+    ++frame_count;
+}
+
+auto FrameProfiler::begin_task(std::string_view name, daxa::CommandRecorder &recorder) -> uint32_t {
+    if (frame_count == 0) {
+        begin_frame();
+    }
+    auto &frame = current_frame();
+    auto const task_index = static_cast<uint32_t>(frame.tasks.size());
+    frame.tasks.push_back({.name = std::string{name}, .cpu_start_ms = now_ms()});
+    if (task_index < MAX_TASKS_PER_FRAME) {
+        auto const base = query_base(frame.frame_index);
+        auto &slot_reset = query_slot_reset[frame.frame_index % QUERY_FRAME_COUNT];
+        if (!slot_reset) {
+            recorder.reset_timestamps({
+                .query_pool = query_pool,
+                .start_index = base,
+                .count = MAX_TASKS_PER_FRAME * 2,
+            });
+            slot_reset = true;
+        }
+        recorder.write_timestamp({
+            .query_pool = query_pool,
+            .pipeline_stage = daxa::PipelineStageFlagBits::TOP_OF_PIPE,
+            .query_index = base + task_index * 2,
+        });
+    }
+    return task_index;
+}
+
+void FrameProfiler::end_task(uint32_t task_index, daxa::CommandRecorder &recorder) {
+    auto &frame = current_frame();
+    auto &task = frame.tasks[task_index];
+    task.cpu_ms = now_ms() - task.cpu_start_ms;
+    if (task_index < MAX_TASKS_PER_FRAME) {
+        recorder.write_timestamp({
+            .query_pool = query_pool,
+            .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
+            .query_index = query_base(frame.frame_index) + task_index * 2 + 1,
+        });
+    }
+}
+
+void FrameProfiler::resolve_gpu_timings(uint64_t frame_index) {
+    auto &frame = history[frame_index % HISTORY_FRAME_COUNT];
+    if (frame.frame_index != frame_index) {
+        return;
+    }
+    auto const query_task_count = std::min(static_cast<uint32_t>(frame.tasks.size()), MAX_TASKS_PER_FRAME);
+    if (query_task_count == 0) {
+        return;
+    }
+    // Each query comes back as a (value, availability) pair.
+    auto const results = query_pool.get_query_results(query_base(frame_index), query_task_count * 2);
+    auto first_start = std::optional<uint64_t>{};
+    for (uint32_t i = 0; i < query_task_count; ++i) {
+        auto const start = results[i * 4 + 0];
+        auto const start_available = results[i * 4 + 1] != 0;
+        auto const end = results[i * 4 + 2];
+        auto const end_available = results[i * 4 + 3] != 0;
+        if (!start_available || !end_available) {
+            continue;
+        }
+        if (!first_start) {
+            first_start = start;
+        }
+        auto &task = frame.tasks[i];
+        task.gpu_ms = static_cast<double>(end - start) * timestamp_period_ns * 1e-6;
+        task.gpu_start_ms = frame.cpu_start_ms + static_cast<double>(start - *first_start) * timestamp_period_ns * 1e-6;
+    }
+}
+
+auto FrameProfiler::summary(size_t frame_count_to_average) const -> std::vector<TaskTimingSummary> {
+    struct Accumulator {
+        double cpu_ms{};
+        size_t cpu_count{};
+        double gpu_ms{};
+        size_t gpu_count{};
+    };
+    auto result = std::vector<TaskTimingSummary>{};
+    auto accumulators = std::vector<Accumulator>{};
+    // Skip the frame in progress, its tasks may not have run yet.
+    auto const complete_count = frame_count != 0 ? frame_count - 1 : 0;
+    auto const first = complete_count - std::min<uint64_t>({complete_count, frame_count_to_average, HISTORY_FRAME_COUNT - 1});
+    for (auto frame_index = first; frame_index < complete_count; ++frame_index) {
+        for (auto const &task : history[frame_index % HISTORY_FRAME_COUNT].tasks) {
+            auto iter = std::find_if(result.begin(), result.end(), [&](TaskTimingSummary const &entry) { return entry.name == task.name; });
+            if (iter == result.end()) {
+                result.push_back({.name = task.name});
+                accumulators.emplace_back();
+                iter = result.end() - 1;
+            }
+            auto &accumulator = accumulators[static_cast<size_t>(iter - result.begin())];
+            accumulator.cpu_ms += task.cpu_ms;
+            ++accumulator.cpu_count;
+            if (task.gpu_ms >= 0.0) {
+                accumulator.gpu_ms += task.gpu_ms;
+                ++accumulator.gpu_count;
+            }
+        }
+    }
+    for (size_t i = 0; i < result.size(); ++i) {
+        auto const &accumulator = accumulators[i];
+        result[i].cpu_ms = accumulator.cpu_ms / static_cast<double>(accumulator.cpu_count);
+        result[i].gpu_ms = accumulator.gpu_count != 0 ? accumulator.gpu_ms / static_cast<double>(accumulator.gpu_count) : -1.0;
+    }
+    return result;
+}
+
+auto FrameProfiler::average_frame_ms(size_t frame_count_to_average) const -> double {
+    auto const complete_count = frame_count != 0 ? frame_count - 1 : 0;
+    auto const count = std::min<uint64_t>({complete_count, frame_count_to_average, HISTORY_FRAME_COUNT - 1});
+    auto total = 0.0;
+    for (auto frame_index = complete_count - count; frame_index < complete_count; ++frame_index) {
+        total += history[frame_index % HISTORY_FRAME_COUNT].cpu_ms;
+    }
+    return count != 0 ? total / static_cast<double>(count) : 0.0;
+}
+
+auto FrameProfiler::write_chrome_trace(std::filesystem::path const &path) const -> bool {
+    auto *file = std::fopen(path.string().c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    std::fprintf(file, "\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"CPU\"}},", CPU_TRACK);
+    std::fprintf(file, "\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"GPU\"}}", GPU_TRACK);
+    auto first = false;
+    auto const oldest = frame_count > HISTORY_FRAME_COUNT ? frame_count - HISTORY_FRAME_COUNT : 0;
+    for (auto frame_index = oldest; frame_index < frame_count; ++frame_index) {
+        auto const &frame = history[frame_index % HISTORY_FRAME_COUNT];
+        if (frame.cpu_ms > 0.0) {
+            write_trace_event(file, first, "frame " + std::to_string(frame.frame_index), CPU_TRACK, frame.cpu_start_ms, frame.cpu_ms);
+        }
+        for (auto const &task : frame.tasks) {
+            write_trace_event(file, first, task.name, CPU_TRACK, task.cpu_start_ms, task.cpu_ms);
+            if (task.gpu_ms >= 0.0) {
+                write_trace_event(file, first, task.name, GPU_TRACK, task.gpu_start_ms, task.gpu_ms);
+            }
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
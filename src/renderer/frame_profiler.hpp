@@ -0,0 +1,104 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct TaskTiming {
+    std::string name{};
+    // Milliseconds since the profiler was created.
+    double cpu_start_ms{};
+    double cpu_ms{};
+    // Negative until the GPU results for the frame have come back.
+    double gpu_start_ms = -1.0;
+    double gpu_ms = -1.0;
+};
+
+struct FrameTiming {
+    uint64_t frame_index{};
+    double cpu_start_ms{};
+    // Time from this frame's `begin_frame` to the next one's.
+    double cpu_ms{};
+    std::vector<TaskTiming> tasks{};
+};
+
+struct TaskTimingSummary {
+    std::string name{};
+    double cpu_ms{};
+    double gpu_ms{};
+};
+
+// Times every task-graph task of the last HISTORY_FRAME_COUNT frames. CPU
+// time is how long the task's callback took to record. GPU time comes from
+// timestamps written around the task's commands, which are read back a few
+// frames later once the GPU is surely done with them.
+class FrameProfiler {
+  public:
+    static inline constexpr size_t HISTORY_FRAME_COUNT = 240;
+    static inline constexpr uint32_t MAX_TASKS_PER_FRAME = 32;
+    // Frames whose timestamp queries can be in flight at once.
+    static inline constexpr uint32_t QUERY_FRAME_COUNT = 4;
+
+    explicit FrameProfiler(daxa::Device a_device);
+    ~FrameProfiler() = default;
+    FrameProfiler(const FrameProfiler &) = delete;
+    FrameProfiler(FrameProfiler &&) = delete;
+    auto operator=(const FrameProfiler &) -> FrameProfiler & = delete;
+    auto operator=(FrameProfiler &&) -> FrameProfiler & = delete;
+
+    void begin_frame();
+    auto begin_task(std::string_view name, daxa::CommandRecorder &recorder) -> uint32_t;
+    void end_task(uint32_t task_index, daxa::CommandRecorder &recorder);
+
+    // Per-task averages over the last `frame_count` complete frames, in the
+    // order the tasks ran.
+    auto summary(size_t frame_count) const -> std::vector<TaskTimingSummary>;
+    auto average_frame_ms(size_t frame_count) const -> double;
+    // Writes the whole history as Chrome trace events, which chrome://tracing
+    // and Perfetto both open. GPU tasks go on their own track, lined up with
+    // the start of the frame on the CPU.
+    auto write_chrome_trace(std::filesystem::path const &path) const -> bool;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    daxa::Device device;
+    daxa::TimelineQueryPool query_pool{};
+    double timestamp_period_ns{};
+    Clock::time_point start_time{};
+    std::vector<FrameTiming> history{};
+    uint64_t frame_count{};
+    std::array<bool, QUERY_FRAME_COUNT> query_slot_reset{};
+
+    auto now_ms() const -> double;
+    auto current_frame() -> FrameTiming &;
+    void resolve_gpu_timings(uint64_t frame_index);
+};
+
+// Times one task for as long as it is alive. Does nothing without a profiler.
+struct ProfileTaskScope {
+    FrameProfiler *profiler;
+    daxa::CommandRecorder &recorder;
+    uint32_t task_index{};
+
+    ProfileTaskScope(FrameProfiler *a_profiler, std::string_view name, daxa::CommandRecorder &a_recorder)
+        : profiler{a_profiler}, recorder{a_recorder} {
+        if (profiler != nullptr) {
+            task_index = profiler->begin_task(name, recorder);
+        }
+    }
+    ~ProfileTaskScope() {
+        if (profiler != nullptr) {
+            profiler->end_task(task_index, recorder);
+        }
+    }
+    ProfileTaskScope(const ProfileTaskScope &) = delete;
+    ProfileTaskScope(ProfileTaskScope &&) = delete;
+    auto operator=(const ProfileTaskScope &) -> ProfileTaskScope & = delete;
+    auto operator=(ProfileTaskScope &&) -> ProfileTaskScope & = delete;
+};
@@ -0,0 +1,350 @@
+#include <renderer/gpu_scene.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    auto align_down(int32_t value, int32_t alignment) -> int32_t {
+        return (value >= 0 ? value / alignment : -((-value + alignment - 1) / alignment)) * alignment;
+    }
+} // namespace
+
+GpuScene::GpuScene(daxa::Device a_device, VoxelScene &a_scene)
+    : device{std::move(a_device)},
+      scene{a_scene},
+      task_brick_table{daxa::TaskBufferInfo{.name = "brick_table"}},
+      task_brick_pool{daxa::TaskBufferInfo{.name = "brick_pool"}} {
+    brick_table = device.create_buffer({
+        .size = static_cast<uint32_t>(brick_table_bytes()),
+        .name = "brick_table",
+    });
+    staging_buffer = device.create_buffer({
+        .size = static_cast<uint32_t>(STAGING_PARTITION_BYTES * STAGING_PARTITION_COUNT),
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+        .name = "brick_staging_ring",
+    });
+    slot_capacity = INITIAL_BRICK_POOL_CAPACITY;
+    brick_pool = device.create_buffer({
+        .size = static_cast<uint32_t>(slot_capacity * BRICK_BYTES),
+        .name = "brick_pool",
+    });
+    task_brick_table.set_buffers({.buffers = std::span{&brick_table, 1}});
+    task_brick_pool.set_buffers({.buffers = std::span{&brick_pool, 1}});
+}
+
+GpuScene::~GpuScene() {
+    device.destroy_buffer(brick_table);
+    device.destroy_buffer(brick_pool);
+    device.destroy_buffer(staging_buffer);
+    if (!retired_brick_table.is_empty()) {
+        device.destroy_buffer(retired_brick_table);
+    }
+    if (!retired_brick_pool.is_empty()) {
+        device.destroy_buffer(retired_brick_pool);
+    }
+}
+
+void GpuScene::update(uint64_t frame_timeline_value, uint64_t completed_timeline_value) {
+    last_upload_stats = {};
+    if (partition_timeline_values[partition_index] > completed_timeline_value) {
+        // The GPU may still be copying out of the partition. The dirty
+        // bricks stay queued until it's free.
+        return;
+    }
+    auto const partition_offset = partition_index * STAGING_PARTITION_BYTES;
+    auto *staging = device.get_host_address_as<std::byte>(staging_buffer).value() + partition_offset;
+    auto staging_cursor = size_t{};
+
+    // Whatever doesn't fit in this frame's partition stays dirty for the next
+    // frame, keeping a big load from stalling any single frame.
+    auto const max_bricks = (STAGING_PARTITION_BYTES - TABLE_STAGING_BYTES) / BRICK_BYTES;
+    auto const dirty_bricks = scene.brick_map.drain_dirty_bricks(max_bricks);
+    scene.queue_tree_refit(dirty_bricks);
+
+    // A removed brick outside the grid never had an entry to clear.
+    auto const outside_grid = [&](BrickCoord coord) {
+        auto iter = scene.brick_map.bricks.find(coord);
+        return !brick_table_index(coord) && iter != scene.brick_map.bricks.end() && !iter->second.is_empty();
+    };
+    if (std::any_of(dirty_bricks.begin(), dirty_bricks.end(), outside_grid) && !fit_brick_grid() && dropped_brick_count == 0) {
+        std::cerr << "the scene needs a brick table over " << MAX_BRICK_GRID_ENTRY_COUNT << " entries, bricks outside the current grid are not uploaded to the GPU" << std::endl;
+    }
+
+    for (auto const &coord : dirty_bricks) {
+        auto const table_index = brick_table_index(coord);
+        if (!table_index) {
+            if (outside_grid(coord)) {
+                ++dropped_brick_count;
+                ++last_upload_stats.dropped_brick_count;
+            }
+            continue;
+        }
+        auto entry = uint32_t{0};
+        auto iter = scene.brick_map.bricks.find(coord);
+        if (iter == scene.brick_map.bricks.end() || iter->second.is_empty()) {
+            release_slot(coord);
+        } else if (iter->second.is_uniform()) {
+            release_slot(coord);
+            entry = VIEWPORT_BRICK_TABLE_UNIFORM_BIT | (iter->second.uniform_value & ~VIEWPORT_BRICK_TABLE_UNIFORM_BIT);
+        } else {
+            auto const slot = acquire_slot(coord);
+            std::memcpy(staging + staging_cursor, iter->second.data->voxels.data(), BRICK_BYTES);
+            pending_copies.push_back({
+                .src_offset = partition_offset + staging_cursor,
+                .dst_offset = slot * BRICK_BYTES,
+                .size = BRICK_BYTES,
+            });
+            staging_cursor += BRICK_BYTES;
+            ++last_upload_stats.brick_count;
+            // Slot indices are stored off by one so that 0 can mean empty.
+            entry = slot + 1;
+        }
+        if (brick_table_cpu[*table_index] != entry) {
+            brick_table_cpu[*table_index] = entry;
+            pending_table_entries.push_back(*table_index);
+        }
+    }
+
+    // Changed entries go out as ranges, merging ones that are close enough
+    // that copying the entries in between beats issuing another copy. What
+    // doesn't fit, like most of a freshly grown table, waits for later frames.
+    std::sort(pending_table_entries.begin(), pending_table_entries.end());
+    pending_table_entries.erase(std::unique(pending_table_entries.begin(), pending_table_entries.end()), pending_table_entries.end());
+    auto next_entry = pending_table_entries.begin();
+    while (next_entry != pending_table_entries.end()) {
+        auto const available_entries = (STAGING_PARTITION_BYTES - staging_cursor) / sizeof(uint32_t);
+        if (available_entries == 0) {
+            break;
+        }
+        auto const first = *next_entry;
+        auto run_end = next_entry + 1;
+        while (run_end != pending_table_entries.end() && *run_end - *(run_end - 1) <= MAX_TABLE_RUN_GAP && *run_end - first < available_entries) {
+            ++run_end;
+        }
+        auto const run_bytes = (*(run_end - 1) - first + 1) * sizeof(uint32_t);
+        std::memcpy(staging + staging_cursor, &brick_table_cpu[first], run_bytes);
+        pending_copies.push_back({
+            .src_offset = partition_offset + staging_cursor,
+            .dst_offset = first * sizeof(uint32_t),
+            .size = run_bytes,
+            .to_brick_table = true,
+        });
+        staging_cursor += run_bytes;
+        last_upload_stats.table_entry_count += static_cast<uint32_t>(run_end - next_entry);
+        next_entry = run_end;
+    }
+    pending_table_entries.erase(pending_table_entries.begin(), next_entry);
+    last_upload_stats.byte_count = staging_cursor;
+    if (staging_cursor != 0) {
+        partition_timeline_values[partition_index] = frame_timeline_value;
+        partition_index = (partition_index + 1) % STAGING_PARTITION_COUNT;
+    }
+}
+
+void GpuScene::record_upload(daxa::TaskGraph &task_graph, FrameProfiler *profiler) {
+    task_graph.use_persistent_buffer(task_brick_table);
+    task_graph.use_persistent_buffer(task_brick_pool);
+    task_graph.add_task({
+        .uses = {
+            daxa::TaskBufferUse<daxa::TaskBufferAccess::TRANSFER_WRITE>{task_brick_table},
+            daxa::TaskBufferUse<daxa::TaskBufferAccess::TRANSFER_WRITE>{task_brick_pool},
+        },
+        .task = [this, profiler](daxa::TaskInterface const &ti) {
+            auto &recorder = ti.get_recorder();
+            auto profile_scope = ProfileTaskScope(profiler, "upload dirty bricks", recorder);
+            auto const table_buffer = ti.uses[task_brick_table].buffer();
+            auto const pool_buffer = ti.uses[task_brick_pool].buffer();
+            if (!retired_brick_table.is_empty()) {
+                recorder.destroy_buffer_deferred(retired_brick_table);
+                retired_brick_table = {};
+            }
+            if (brick_table_needs_clear) {
+                recorder.clear_buffer({
+                    .buffer = table_buffer,
+                    .offset = 0,
+                    .size = brick_table_bytes(),
+                    .clear_value = 0,
+                });
+                recorder.pipeline_barrier({
+                    .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+                    .dst_access = daxa::AccessConsts::TRANSFER_WRITE,
+                });
+                brick_table_needs_clear = false;
+            }
+            if (!retired_brick_pool.is_empty()) {
+                // The old pool may still have reads from the previous frame
+                // in flight on this queue.
+                recorder.pipeline_barrier({
+                    .src_access = daxa::AccessConsts::COMPUTE_SHADER_READ | daxa::AccessConsts::TRANSFER_WRITE,
+                    .dst_access = daxa::AccessConsts::TRANSFER_READ,
+                });
+                recorder.copy_buffer_to_buffer({
+                    .src_buffer = retired_brick_pool,
+                    .dst_buffer = pool_buffer,
+                    .size = retired_brick_pool_size,
+                });
+                recorder.destroy_buffer_deferred(retired_brick_pool);
+                retired_brick_pool = {};
+                recorder.pipeline_barrier({
+                    .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+                    .dst_access = daxa::AccessConsts::TRANSFER_WRITE,
+                });
+            }
+            if (pending_copies.empty()) {
+                return;
+            }
+            recorder.pipeline_barrier({
+                .src_access = daxa::AccessConsts::HOST_WRITE,
+                .dst_access = daxa::AccessConsts::TRANSFER_READ,
+            });
+            for (auto const &copy : pending_copies) {
+                recorder.copy_buffer_to_buffer({
+                    .src_buffer = staging_buffer,
+                    .src_offset = copy.src_offset,
+                    .dst_buffer = copy.to_brick_table ? table_buffer : pool_buffer,
+                    .dst_offset = copy.dst_offset,
+                    .size = copy.size,
+                });
+            }
+            pending_copies.clear();
+        },
+        .name = "upload dirty bricks",
+    });
+}
+
+auto GpuScene::brick_table_index(BrickCoord coord) const -> std::optional<size_t> {
+    auto const x = coord.x - brick_grid_origin.x;
+    auto const y = coord.y - brick_grid_origin.y;
+    auto const z = coord.z - brick_grid_origin.z;
+    if (x < 0 || y < 0 || z < 0 || static_cast<uint32_t>(x) >= brick_grid_size.x || static_cast<uint32_t>(y) >= brick_grid_size.y || static_cast<uint32_t>(z) >= brick_grid_size.z) {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(x) + (static_cast<size_t>(y) + static_cast<size_t>(z) * brick_grid_size.y) * brick_grid_size.x;
+}
+
+auto GpuScene::fit_brick_grid() -> bool {
+    auto lo = std::array{INT32_MAX, INT32_MAX, INT32_MAX};
+    auto hi = std::array{INT32_MIN, INT32_MIN, INT32_MIN};
+    auto const include = [&](int32_t x, int32_t y, int32_t z) {
+        auto const c = std::array{x, y, z};
+        for (size_t i = 0; i < 3; ++i) {
+            lo[i] = std::min(lo[i], c[i]);
+            hi[i] = std::max(hi[i], c[i]);
+        }
+    };
+    for (auto const &[coord, brick] : scene.brick_map.bricks) {
+        include(coord.x, coord.y, coord.z);
+    }
+    if (lo[0] > hi[0]) {
+        return true;
+    }
+    // The grid only grows, so entries already uploaded keep their meaning.
+    auto const old_origin = brick_grid_origin;
+    auto const old_size = brick_grid_size;
+    if (old_size.x != 0) {
+        include(old_origin.x, old_origin.y, old_origin.z);
+        include(old_origin.x + static_cast<int32_t>(old_size.x) - 1, old_origin.y + static_cast<int32_t>(old_size.y) - 1, old_origin.z + static_cast<int32_t>(old_size.z) - 1);
+    }
+    auto origin = std::array<int32_t, 3>{};
+    auto size = std::array<uint32_t, 3>{};
+    auto entry_count = size_t{1};
+    for (size_t i = 0; i < 3; ++i) {
+        origin[i] = align_down(lo[i], BRICK_GRID_ALIGNMENT);
+        size[i] = std::bit_ceil(std::max(static_cast<uint32_t>(hi[i] - origin[i] + 1), static_cast<uint32_t>(BRICK_GRID_ALIGNMENT)));
+        entry_count *= size[i];
+    }
+    if (entry_count > MAX_BRICK_GRID_ENTRY_COUNT) {
+        return false;
+    }
+    if (origin[0] == old_origin.x && origin[1] == old_origin.y && origin[2] == old_origin.z && size[0] == old_size.x && size[1] == old_size.y && size[2] == old_size.z) {
+        return true;
+    }
+
+    // Carry the existing entries over to their place in the new grid. The
+    // new table starts out cleared on the GPU, so only non-empty entries
+    // need uploading.
+    auto old_table = std::move(brick_table_cpu);
+    brick_grid_origin = {origin[0], origin[1], origin[2]};
+    brick_grid_size = {size[0], size[1], size[2]};
+    brick_table_cpu = std::vector<uint32_t>(entry_count);
+    pending_table_entries.clear();
+    std::erase_if(pending_copies, [](PendingCopy const &copy) { return copy.to_brick_table; });
+    for (uint32_t z = 0; z < old_size.z; ++z) {
+        for (uint32_t y = 0; y < old_size.y; ++y) {
+            for (uint32_t x = 0; x < old_size.x; ++x) {
+                auto const entry = old_table[x + (y + z * old_size.y) * old_size.x];
+                if (entry == 0) {
+                    continue;
+                }
+                auto const coord = BrickCoord{old_origin.x + static_cast<int32_t>(x), old_origin.y + static_cast<int32_t>(y), old_origin.z + static_cast<int32_t>(z)};
+                auto const index = *brick_table_index(coord);
+                brick_table_cpu[index] = entry;
+                pending_table_entries.push_back(index);
+            }
+        }
+    }
+
+    auto new_table = device.create_buffer({
+        .size = static_cast<uint32_t>(brick_table_bytes()),
+        .name = "brick_table",
+    });
+    if (retired_brick_table.is_empty()) {
+        retired_brick_table = brick_table;
+    } else {
+        // Grown twice before an upload ran, so the intermediate table was
+        // never used on the GPU.
+        device.destroy_buffer(brick_table);
+    }
+    brick_table = new_table;
+    brick_table_needs_clear = true;
+    task_brick_table.set_buffers({.buffers = std::span{&brick_table, 1}});
+    std::cout << "brick table grid: " << size[0] << "x" << size[1] << "x" << size[2] << " bricks from (" << origin[0] << ", " << origin[1] << ", " << origin[2] << ")" << std::endl;
+    return true;
+}
+
+auto GpuScene::acquire_slot(BrickCoord coord) -> uint32_t {
+    if (auto iter = brick_slots.find(coord); iter != brick_slots.end()) {
+        return iter->second;
+    }
+    auto slot = uint32_t{};
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        if (slot_high_water == slot_capacity) {
+            grow_brick_pool();
+        }
+        slot = slot_high_water++;
+    }
+    brick_slots.emplace(coord, slot);
+    return slot;
+}
+
+void GpuScene::release_slot(BrickCoord coord) {
+    if (auto iter = brick_slots.find(coord); iter != brick_slots.end()) {
+        free_slots.push_back(iter->second);
+        brick_slots.erase(iter);
+    }
+}
+
+void GpuScene::grow_brick_pool() {
+    auto const old_size = static_cast<size_t>(slot_capacity) * BRICK_BYTES;
+    slot_capacity *= 2;
+    auto new_pool = device.create_buffer({
+        .size = static_cast<uint32_t>(slot_capacity * BRICK_BYTES),
+        .name = "brick_pool",
+    });
+    if (retired_brick_pool.is_empty()) {
+        retired_brick_pool = brick_pool;
+        retired_brick_pool_size = old_size;
+    } else {
+        // Grown twice before an upload ran: the intermediate pool was never
+        // used on the GPU, and the oldest one still holds the data to keep.
+        device.destroy_buffer(brick_pool);
+    }
+    brick_pool = new_pool;
+    task_brick_pool.set_buffers({.buffers = std::span{&brick_pool, 1}});
+}
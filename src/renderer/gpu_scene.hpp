@@ -0,0 +1,115 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+#include <daxa/utils/task_graph.hpp>
+
+#include <core/scene.hpp>
+#include <renderer/frame_profiler.hpp>
+#include <renderer/viewport.inl>
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+struct GpuSceneUploadStats {
+    uint32_t brick_count{};
+    uint32_t table_entry_count{};
+    size_t byte_count{};
+    // Bricks outside the largest grid the brick table may cover, which the
+    // viewport can't show.
+    uint32_t dropped_brick_count{};
+};
+
+// Device-resident copy of the scene's bricks. Each frame, `update` drains the
+// scene's dirty bricks and stages only those into a persistent host-visible
+// ring, which the upload task then copies into the persistent brick table and
+// brick pool. The ring is split into one partition per frame in flight, and a
+// partition is only rewritten once the timeline value of the frame that last
+// read it has been reached. If it hasn't, staging waits for a later frame.
+//
+// The brick table covers a grid fitted to the scene's bounds. When a brick
+// lands outside of it, the grid grows to the scene's new bounds, aligned and
+// rounded up to powers of two so that a growing scene only resizes it a few
+// times. The new table is rebuilt on the CPU and streamed in like any other
+// table change. Only bricks past MAX_BRICK_GRID_ENTRY_COUNT are dropped.
+struct GpuScene {
+    static inline constexpr size_t BRICK_BYTES = VIEWPORT_BRICK_VOXEL_COUNT * sizeof(uint32_t);
+    // 256^3 bricks, or 2048^3 voxels, in a 64 MiB table.
+    static inline constexpr size_t MAX_BRICK_GRID_ENTRY_COUNT = size_t{1} << 24;
+    static inline constexpr int32_t BRICK_GRID_ALIGNMENT = 16;
+    static inline constexpr size_t STAGING_PARTITION_COUNT = 3;
+    static inline constexpr size_t STAGING_PARTITION_BYTES = size_t{8} << 20;
+    // Staging space each frame keeps for table entries, the rest is bricks.
+    static inline constexpr size_t TABLE_STAGING_BYTES = size_t{1} << 20;
+    // Changed table entries this close together are copied as one range.
+    static inline constexpr size_t MAX_TABLE_RUN_GAP = 16;
+    static inline constexpr uint32_t INITIAL_BRICK_POOL_CAPACITY = 4096;
+
+    daxa::Device device;
+    VoxelScene &scene;
+
+    daxa::BufferId brick_table{};
+    daxa::BufferId brick_pool{};
+    daxa::BufferId staging_buffer{};
+    daxa::TaskBuffer task_brick_table;
+    daxa::TaskBuffer task_brick_pool;
+
+    GpuSceneUploadStats last_upload_stats{};
+    // In bricks, passed to the render shader.
+    daxa_i32vec3 brick_grid_origin{};
+    daxa_u32vec3 brick_grid_size{};
+
+    explicit GpuScene(daxa::Device a_device, VoxelScene &a_scene);
+    ~GpuScene();
+
+    GpuScene(const GpuScene &) = delete;
+    GpuScene(GpuScene &&) = delete;
+    auto operator=(const GpuScene &) -> GpuScene & = delete;
+    auto operator=(GpuScene &&) -> GpuScene & = delete;
+
+    // Stages this frame's dirty bricks. Call once per frame before the task
+    // graph executes. `frame_timeline_value` is what the submission of this
+    // frame signals, `completed_timeline_value` what the GPU has reached.
+    void update(uint64_t frame_timeline_value, uint64_t completed_timeline_value);
+    void record_upload(daxa::TaskGraph &task_graph, FrameProfiler *profiler);
+
+  private:
+    struct PendingCopy {
+        size_t src_offset{};
+        size_t dst_offset{};
+        size_t size{};
+        bool to_brick_table{};
+    };
+
+    std::vector<uint32_t> brick_table_cpu = std::vector<uint32_t>(1);
+    // Table entries that changed but haven't been staged yet.
+    std::vector<size_t> pending_table_entries{};
+    std::unordered_map<BrickCoord, uint32_t, BrickCoordHash> brick_slots{};
+    std::vector<uint32_t> free_slots{};
+    uint32_t slot_capacity{};
+    uint32_t slot_high_water{};
+
+    std::vector<PendingCopy> pending_copies{};
+    // The pool buffer from before a resize, copied into the new one by the
+    // next upload and then destroyed.
+    daxa::BufferId retired_brick_pool{};
+    size_t retired_brick_pool_size{};
+    // The table buffer from before the grid grew, destroyed by the next
+    // upload.
+    daxa::BufferId retired_brick_table{};
+    bool brick_table_needs_clear = true;
+    size_t partition_index{};
+    // The timeline value of the last frame that staged into each partition.
+    std::array<uint64_t, STAGING_PARTITION_COUNT> partition_timeline_values{};
+    uint64_t dropped_brick_count{};
+
+    auto brick_table_index(BrickCoord coord) const -> std::optional<size_t>;
+    auto brick_table_bytes() const -> size_t { return brick_table_cpu.size() * sizeof(uint32_t); }
+    // Grows the grid to cover every brick in the scene. Returns false if that
+    // would take more than MAX_BRICK_GRID_ENTRY_COUNT entries.
+    auto fit_brick_grid() -> bool;
+    auto acquire_slot(BrickCoord coord) -> uint32_t;
+    void release_slot(BrickCoord coord);
+    void grow_brick_pool();
+};
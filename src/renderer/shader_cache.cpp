@@ -0,0 +1,249 @@
+#include <renderer/shader_cache.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <sstream>
+
+namespace {
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+    // FNV-1a. Keys only need to tell sources apart, not resist collisions.
+    void hash_bytes(uint64_t &hash, void const *data, size_t size) {
+        auto const *bytes = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    }
+    void hash_string(uint64_t &hash, std::string_view value) {
+        auto const size = static_cast<uint64_t>(value.size());
+        hash_bytes(hash, &size, sizeof(size));
+        hash_bytes(hash, value.data(), value.size());
+    }
+
+    auto read_text(std::filesystem::path const &path) -> std::optional<std::string> {
+        auto file = std::ifstream{path, std::ios::binary};
+        if (!file) {
+            return std::nullopt;
+        }
+        auto stream = std::ostringstream{};
+        stream << file.rdbuf();
+        return stream.str();
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds_since(Clock::time_point start) -> double {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+} // namespace
+
+ShaderCache::ShaderCache(daxa::Device a_device, std::filesystem::path a_directory, daxa::ShaderCompileOptions a_default_options)
+    : device{std::move(a_device)},
+      directory{std::move(a_directory)},
+      default_options{std::move(a_default_options)} {
+    auto error = std::error_code{};
+    std::filesystem::create_directories(directory, error);
+}
+
+auto ShaderCache::stats() const -> ShaderCacheStats {
+    auto lock = std::lock_guard{stats_mutex};
+    return cache_stats;
+}
+
+void ShaderCache::record(uint32_t hit_count, uint32_t miss_count, double milliseconds) {
+    auto lock = std::lock_guard{stats_mutex};
+    cache_stats.hit_count += hit_count;
+    cache_stats.miss_count += miss_count;
+    cache_stats.milliseconds += milliseconds;
+}
+
+auto ShaderCache::resolve(std::filesystem::path const &path, std::filesystem::path const &including_directory) const -> std::optional<std::filesystem::path> {
+    auto error = std::error_code{};
+    if (!including_directory.empty() && std::filesystem::is_regular_file(including_directory / path, error)) {
+        return including_directory / path;
+    }
+    for (auto const &root : default_options.root_paths) {
+        if (std::filesystem::is_regular_file(root / path, error)) {
+            return root / path;
+        }
+    }
+    return std::nullopt;
+}
+
+void ShaderCache::hash_includes(uint64_t &hash, std::string const &source, std::filesystem::path const &source_directory, std::vector<std::filesystem::path> &visited) const {
+    static auto const include_pattern = std::regex{R"(^\s*#\s*include\s*[<"]([^>"]+)[>"])", std::regex::multiline};
+    for (auto iter = std::sregex_iterator(source.begin(), source.end(), include_pattern); iter != std::sregex_iterator(); ++iter) {
+        auto const include_path = resolve((*iter)[1].str(), source_directory);
+        if (!include_path) {
+            // Left for the compiler to report, if it's not a virtual include.
+            hash_string(hash, (*iter)[1].str());
+            continue;
+        }
+        auto const canonical = std::filesystem::weakly_canonical(*include_path);
+        if (std::find(visited.begin(), visited.end(), canonical) != visited.end()) {
+            continue;
+        }
+        visited.push_back(canonical);
+        auto const include_source = read_text(*include_path);
+        if (!include_source) {
+            continue;
+        }
+        hash_string(hash, *include_source);
+        hash_includes(hash, *include_source, include_path->parent_path(), visited);
+    }
+}
+
+auto ShaderCache::key_of(daxa::ShaderCompileInfo const &shader_info, std::string_view stage) const -> std::optional<std::string> {
+    auto hash = uint64_t{0xcbf29ce484222325};
+    hash_bytes(hash, &FORMAT_VERSION, sizeof(FORMAT_VERSION));
+    hash_string(hash, stage);
+
+    auto source = std::string{};
+    auto source_directory = std::filesystem::path{};
+    if (auto const *file = std::get_if<daxa::ShaderFile>(&shader_info.source)) {
+        auto const path = resolve(file->path, {});
+        auto const text = path ? read_text(*path) : std::nullopt;
+        if (!text) {
+            return std::nullopt;
+        }
+        source = *text;
+        source_directory = path->parent_path();
+    } else if (auto const *code = std::get_if<daxa::ShaderCode>(&shader_info.source)) {
+        source = code->string;
+    } else {
+        return std::nullopt;
+    }
+    hash_string(hash, source);
+    auto visited = std::vector<std::filesystem::path>{};
+    hash_includes(hash, source, source_directory, visited);
+
+    auto const &options = shader_info.compile_options;
+    for (auto const *defines : {&default_options.defines, &options.defines}) {
+        for (auto const &define : *defines) {
+            hash_string(hash, define.name);
+            hash_string(hash, define.value);
+        }
+    }
+    auto const language = static_cast<int32_t>(options.language.value_or(default_options.language.value_or(daxa::ShaderLanguage::GLSL)));
+    auto const debug_info = options.enable_debug_info.value_or(default_options.enable_debug_info.value_or(false));
+    hash_bytes(hash, &language, sizeof(language));
+    hash_bytes(hash, &debug_info, sizeof(debug_info));
+
+    auto key = std::string(16, '0');
+    std::snprintf(key.data(), key.size() + 1, "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
+
+auto ShaderCache::load(std::string const &key) const -> std::vector<uint32_t> {
+    auto file = std::ifstream{directory / (key + ".spv"), std::ios::binary | std::ios::ate};
+    if (!file) {
+        return {};
+    }
+    auto const size = static_cast<size_t>(file.tellg());
+    if (size == 0 || size % sizeof(uint32_t) != 0) {
+        return {};
+    }
+    auto result = std::vector<uint32_t>(size / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(result.data()), static_cast<std::streamsize>(size));
+    if (!file || result[0] != SPIRV_MAGIC) {
+        return {};
+    }
+    return result;
+}
+
+auto ShaderCache::prepare_write_out(daxa::ShaderCompileInfo &shader_info, std::string const &key) const -> std::filesystem::path {
+    auto const write_out_directory = directory / "pending" / key;
+    auto error = std::error_code{};
+    std::filesystem::remove_all(write_out_directory, error);
+    std::filesystem::create_directories(write_out_directory, error);
+    shader_info.compile_options.write_out_shader_binary = write_out_directory;
+    return write_out_directory;
+}
+
+void ShaderCache::store_written_out(std::filesystem::path const &write_out_directory, std::string const &key) const {
+    // Each stage writes to its own directory, so whatever binary is in there
+    // belongs to `key`.
+    auto error = std::error_code{};
+    for (auto const &entry : std::filesystem::directory_iterator(write_out_directory, error)) {
+        if (entry.is_regular_file(error) && entry.path().extension() == ".spv") {
+            std::filesystem::rename(entry.path(), directory / (key + ".spv"), error);
+            break;
+        }
+    }
+    std::filesystem::remove_all(write_out_directory, error);
+}
+
+auto ShaderCache::add_compute_pipeline(daxa::PipelineManager &pipeline_manager, daxa::ComputePipelineCompileInfo info) -> daxa::Result<std::shared_ptr<daxa::ComputePipeline>> {
+    auto const start = Clock::now();
+    auto const key = key_of(info.shader_info, "compute");
+    auto write_out_directory = std::filesystem::path{};
+    if (key) {
+        if (auto const spirv = load(*key); !spirv.empty()) {
+            auto pipeline = std::make_shared<daxa::ComputePipeline>(device.create_compute_pipeline({
+                .shader_info = {.byte_code = spirv.data(), .byte_code_size = static_cast<uint32_t>(spirv.size())},
+                .push_constant_size = info.push_constant_size,
+                .name = info.name,
+            }));
+            record(1, 0, milliseconds_since(start));
+            return daxa::Result<std::shared_ptr<daxa::ComputePipeline>>(std::move(pipeline));
+        }
+        write_out_directory = prepare_write_out(info.shader_info, *key);
+    }
+    auto result = [&]() {
+        auto lock = std::lock_guard{pipeline_manager_mutex};
+        return pipeline_manager.add_compute_pipeline(info);
+    }();
+    if (key && result.is_ok()) {
+        store_written_out(write_out_directory, *key);
+    }
+    record(0, 1, milliseconds_since(start));
+    return result;
+}
+
+void ShaderCache::remove_compute_pipeline(daxa::PipelineManager &pipeline_manager, std::shared_ptr<daxa::ComputePipeline> const &pipeline) {
+    auto lock = std::lock_guard{pipeline_manager_mutex};
+    pipeline_manager.remove_compute_pipeline(pipeline);
+}
+
+auto ShaderCache::add_raster_pipeline(daxa::PipelineManager &pipeline_manager, daxa::RasterPipelineCompileInfo info) -> daxa::Result<std::shared_ptr<daxa::RasterPipeline>> {
+    auto const start = Clock::now();
+    auto const vertex_key = info.vertex_shader_info.has_value() ? key_of(info.vertex_shader_info.value(), "vertex") : std::nullopt;
+    auto const fragment_key = info.fragment_shader_info.has_value() ? key_of(info.fragment_shader_info.value(), "fragment") : std::nullopt;
+    auto write_out_directories = std::array<std::filesystem::path, 2>{};
+    if (vertex_key && fragment_key) {
+        auto const vertex_spirv = load(*vertex_key);
+        auto const fragment_spirv = load(*fragment_key);
+        if (!vertex_spirv.empty() && !fragment_spirv.empty()) {
+            auto raster_info = daxa::RasterPipelineInfo{
+                .vertex_shader_info = daxa::ShaderInfo{.byte_code = vertex_spirv.data(), .byte_code_size = static_cast<uint32_t>(vertex_spirv.size())},
+                .fragment_shader_info = daxa::ShaderInfo{.byte_code = fragment_spirv.data(), .byte_code_size = static_cast<uint32_t>(fragment_spirv.size())},
+            };
+            for (auto const &attachment : info.color_attachments) {
+                raster_info.color_attachments.push_back(attachment);
+            }
+            raster_info.depth_test = info.depth_test;
+            raster_info.raster = info.raster;
+            raster_info.push_constant_size = info.push_constant_size;
+            raster_info.name = info.name;
+            auto pipeline = std::make_shared<daxa::RasterPipeline>(device.create_raster_pipeline(raster_info));
+            record(2, 0, milliseconds_since(start));
+            return daxa::Result<std::shared_ptr<daxa::RasterPipeline>>(std::move(pipeline));
+        }
+        write_out_directories[0] = prepare_write_out(info.vertex_shader_info.value(), *vertex_key);
+        write_out_directories[1] = prepare_write_out(info.fragment_shader_info.value(), *fragment_key);
+    }
+    auto result = [&]() {
+        auto lock = std::lock_guard{pipeline_manager_mutex};
+        return pipeline_manager.add_raster_pipeline(info);
+    }();
+    if (vertex_key && fragment_key && result.is_ok()) {
+        store_written_out(write_out_directories[0], *vertex_key);
+        store_written_out(write_out_directories[1], *fragment_key);
+    }
+    record(0, 2, milliseconds_since(start));
+    return result;
+}
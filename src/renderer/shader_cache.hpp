@@ -0,0 +1,72 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+#include <daxa/utils/pipeline_manager.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ShaderCacheStats {
+    // Shader stages loaded from the cache and stages compiled from source.
+    uint32_t hit_count{};
+    uint32_t miss_count{};
+    // Total time spent creating pipelines through the cache.
+    double milliseconds{};
+};
+
+// Content-addressed on-disk cache of compiled SPIR-V. Each shader stage is
+// keyed by a hash of its source, every file it includes, its defines and
+// the compile options that change the output. When all stages of a
+// pipeline are cached, the pipeline is created straight from the SPIR-V
+// and glslang never runs. Otherwise it goes through the PipelineManager,
+// which writes the binaries out for next time.
+//
+// Entries are never invalidated, only superseded: any change to a source or
+// include produces a new key.
+//
+// Safe to call from several threads. The PipelineManager isn't, so stages
+// that need compiling are compiled one at a time, while cached ones load in
+// parallel.
+class ShaderCache {
+  public:
+    // `a_default_options` must match the PipelineManager's, stages inherit
+    // them and the keys depend on them.
+    explicit ShaderCache(daxa::Device a_device, std::filesystem::path a_directory, daxa::ShaderCompileOptions a_default_options);
+    ShaderCache(const ShaderCache &) = delete;
+    ShaderCache(ShaderCache &&) = delete;
+    auto operator=(const ShaderCache &) -> ShaderCache & = delete;
+    auto operator=(ShaderCache &&) -> ShaderCache & = delete;
+
+    // Same as the PipelineManager functions. Only compute, vertex and
+    // fragment stages are supported.
+    auto add_compute_pipeline(daxa::PipelineManager &pipeline_manager, daxa::ComputePipelineCompileInfo info) -> daxa::Result<std::shared_ptr<daxa::ComputePipeline>>;
+    auto add_raster_pipeline(daxa::PipelineManager &pipeline_manager, daxa::RasterPipelineCompileInfo info) -> daxa::Result<std::shared_ptr<daxa::RasterPipeline>>;
+    // Stops the PipelineManager from keeping and reloading a pipeline that
+    // was replaced. Ones built from cached SPIR-V were never added to it.
+    void remove_compute_pipeline(daxa::PipelineManager &pipeline_manager, std::shared_ptr<daxa::ComputePipeline> const &pipeline);
+
+    auto stats() const -> ShaderCacheStats;
+
+  private:
+    static inline constexpr uint32_t FORMAT_VERSION = 1;
+
+    daxa::Device device;
+    std::filesystem::path directory;
+    daxa::ShaderCompileOptions default_options;
+    mutable std::mutex stats_mutex{};
+    ShaderCacheStats cache_stats{};
+    std::mutex pipeline_manager_mutex{};
+
+    void record(uint32_t hit_count, uint32_t miss_count, double milliseconds);
+    auto key_of(daxa::ShaderCompileInfo const &shader_info, std::string_view stage) const -> std::optional<std::string>;
+    auto load(std::string const &key) const -> std::vector<uint32_t>;
+    // Points the stage's binary output at a fresh directory for `key`.
+    auto prepare_write_out(daxa::ShaderCompileInfo &shader_info, std::string const &key) const -> std::filesystem::path;
+    void store_written_out(std::filesystem::path const &write_out_directory, std::string const &key) const;
+    auto resolve(std::filesystem::path const &path, std::filesystem::path const &including_directory) const -> std::optional<std::filesystem::path>;
+    void hash_includes(uint64_t &hash, std::string const &source, std::filesystem::path const &source_directory, std::vector<std::filesystem::path> &visited) const;
+};
@@ -0,0 +1,54 @@
+#include <renderer/shader_watcher.hpp>
+
+namespace {
+    void hash_bytes(uint64_t &hash, void const *data, size_t size) {
+        auto const *bytes = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    }
+
+    auto is_shader_source(std::filesystem::path const &path) -> bool {
+        auto const extension = path.extension();
+        return extension == ".glsl" || extension == ".inl";
+    }
+} // namespace
+
+ShaderWatcher::ShaderWatcher(std::vector<std::filesystem::path> a_roots, std::function<void()> a_on_change)
+    : roots{std::move(a_roots)},
+      on_change{std::move(a_on_change)},
+      thread{[this](std::stop_token const &stop_token) { watch(stop_token); }} {
+}
+
+auto ShaderWatcher::snapshot() const -> uint64_t {
+    auto hash = uint64_t{0xcbf29ce484222325};
+    for (auto const &root : roots) {
+        auto error = std::error_code{};
+        for (auto iter = std::filesystem::recursive_directory_iterator(root, error); !error && iter != std::filesystem::recursive_directory_iterator(); iter.increment(error)) {
+            if (!iter->is_regular_file(error) || !is_shader_source(iter->path())) {
+                continue;
+            }
+            auto const path = iter->path().string();
+            auto const write_time = iter->last_write_time(error).time_since_epoch().count();
+            hash_bytes(hash, path.data(), path.size());
+            hash_bytes(hash, &write_time, sizeof(write_time));
+        }
+    }
+    return hash;
+}
+
+void ShaderWatcher::watch(std::stop_token const &stop_token) {
+    auto last_snapshot = snapshot();
+    auto lock = std::unique_lock{mutex};
+    while (true) {
+        stop_cv.wait_for(lock, stop_token, POLL_INTERVAL, [] { return false; });
+        if (stop_token.stop_requested()) {
+            return;
+        }
+        auto const current_snapshot = snapshot();
+        if (current_snapshot != last_snapshot) {
+            last_snapshot = current_snapshot;
+            on_change();
+        }
+    }
+}
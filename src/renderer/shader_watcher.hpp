@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Watches the shader sources (.glsl and .inl) under a set of directories,
+// and calls `on_change` from its own thread when any of them is written,
+// added or removed. Polls the write times, which keeps it portable and,
+// at this interval, well within a frame or two of the save.
+class ShaderWatcher {
+  public:
+    static inline constexpr auto POLL_INTERVAL = std::chrono::milliseconds(100);
+
+    explicit ShaderWatcher(std::vector<std::filesystem::path> a_roots, std::function<void()> a_on_change);
+    ~ShaderWatcher() = default;
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher(ShaderWatcher &&) = delete;
+    auto operator=(const ShaderWatcher &) -> ShaderWatcher & = delete;
+    auto operator=(ShaderWatcher &&) -> ShaderWatcher & = delete;
+
+  private:
+    std::vector<std::filesystem::path> roots;
+    std::function<void()> on_change;
+    std::mutex mutex{};
+    std::condition_variable_any stop_cv{};
+    // Last, so it stops before the rest is destroyed.
+    std::jthread thread;
+
+    // Changes whenever a watched file does.
+    auto snapshot() const -> uint64_t;
+    void watch(std::stop_token const &stop_token);
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GVOX_EDITOR_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GVOX_EDITOR_SIMD_SSE 1
+#endif
+
+// Minimal float vector type for the CPU ray packets: 8 lanes with AVX,
+// 4 lanes with SSE2, and a plain array with 4 lanes everywhere else (which
+// compilers turn into NEON on AArch64). Masks are vectors whose lanes are
+// all-ones or all-zeros, as produced by the comparisons.
+namespace simd {
+#if GVOX_EDITOR_SIMD_AVX
+    inline constexpr size_t WIDTH = 8;
+    struct FloatN {
+        __m256 v;
+    };
+    inline auto broadcast(float x) -> FloatN { return {_mm256_set1_ps(x)}; }
+    inline auto load(float const *p) -> FloatN { return {_mm256_loadu_ps(p)}; }
+    inline void store(float *p, FloatN a) { _mm256_storeu_ps(p, a.v); }
+    inline auto operator+(FloatN a, FloatN b) -> FloatN { return {_mm256_add_ps(a.v, b.v)}; }
+    inline auto operator-(FloatN a, FloatN b) -> FloatN { return {_mm256_sub_ps(a.v, b.v)}; }
+    inline auto operator*(FloatN a, FloatN b) -> FloatN { return {_mm256_mul_ps(a.v, b.v)}; }
+    inline auto operator/(FloatN a, FloatN b) -> FloatN { return {_mm256_div_ps(a.v, b.v)}; }
+    inline auto min(FloatN a, FloatN b) -> FloatN { return {_mm256_min_ps(a.v, b.v)}; }
+    inline auto max(FloatN a, FloatN b) -> FloatN { return {_mm256_max_ps(a.v, b.v)}; }
+    inline auto operator<(FloatN a, FloatN b) -> FloatN { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+    inline auto operator<=(FloatN a, FloatN b) -> FloatN { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+    inline auto operator&(FloatN a, FloatN b) -> FloatN { return {_mm256_and_ps(a.v, b.v)}; }
+    inline auto operator|(FloatN a, FloatN b) -> FloatN { return {_mm256_or_ps(a.v, b.v)}; }
+    inline auto and_not(FloatN mask, FloatN a) -> FloatN { return {_mm256_andnot_ps(mask.v, a.v)}; }
+    inline auto select(FloatN mask, FloatN a, FloatN b) -> FloatN { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+    inline auto lane_mask(FloatN mask) -> uint32_t { return static_cast<uint32_t>(_mm256_movemask_ps(mask.v)); }
+    inline auto abs(FloatN a) -> FloatN { return and_not(broadcast(-0.0f), a); }
+#elif GVOX_EDITOR_SIMD_SSE
+    inline constexpr size_t WIDTH = 4;
+    struct FloatN {
+        __m128 v;
+    };
+    inline auto broadcast(float x) -> FloatN { return {_mm_set1_ps(x)}; }
+    inline auto load(float const *p) -> FloatN { return {_mm_loadu_ps(p)}; }
+    inline void store(float *p, FloatN a) { _mm_storeu_ps(p, a.v); }
+    inline auto operator+(FloatN a, FloatN b) -> FloatN { return {_mm_add_ps(a.v, b.v)}; }
+    inline auto operator-(FloatN a, FloatN b) -> FloatN { return {_mm_sub_ps(a.v, b.v)}; }
+    inline auto operator*(FloatN a, FloatN b) -> FloatN { return {_mm_mul_ps(a.v, b.v)}; }
+    inline auto operator/(FloatN a, FloatN b) -> FloatN { return {_mm_div_ps(a.v, b.v)}; }
+    inline auto min(FloatN a, FloatN b) -> FloatN { return {_mm_min_ps(a.v, b.v)}; }
+    inline auto max(FloatN a, FloatN b) -> FloatN { return {_mm_max_ps(a.v, b.v)}; }
+    inline auto operator<(FloatN a, FloatN b) -> FloatN { return {_mm_cmplt_ps(a.v, b.v)}; }
+    inline auto operator<=(FloatN a, FloatN b) -> FloatN { return {_mm_cmple_ps(a.v, b.v)}; }
+    inline auto operator&(FloatN a, FloatN b) -> FloatN { return {_mm_and_ps(a.v, b.v)}; }
+    inline auto operator|(FloatN a, FloatN b) -> FloatN { return {_mm_or_ps(a.v, b.v)}; }
+    inline auto and_not(FloatN mask, FloatN a) -> FloatN { return {_mm_andnot_ps(mask.v, a.v)}; }
+    inline auto select(FloatN mask, FloatN a, FloatN b) -> FloatN { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+    inline auto lane_mask(FloatN mask) -> uint32_t { return static_cast<uint32_t>(_mm_movemask_ps(mask.v)); }
+    inline auto abs(FloatN a) -> FloatN { return and_not(broadcast(-0.0f), a); }
+#else
+    inline constexpr size_t WIDTH = 4;
+    struct FloatN {
+        std::array<float, WIDTH> v;
+    };
+    namespace detail {
+        template <typename F>
+        inline auto map(FloatN a, FloatN b, F &&f) -> FloatN {
+            auto result = FloatN{};
+            for (size_t i = 0; i < WIDTH; ++i) {
+                result.v[i] = f(a.v[i], b.v[i]);
+            }
+            return result;
+        }
+        inline auto from_bool(bool b) -> float {
+            auto const bits = b ? ~uint32_t{0} : uint32_t{0};
+            auto result = 0.0f;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result;
+        }
+        inline auto bits(float f) -> uint32_t {
+            auto result = uint32_t{};
+            std::memcpy(&result, &f, sizeof(result));
+            return result;
+        }
+        inline auto from_bits(uint32_t u) -> float {
+            auto result = 0.0f;
+            std::memcpy(&result, &u, sizeof(result));
+            return result;
+        }
+    } // namespace detail
+    inline auto broadcast(float x) -> FloatN {
+        auto result = FloatN{};
+        result.v.fill(x);
+        return result;
+    }
+    inline auto load(float const *p) -> FloatN {
+        auto result = FloatN{};
+        std::memcpy(result.v.data(), p, sizeof(result.v));
+        return result;
+    }
+    inline void store(float *p, FloatN a) { std::memcpy(p, a.v.data(), sizeof(a.v)); }
+    inline auto operator+(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return x + y; }); }
+    inline auto operator-(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return x - y; }); }
+    inline auto operator*(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return x * y; }); }
+    inline auto operator/(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return x / y; }); }
+    inline auto min(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+    inline auto max(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return x < y ? y : x; }); }
+    inline auto operator<(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return detail::from_bool(x < y); }); }
+    inline auto operator<=(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return detail::from_bool(x <= y); }); }
+    inline auto operator&(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return detail::from_bits(detail::bits(x) & detail::bits(y)); }); }
+    inline auto operator|(FloatN a, FloatN b) -> FloatN { return detail::map(a, b, [](float x, float y) { return detail::from_bits(detail::bits(x) | detail::bits(y)); }); }
+    inline auto and_not(FloatN mask, FloatN a) -> FloatN { return detail::map(mask, a, [](float x, float y) { return detail::from_bits(~detail::bits(x) & detail::bits(y)); }); }
+    inline auto select(FloatN mask, FloatN a, FloatN b) -> FloatN { return (mask & a) | and_not(mask, b); }
+    inline auto lane_mask(FloatN mask) -> uint32_t {
+        auto result = uint32_t{};
+        for (size_t i = 0; i < WIDTH; ++i) {
+            result |= (detail::bits(mask.v[i]) >> 31) << i;
+        }
+        return result;
+    }
+    inline auto abs(FloatN a) -> FloatN { return and_not(broadcast(-0.0f), a); }
+#endif
+
+    struct Vec3N {
+        FloatN x, y, z;
+    };
+} // namespace simd
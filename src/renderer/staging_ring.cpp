@@ -0,0 +1,86 @@
+#include <renderer/staging_ring.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <string>
+
+namespace {
+    auto align_up(size_t value, size_t alignment) -> size_t {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+StagingRing::StagingRing(daxa::Device a_device, size_t initial_capacity, char const *a_name)
+    : device{std::move(a_device)},
+      name{a_name} {
+    create_buffer(initial_capacity);
+}
+
+StagingRing::~StagingRing() {
+    device.destroy_buffer(buffer);
+    for (auto const &retired : retired_buffers) {
+        device.destroy_buffer(retired.buffer);
+    }
+}
+
+void StagingRing::create_buffer(size_t new_capacity) {
+    buffer = device.create_buffer({
+        .size = static_cast<uint32_t>(new_capacity),
+        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+        .name = std::string(name),
+    });
+    host_address = device.get_host_address_as<std::byte>(buffer).value();
+    device_address = device.get_device_address(buffer).value();
+    ring.reset(new_capacity);
+    ++buffer_allocation_count;
+}
+
+auto StagingRing::allocate(size_t size, size_t alignment) -> StagingAllocation {
+    auto offset = ring.allocate(size, alignment);
+    if (!offset) {
+        reclaim(last_completed_timeline_value);
+        offset = ring.allocate(size, alignment);
+        if (!offset) {
+            // The frames still in flight keep reading the old buffer, so it
+            // is only retired, and the new one starts out empty.
+            retired_buffers.push_back({.buffer = buffer});
+            create_buffer(std::max(ring.capacity() * 2, align_up(size * 2, alignment)));
+            offset = ring.allocate(size, alignment);
+        }
+    }
+    return {
+        .buffer = buffer,
+        .offset = *offset,
+        .host_address = host_address + *offset,
+        .device_address = device_address + *offset,
+    };
+}
+
+void StagingRing::end_frame(uint64_t timeline_value) {
+    for (auto &retired : retired_buffers) {
+        if (retired.timeline_value == 0) {
+            retired.timeline_value = timeline_value;
+        }
+    }
+    ring.end_frame(timeline_value);
+}
+
+void StagingRing::reclaim(uint64_t completed_timeline_value) {
+    last_completed_timeline_value = completed_timeline_value;
+    ring.reclaim(completed_timeline_value);
+    std::erase_if(retired_buffers, [&](RetiredBuffer const &retired) {
+        if (retired.timeline_value == 0 || retired.timeline_value > completed_timeline_value) {
+            return false;
+        }
+        device.destroy_buffer(retired.buffer);
+        return true;
+    });
+}
+
+auto StagingRing::stats() const -> StagingRingStats {
+    return {
+        .capacity = ring.capacity(),
+        .used = ring.used(),
+        .buffer_allocation_count = buffer_allocation_count,
+    };
+}
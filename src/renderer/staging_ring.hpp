@@ -0,0 +1,67 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+
+#include <core/ring_allocator.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct StagingAllocation {
+    daxa::BufferId buffer{};
+    size_t offset{};
+    std::byte *host_address{};
+    daxa::DeviceAddress device_address{};
+};
+
+struct StagingRingStats {
+    size_t capacity{};
+    size_t used{};
+    // Buffers created over the ring's lifetime. Stays flat once the ring has
+    // grown to fit the steady-state upload volume.
+    uint64_t buffer_allocation_count{};
+};
+
+// One persistently mapped, host-visible buffer that all per-frame uploads are
+// carved out of. The space is managed by a RingAllocator, so it is only
+// reused once the timeline value of the frame that allocated it has been
+// reached on the GPU. When a frame does not fit, the ring grows geometrically
+// into a new buffer and the old one is destroyed once its frames are done.
+class StagingRing {
+  public:
+    explicit StagingRing(daxa::Device a_device, size_t initial_capacity, char const *a_name);
+    ~StagingRing();
+    StagingRing(const StagingRing &) = delete;
+    StagingRing(StagingRing &&) = delete;
+    auto operator=(const StagingRing &) -> StagingRing & = delete;
+    auto operator=(StagingRing &&) -> StagingRing & = delete;
+
+    auto allocate(size_t size, size_t alignment = 16) -> StagingAllocation;
+    // Closes the current frame. `timeline_value` is what the submission that
+    // consumes this frame's allocations signals once it completes.
+    void end_frame(uint64_t timeline_value);
+    // Frees the space of every frame whose timeline value has been reached.
+    void reclaim(uint64_t completed_timeline_value);
+
+    auto stats() const -> StagingRingStats;
+
+  private:
+    struct RetiredBuffer {
+        daxa::BufferId buffer{};
+        // Zero until the frame it was retired in has ended.
+        uint64_t timeline_value{};
+    };
+
+    daxa::Device device;
+    char const *name{};
+    daxa::BufferId buffer{};
+    std::byte *host_address{};
+    daxa::DeviceAddress device_address{};
+    RingAllocator ring{};
+    std::vector<RetiredBuffer> retired_buffers{};
+    uint64_t buffer_allocation_count{};
+    uint64_t last_completed_timeline_value{};
+
+    void create_buffer(size_t new_capacity);
+};
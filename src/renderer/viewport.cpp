@@ -1,33 +1,96 @@
 #include <renderer/viewport.hpp>
 
-Viewport::Viewport(daxa::PipelineManager &pipeline_manager)
-    : generate_task_state(pipeline_manager),
-      render_task_state(pipeline_manager) {}
-
-void Viewport::render(daxa::TaskGraph &task_graph, daxa::TaskImageView target_image) {
-    auto voxels_buffer = task_graph.create_transient_buffer({
-        .size = static_cast<uint32_t>(sizeof(uint32_t) * 8 * 8 * 8),
-        .name = "voxels",
-    });
+#include <algorithm>
+#include <cstring>
+
+Viewport::Viewport(daxa::Device device, daxa::PipelineManager &pipeline_manager, ShaderCache &shader_cache, ThreadPool &thread_pool, VoxelScene &scene)
+    : generate_task_state(pipeline_manager, shader_cache, thread_pool),
+      render_task_state(pipeline_manager, shader_cache, thread_pool),
+      gpu_scene(std::move(device), scene) {}
+
+auto Viewport::pipelines_compiled() -> bool {
+    return generate_task_state.is_compiled() && render_task_state.is_compiled();
+}
+
+void Viewport::reload_pipelines() {
+    generate_task_state.reload();
+    render_task_state.reload();
+}
+
+void Viewport::cycle_shading_mode() {
+    auto const next = (static_cast<uint32_t>(render_permutation.shading_mode) + 1) % static_cast<uint32_t>(viewport::ShadingMode::COUNT);
+    render_permutation.shading_mode = static_cast<viewport::ShadingMode>(next);
+}
+
+void Viewport::cycle_debug_view() {
+    auto const next = (static_cast<uint32_t>(render_permutation.debug_view) + 1) % static_cast<uint32_t>(viewport::DebugView::COUNT);
+    render_permutation.debug_view = static_cast<viewport::DebugView>(next);
+}
+
+void Viewport::update(uint64_t frame_timeline_value, uint64_t completed_timeline_value) {
+    auto const generate_applied = generate_task_state.apply_compiled_pipelines();
+    auto const render_applied = render_task_state.apply_compiled_pipelines();
+    gpu_scene.update(frame_timeline_value, completed_timeline_value);
+    // The UI alone waking a frame, or the idle wake, only blits the last
+    // render again.
+    auto const push = viewport::RenderImpl::push_constant(render_task_self({}));
+    auto const permutation_key = render_permutation.key();
+    needs_render = target_invalidated || generate_applied || render_applied ||
+                   gpu_scene.last_upload_stats.byte_count != 0 ||
+                   std::memcmp(&push, &rendered_push, sizeof(push)) != 0 ||
+                   permutation_key != rendered_permutation_key;
+    target_invalidated = false;
+    rendered_push = push;
+    rendered_permutation_key = permutation_key;
+}
+
+void Viewport::set_output_size(daxa_u32vec2 window_size, daxa_u32vec2 target_image_size) {
+    render_size = {
+        std::clamp(window_size.x, 1u, target_image_size.x),
+        std::clamp(window_size.y, 1u, target_image_size.y),
+    };
+    aspect_ratio = static_cast<daxa_f32>(std::max(window_size.x, 1u)) / static_cast<daxa_f32>(std::max(window_size.y, 1u));
+}
+
+void Viewport::invalidate() {
+    target_invalidated = true;
+}
+
+void Viewport::render(daxa::TaskGraph &task_graph, daxa::TaskImageView target_image, FrameProfiler *profiler) {
+    gpu_scene.record_upload(task_graph, profiler);
     task_graph.add_task(viewport::GenerateTask{
         {
             .uses = {
-                .voxels = voxels_buffer,
+                .brick_pool = gpu_scene.task_brick_pool,
             },
         },
         &generate_task_state,
         {},
+        profiler,
     });
     task_graph.add_task(viewport::RenderTask{
         {
             .uses = {
-                .voxels = voxels_buffer,
+                .brick_table = gpu_scene.task_brick_table,
+                .brick_pool = gpu_scene.task_brick_pool,
                 .target_image = target_image,
             },
         },
         &render_task_state,
-        {
-            .target_image = target_image,
-        },
+        render_task_self(target_image),
+        profiler,
     });
 }
+
+auto Viewport::render_task_self(daxa::TaskImageView target_image) const -> viewport::RenderImpl::Self {
+    return {
+        .target_image = target_image,
+        .camera = &camera,
+        .render_size = &render_size,
+        .aspect_ratio = &aspect_ratio,
+        .permutation = &render_permutation,
+        .brick_grid_origin = &gpu_scene.brick_grid_origin,
+        .brick_grid_size = &gpu_scene.brick_grid_size,
+        .needs_render = &needs_render,
+    };
+}
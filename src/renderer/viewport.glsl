@@ -10,10 +10,153 @@ void main() {
 
 #if VIEWPORT_RENDER
 
+DAXA_DECL_PUSH_CONSTANT(ViewportRenderPush, push)
+
+// Same traversal and shading as CpuRenderer (renderer/cpu_renderer.cpp):
+// a DDA over the brick grid, then a DDA over the voxels of dense bricks.
+#define T_EPSILON 1e-4
+const vec3 LIGHT_DIRECTION = vec3(0.40, 0.55, 0.73);
+const vec3 BACKGROUND_COLOR = vec3(0.2, 0.1, 0.4);
+
+#if !defined(VIEWPORT_SHADING_MODE)
+#define VIEWPORT_SHADING_MODE VIEWPORT_SHADING_MODE_LIT
+#endif
+#if !defined(VIEWPORT_DEBUG_VIEW)
+#define VIEWPORT_DEBUG_VIEW VIEWPORT_DEBUG_VIEW_NONE
+#endif
+
+#if VIEWPORT_DEBUG_VIEW == VIEWPORT_DEBUG_VIEW_STEPS
+uint debug_step_count = 0;
+#endif
+
+struct Hit {
+    uint voxel;
+    int normal_axis;
+    float normal_sign;
+};
+
+int argmin_axis(vec3 t) {
+    if (t.x <= t.y && t.x <= t.z) {
+        return 0;
+    }
+    return t.y <= t.z ? 1 : 2;
+}
+
+uint brick_table_entry(ivec3 cell) {
+    uvec3 p = uvec3(cell - push.brick_grid_origin);
+    return deref(brick_table[p.x + (p.y + p.z * push.brick_grid_size.y) * push.brick_grid_size.x]);
+}
+
+bool trace_brick(uint slot, ivec3 cell, vec3 ro, vec3 rd, vec3 inv_rd, float t_start, int entry_axis, inout Hit hit) {
+    ivec3 origin = cell * VIEWPORT_BRICK_SIZE;
+    ivec3 step_dir = ivec3(greaterThanEqual(rd, vec3(0))) * 2 - 1;
+    ivec3 voxel = clamp(ivec3(floor(ro + rd * (t_start + T_EPSILON))) - origin, ivec3(0), ivec3(VIEWPORT_BRICK_SIZE - 1));
+    vec3 t_max = (vec3(origin + voxel + max(step_dir, ivec3(0))) - ro) * inv_rd;
+    vec3 t_delta = abs(inv_rd);
+    int axis = entry_axis;
+    for (int i = 0; i < VIEWPORT_BRICK_SIZE * 3; ++i) {
+#if VIEWPORT_DEBUG_VIEW == VIEWPORT_DEBUG_VIEW_STEPS
+        ++debug_step_count;
+#endif
+        uint value = deref(brick_pool[slot * VIEWPORT_BRICK_VOXEL_COUNT + voxel.x + (voxel.y + voxel.z * VIEWPORT_BRICK_SIZE) * VIEWPORT_BRICK_SIZE]);
+        if (value != 0) {
+            hit = Hit(value, axis, axis >= 0 ? -float(step_dir[axis]) : 0.0);
+            return true;
+        }
+        axis = argmin_axis(t_max);
+        voxel[axis] += step_dir[axis];
+        if (voxel[axis] < 0 || voxel[axis] >= VIEWPORT_BRICK_SIZE) {
+            return false;
+        }
+        t_max[axis] += t_delta[axis];
+    }
+    return false;
+}
+
+Hit trace_ray(vec3 ro, vec3 rd) {
+    Hit hit = Hit(0, -1, 0.0);
+    vec3 inv_rd = 1.0 / mix(rd, vec3(1e-20), lessThan(abs(rd), vec3(1e-20)));
+    ivec3 grid_size = ivec3(push.brick_grid_size);
+    vec3 lo = vec3(push.brick_grid_origin * VIEWPORT_BRICK_SIZE);
+    vec3 hi = vec3((push.brick_grid_origin + grid_size) * VIEWPORT_BRICK_SIZE);
+    vec3 t0 = (lo - ro) * inv_rd;
+    vec3 t1 = (hi - ro) * inv_rd;
+    vec3 t_near = min(t0, t1);
+    vec3 t_far = max(t0, t1);
+    float t_enter = max(max(t_near.x, t_near.y), max(t_near.z, 0.0));
+    float t_exit = min(min(t_far.x, t_far.y), t_far.z);
+    if (t_enter >= t_exit) {
+        return hit;
+    }
+    int axis = t_enter == 0.0 ? -1 : (t_enter == t_near.x ? 0 : (t_enter == t_near.y ? 1 : 2));
+
+    ivec3 step_dir = ivec3(greaterThanEqual(rd, vec3(0))) * 2 - 1;
+    ivec3 cell = clamp(ivec3(floor((ro + rd * (t_enter + T_EPSILON)) / VIEWPORT_BRICK_SIZE)), push.brick_grid_origin, push.brick_grid_origin + grid_size - 1);
+    vec3 t_max = (vec3(cell + max(step_dir, ivec3(0))) * VIEWPORT_BRICK_SIZE - ro) * inv_rd;
+    vec3 t_delta = abs(inv_rd) * VIEWPORT_BRICK_SIZE;
+    float t = t_enter;
+    for (int i = 0; i < grid_size.x + grid_size.y + grid_size.z; ++i) {
+#if VIEWPORT_DEBUG_VIEW == VIEWPORT_DEBUG_VIEW_STEPS
+        ++debug_step_count;
+#endif
+        uint entry = brick_table_entry(cell);
+        if ((entry & VIEWPORT_BRICK_TABLE_UNIFORM_BIT) != 0) {
+            hit = Hit(entry & ~VIEWPORT_BRICK_TABLE_UNIFORM_BIT, axis, axis >= 0 ? -float(step_dir[axis]) : 0.0);
+            return hit;
+        }
+        if (entry != 0 && trace_brick(entry - 1, cell, ro, rd, inv_rd, t, axis, hit)) {
+            return hit;
+        }
+        axis = argmin_axis(t_max);
+        t = t_max[axis];
+        if (t >= t_exit) {
+            break;
+        }
+        cell[axis] += step_dir[axis];
+        t_max[axis] += t_delta[axis];
+    }
+    return hit;
+}
+
+// Each permutation only compiles the shading it uses.
+vec3 shade(Hit hit) {
+#if VIEWPORT_DEBUG_VIEW == VIEWPORT_DEBUG_VIEW_STEPS
+    // Blue for rays that stop right away, red for ones that cross the grid.
+    uvec3 grid_size = push.brick_grid_size;
+    float heat = clamp(float(debug_step_count) / float(max(max(grid_size.x, grid_size.y), max(grid_size.z, 1u))), 0.0, 1.0);
+    return mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), heat);
+#else
+    if (hit.voxel == 0) {
+        return BACKGROUND_COLOR;
+    }
+#if VIEWPORT_DEBUG_VIEW == VIEWPORT_DEBUG_VIEW_NORMALS
+    vec3 normal = vec3(0.0);
+    if (hit.normal_axis >= 0) {
+        normal[hit.normal_axis] = hit.normal_sign;
+    }
+    return normal * 0.5 + 0.5;
+#else
+    vec3 albedo = vec3(hit.voxel & 0xff, (hit.voxel >> 8) & 0xff, (hit.voxel >> 16) & 0xff) / 255.0;
+#if VIEWPORT_SHADING_MODE == VIEWPORT_SHADING_MODE_ALBEDO
+    return albedo;
+#else
+    float diffuse = hit.normal_axis >= 0 ? max(hit.normal_sign * LIGHT_DIRECTION[hit.normal_axis], 0.0) : 0.0;
+    return albedo * (0.35 + 0.65 * diffuse);
+#endif
+#endif
+#endif
+}
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 void main() {
-    vec2 uv = vec2(gl_GlobalInvocationID.xy) / vec2(imageSize(daxa_image2D(target_image)));
-    vec3 col = vec3(uv, 0);
+    if (any(greaterThanEqual(gl_GlobalInvocationID.xy, push.render_size))) {
+        return;
+    }
+    vec2 pixel = (vec2(gl_GlobalInvocationID.xy) + 0.5) / vec2(push.render_size);
+    float u = (pixel.x * 2.0 - 1.0) * push.tan_half_fov_y * push.aspect_ratio;
+    float v = (1.0 - pixel.y * 2.0) * push.tan_half_fov_y;
+    vec3 rd = normalize(push.camera_forward + push.camera_right * u + push.camera_up * v);
+    vec3 col = shade(trace_ray(push.camera_position, rd));
     imageStore(daxa_image2D(target_image), ivec2(gl_GlobalInvocationID.xy), vec4(col, 1));
 }
 
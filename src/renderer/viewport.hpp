@@ -5,12 +5,24 @@
 #include <daxa/utils/pipeline_manager.hpp>
 
 #include <renderer/viewport.inl>
+#include <renderer/gpu_scene.hpp>
 
 struct Viewport {
     viewport::GenerateTaskState generate_task_state;
     viewport::RenderTaskState render_task_state;
+    GpuScene gpu_scene;
+    Camera camera{};
+    // Part of the render target that gets rendered, see `set_output_size`.
+    daxa_u32vec2 render_size{1, 1};
+    daxa_f32 aspect_ratio = 1.0f;
+    // Each combination compiles the first time it's selected.
+    viewport::RenderPermutation render_permutation{};
+    // Whether this frame ray marches the scene. `update` clears it when the
+    // camera, the scene, the permutation and the pipelines are all as they
+    // were for the last render, which the target image then still holds.
+    bool needs_render = true;
 
-    explicit Viewport(daxa::PipelineManager &pipeline_manager);
+    explicit Viewport(daxa::Device device, daxa::PipelineManager &pipeline_manager, ShaderCache &shader_cache, ThreadPool &thread_pool, VoxelScene &scene);
     ~Viewport() = default;
 
     Viewport(const Viewport &) = delete;
@@ -18,5 +30,31 @@ struct Viewport {
     auto operator=(const Viewport &) -> Viewport & = delete;
     auto operator=(Viewport &&) -> Viewport & = delete;
 
-    void render(daxa::TaskGraph &task_graph, daxa::TaskImageView target_image);
+    // The pipelines compile in the background, the viewport stays empty
+    // until they're done.
+    auto pipelines_compiled() -> bool;
+    // Recompiles the pipelines in the background. `update` swaps them in
+    // once they're done, a pipeline that fails to compile keeps its old one.
+    void reload_pipelines();
+    void cycle_shading_mode();
+    void cycle_debug_view();
+    // Call once per frame, before the task graph recorded by `render` runs,
+    // with the timeline values described in `GpuScene::update`.
+    void update(uint64_t frame_timeline_value, uint64_t completed_timeline_value);
+    // Renders `window_size` pixels, or as much of it as fits in the target
+    // image while that is still being reallocated for a new size.
+    void set_output_size(daxa_u32vec2 window_size, daxa_u32vec2 target_image_size);
+    // The target image lost the last render, like when it was reallocated.
+    void invalidate();
+    // `target_image` has to keep its contents between frames, see
+    // `needs_render`.
+    void render(daxa::TaskGraph &task_graph, daxa::TaskImageView target_image, FrameProfiler *profiler);
+
+  private:
+    bool target_invalidated = true;
+    // What the target image was last rendered with.
+    ViewportRenderPush rendered_push{};
+    uint64_t rendered_permutation_key{};
+
+    auto render_task_self(daxa::TaskImageView target_image) const -> viewport::RenderImpl::Self;
 };
@@ -2,15 +2,55 @@
 
 #include <core/core.inl>
 
+// The GPU copy of the scene covers a grid of bricks sized to the scene's
+// bounds, placed by the brick_grid_origin and brick_grid_size push constants.
+// Each brick table entry is 0 for an empty brick, a color with
+// BRICK_TABLE_UNIFORM_BIT set for a uniform brick, or the index of the
+// brick's 8x8x8 voxels in the brick pool.
+#define VIEWPORT_BRICK_SIZE 8
+#define VIEWPORT_BRICK_VOXEL_COUNT (VIEWPORT_BRICK_SIZE * VIEWPORT_BRICK_SIZE * VIEWPORT_BRICK_SIZE)
+#define VIEWPORT_BRICK_TABLE_UNIFORM_BIT 0x80000000
+
+// Render permutations, see viewport::RenderPermutation.
+#define VIEWPORT_SHADING_MODE_LIT 0
+#define VIEWPORT_SHADING_MODE_ALBEDO 1
+#define VIEWPORT_DEBUG_VIEW_NONE 0
+#define VIEWPORT_DEBUG_VIEW_NORMALS 1
+#define VIEWPORT_DEBUG_VIEW_STEPS 2
+
 #if VIEWPORT_GENERATE || defined(__cplusplus)
 DAXA_DECL_TASK_USES_BEGIN(ViewportGenerate, DAXA_UNIFORM_BUFFER_SLOT0)
-DAXA_TASK_USE_BUFFER(voxels, daxa_RWBufferPtr(daxa_u32), COMPUTE_SHADER_READ_WRITE)
+DAXA_TASK_USE_BUFFER(brick_pool, daxa_RWBufferPtr(daxa_u32), COMPUTE_SHADER_READ_WRITE)
 DAXA_DECL_TASK_USES_END()
 #endif
 
+// Camera basis as built by Camera::basis(). Each vec3 is padded out to 16
+// bytes so the layout is the same under any block layout rules.
+struct ViewportRenderPush {
+    daxa_f32vec3 camera_position;
+    daxa_f32 tan_half_fov_y;
+    daxa_f32vec3 camera_forward;
+    daxa_f32 _pad0;
+    daxa_f32vec3 camera_right;
+    daxa_f32 _pad1;
+    daxa_f32vec3 camera_up;
+    daxa_f32 _pad2;
+    // The target image is allocated in size classes, only this corner of it
+    // is rendered. The aspect ratio is that of the window it ends up in.
+    daxa_u32vec2 render_size;
+    daxa_f32 aspect_ratio;
+    daxa_f32 _pad3;
+    // In bricks. The table is laid out x fastest, then y, then z.
+    daxa_i32vec3 brick_grid_origin;
+    daxa_u32 _pad4;
+    daxa_u32vec3 brick_grid_size;
+    daxa_u32 _pad5;
+};
+
 #if VIEWPORT_RENDER || defined(__cplusplus)
 DAXA_DECL_TASK_USES_BEGIN(ViewportRender, DAXA_UNIFORM_BUFFER_SLOT0)
-DAXA_TASK_USE_BUFFER(voxels, daxa_BufferPtr(daxa_u32), COMPUTE_SHADER_READ)
+DAXA_TASK_USE_BUFFER(brick_table, daxa_BufferPtr(daxa_u32), COMPUTE_SHADER_READ)
+DAXA_TASK_USE_BUFFER(brick_pool, daxa_BufferPtr(daxa_u32), COMPUTE_SHADER_READ)
 DAXA_TASK_USE_IMAGE(target_image, REGULAR_2D, COMPUTE_SHADER_STORAGE_WRITE_ONLY)
 DAXA_DECL_TASK_USES_END()
 #endif
@@ -18,6 +58,7 @@ DAXA_DECL_TASK_USES_END()
 #if defined(__cplusplus)
 
 #include <core/task_template.hpp>
+#include <core/camera.hpp>
 
 namespace viewport {
     struct TaskCommon {
@@ -40,21 +81,78 @@ namespace viewport {
         }
     };
 
+    enum struct ShadingMode : uint32_t {
+        LIT = VIEWPORT_SHADING_MODE_LIT,
+        ALBEDO = VIEWPORT_SHADING_MODE_ALBEDO,
+        COUNT,
+    };
+
+    enum struct DebugView : uint32_t {
+        NONE = VIEWPORT_DEBUG_VIEW_NONE,
+        NORMALS = VIEWPORT_DEBUG_VIEW_NORMALS,
+        // Heat map of the traversal steps each ray took.
+        STEPS = VIEWPORT_DEBUG_VIEW_STEPS,
+        COUNT,
+    };
+
+    struct RenderPermutation {
+        ShadingMode shading_mode = ShadingMode::LIT;
+        DebugView debug_view = DebugView::NONE;
+
+        auto key() const -> uint64_t {
+            return static_cast<uint64_t>(shading_mode) | (static_cast<uint64_t>(debug_view) << 8);
+        }
+        auto defines() const -> std::vector<daxa::ShaderDefine> {
+            return {
+                {"VIEWPORT_SHADING_MODE", std::to_string(static_cast<uint32_t>(shading_mode))},
+                {"VIEWPORT_DEBUG_VIEW", std::to_string(static_cast<uint32_t>(debug_view))},
+            };
+        }
+    };
+
     struct RenderImpl : TaskCommon {
         static inline const std::string name = "viewport_render";
         using Uses = ViewportRender;
-        using PushConstant = void;
+        using PushConstant = ViewportRenderPush;
+        using Permutation = RenderPermutation;
         struct Self {
             daxa::TaskImageView target_image;
+            Camera const *camera;
+            daxa_u32vec2 const *render_size;
+            daxa_f32 const *aspect_ratio;
+            RenderPermutation const *permutation;
+            daxa_i32vec3 const *brick_grid_origin;
+            daxa_u32vec3 const *brick_grid_size;
+            // Unset, the target image keeps the previous frame's render.
+            bool const *needs_render;
         };
         static auto get_defines() -> std::vector<daxa::ShaderDefine> {
             auto result = TaskCommon::get_defines();
             result.push_back({"VIEWPORT_RENDER", "1"});
             return result;
         }
+        static auto push_constant(Self const &self) -> ViewportRenderPush {
+            auto const basis = self.camera->basis();
+            auto const to_vec3 = [](std::array<float, 3> const &v) { return daxa_f32vec3{v[0], v[1], v[2]}; };
+            return {
+                .camera_position = to_vec3(self.camera->position),
+                .tan_half_fov_y = basis.tan_half_fov_y,
+                .camera_forward = to_vec3(basis.forward),
+                .camera_right = to_vec3(basis.right),
+                .camera_up = to_vec3(basis.up),
+                .render_size = *self.render_size,
+                .aspect_ratio = *self.aspect_ratio,
+                .brick_grid_origin = *self.brick_grid_origin,
+                .brick_grid_size = *self.brick_grid_size,
+            };
+        }
         static void dispatch(daxa::TaskInterface const &ti, daxa::CommandRecorder &recorder, Self &self) {
-            auto image_size = ti.get_device().info_image(ti.uses[self.target_image].image()).value().size;
-            recorder.dispatch((image_size.x + 7) / 8, (image_size.y + 7) / 8, 1);
+            if (!*self.needs_render) {
+                return;
+            }
+            auto const render_size = *self.render_size;
+            recorder.push_constant(push_constant(self));
+            recorder.dispatch((render_size.x + 7) / 8, (render_size.y + 7) / 8, 1);
         }
     };
 
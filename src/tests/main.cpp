@@ -0,0 +1,208 @@
+// gvox-editor-tests: headless checks of the core containers. Builds without
+// GLFW or Daxa, like gvox-editor-bench, and exits non-zero if a check fails.
+//
+// The UI renderer must not touch the heap in steady-state frames. These
+// checks drive its UiDrawList, the compiled geometry, draw calls and batches
+// RenderInterface_Daxa keeps, through repeated identical frames with
+// allocation counting compiled in. Per-frame uploads are modelled with a
+// RingAllocator, the space manager inside the renderer's StagingRing.
+//
+//   gvox-editor-tests
+
+#include <core/allocation_counter.hpp>
+#include <core/range_allocator.hpp>
+#include <core/ring_allocator.hpp>
+#include <ui/rml/draw_list.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+    auto failure_count = 0;
+
+    void check(bool condition, char const *what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            ++failure_count;
+        }
+    }
+
+    // Drives a UiDrawList the way RenderInterface_Daxa does each frame,
+    // with the GPU side reduced to staging space.
+    struct UiFrameModel {
+        static inline constexpr uint64_t FRAMES_IN_FLIGHT = 2;
+        static inline constexpr size_t VERTEX_BYTES = 20;
+        static inline constexpr size_t DRAW_DATA_BYTES = 64;
+        static inline constexpr size_t DRAW_COMMAND_BYTES = 20;
+
+        struct DrawCall {
+            bool streamed{};
+            uint32_t index_offset{};
+            uint32_t index_count{};
+            float translation_x{};
+        };
+        struct BatchKey {
+            bool streamed{};
+            int32_t clip{};
+
+            auto operator==(BatchKey const &) const -> bool = default;
+        };
+
+        UiDrawList<DrawCall, BatchKey> draw_list{};
+        RingAllocator staging{size_t{1} << 20};
+        uint64_t timeline_value{};
+        uint64_t failed_staging_allocations{};
+        uint64_t steady_frame_allocation_count{};
+        size_t last_batch_count{};
+
+        UiFrameModel() {
+            draw_list.vertex_ranges = RangeAllocator{16384};
+            draw_list.index_ranges = RangeAllocator{32768};
+        }
+
+        void stage(size_t size) {
+            if (!staging.allocate(size, 16)) {
+                ++failed_staging_allocations;
+            }
+        }
+
+        auto compile(uint32_t vertex_count, uint32_t index_count) -> size_t {
+            auto const vertex_offset = draw_list.vertex_ranges.allocate(vertex_count);
+            auto const index_offset = draw_list.index_ranges.allocate(index_count);
+            check(vertex_offset.has_value() && index_offset.has_value(), "arenas fit the compiled geometry");
+            stage(vertex_count * VERTEX_BYTES + index_count * sizeof(int));
+            return draw_list.add_compiled({
+                .vertex_offset = vertex_offset.value_or(0),
+                .vertex_count = vertex_count,
+                .index_offset = index_offset.value_or(0),
+                .index_count = index_count,
+            });
+        }
+
+        void release(size_t handle) {
+            draw_list.release_compiled(handle, timeline_value);
+        }
+
+        // Draws every handle, plus `streamed_count` quads of uncompiled
+        // geometry, which go through the staging ring each frame.
+        void frame(std::vector<size_t> const &handles, size_t streamed_count) {
+            // The GPU runs up to FRAMES_IN_FLIGHT frames behind.
+            auto const completed = timeline_value > FRAMES_IN_FLIGHT ? timeline_value - FRAMES_IN_FLIGHT : 0;
+            staging.reclaim(completed);
+            draw_list.reclaim(completed);
+            {
+                auto const scope = AllocationScope{draw_list.frame_allocation_count};
+                for (size_t i = 0; i < handles.size(); ++i) {
+                    auto const &draw = draw_list.compiled(handles[i]);
+                    draw_list.push({.index_offset = draw.index_offset, .index_count = draw.index_count, .translation_x = static_cast<float>(i)});
+                }
+                for (size_t i = 0; i < streamed_count; ++i) {
+                    stage(4 * VERTEX_BYTES);
+                    stage(6 * sizeof(int));
+                    draw_list.push({.streamed = true, .index_count = 6});
+                }
+            }
+            auto const steady = draw_list.is_steady(false);
+            {
+                auto const scope = AllocationScope{draw_list.frame_allocation_count};
+                auto const call_count = draw_list.calls().size();
+                stage(call_count * DRAW_DATA_BYTES);
+                stage(call_count * DRAW_COMMAND_BYTES);
+                // A clip change every 64 calls, like nested scroll regions.
+                auto call_index = 0;
+                auto const batches = draw_list.build_batches([&call_index](DrawCall const &call) {
+                    return BatchKey{.streamed = call.streamed, .clip = call_index++ / 64};
+                });
+                last_batch_count = batches.size();
+            }
+            auto const allocation_count = draw_list.end_frame();
+            if (steady) {
+                steady_frame_allocation_count += allocation_count;
+            }
+            staging.end_frame(++timeline_value);
+        }
+    };
+
+    void test_allocation_counting() {
+        auto count = uint64_t{};
+        {
+            auto const scope = AllocationScope{count};
+            auto value = std::make_unique<int>(1);
+            check(*value == 1, "allocation");
+        }
+        check(ALLOCATION_COUNTING_ENABLED && count == 1, "heap allocations are counted");
+    }
+
+    void test_steady_ui_frames_do_not_allocate() {
+        auto model = std::make_unique<UiFrameModel>();
+        auto handles = std::vector<size_t>{};
+        for (uint32_t i = 0; i < 300; ++i) {
+            handles.push_back(model->compile(4 + i % 60, 6 + i % 90));
+        }
+        // The first frames size the draw call list and the ring's frame marks.
+        for (size_t i = 0; i < 8; ++i) {
+            model->frame(handles, 40);
+        }
+        check(model->last_batch_count == 7, "consecutive calls with equal keys merge into batches");
+        model->steady_frame_allocation_count = 0;
+        auto count = uint64_t{};
+        {
+            auto const scope = AllocationScope{count};
+            for (size_t i = 0; i < 1000; ++i) {
+                model->frame(handles, 40);
+            }
+        }
+        if (count != 0) {
+            std::fprintf(stderr, "%llu heap allocations in 1000 steady-state frames\n", static_cast<unsigned long long>(count));
+        }
+        check(count == 0, "steady-state UI frames don't allocate");
+        check(model->steady_frame_allocation_count == 0, "the draw list counts no allocations in steady frames");
+        check(model->failed_staging_allocations == 0, "the staging ring fits the frames in flight");
+        check(model->staging.frames_in_flight() <= UiFrameModel::FRAMES_IN_FLIGHT + 1, "the staging ring reclaims completed frames");
+
+        // Releasing and compiling again reuses the same slab records.
+        auto const released = handles.back();
+        model->release(released);
+        handles.back() = model->compile(10, 12);
+        check(handles.back() == released, "the slab reuses freed ids");
+        for (auto handle : handles) {
+            model->release(handle);
+        }
+        auto &draw_list = model->draw_list;
+        check(draw_list.vertex_ranges.used() != 0, "released geometry stays reserved while frames may draw it");
+        draw_list.reclaim(model->timeline_value);
+        check(draw_list.vertex_ranges.used() == 0 && draw_list.index_ranges.used() == 0, "released geometry frees its arena ranges");
+        check(draw_list.vertex_ranges.allocate(draw_list.vertex_ranges.capacity()).has_value(), "freed arena ranges coalesce");
+    }
+
+    void test_ring_reuses_space_only_once_reached() {
+        auto ring = RingAllocator{1024};
+        for (uint64_t frame = 1; frame <= 3; ++frame) {
+            check(ring.allocate(300, 16).has_value(), "ring allocation");
+            ring.end_frame(frame);
+        }
+        // 3 * 304 bytes in flight leave no room for another 300.
+        check(!ring.allocate(300, 16).has_value(), "a full ring refuses allocations");
+        ring.reclaim(1);
+        auto const offset = ring.allocate(300, 16);
+        check(offset == size_t{0}, "the ring wraps into the first completed frame's space");
+        check(!ring.allocate(300, 16).has_value(), "frames that haven't been reached stay allocated");
+        ring.end_frame(4);
+        ring.reclaim(4);
+        check(ring.used() == 0 && ring.frames_in_flight() == 0, "reclaiming every frame empties the ring");
+    }
+} // namespace
+
+auto main() -> int {
+    test_allocation_counting();
+    test_steady_ui_frames_do_not_allocate();
+    test_ring_reuses_space_only_once_reached();
+    if (failure_count != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failure_count);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -5,24 +5,50 @@
 
 #include <daxa/command_recorder.hpp>
 
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
 namespace {
-    void load_fonts() {
-        const Rml::String directory = "C:/dev/downloads/RmlUi/Samples/assets/";
+    // GVOX_EDITOR_FONT_DIR if set, else a fonts directory next to the
+    // executable, else one in the working directory.
+    auto font_directory() -> std::filesystem::path {
+        auto candidates = std::vector<std::filesystem::path>{};
+        if (auto const *variable = std::getenv("GVOX_EDITOR_FONT_DIR"); variable != nullptr && *variable != '\0') {
+            candidates.emplace_back(variable);
+        }
+        if (auto const executable = executable_path(); !executable.empty()) {
+            candidates.push_back(executable.parent_path() / "fonts");
+        }
+        candidates.emplace_back("fonts");
+        for (auto const &candidate : candidates) {
+            auto error = std::error_code{};
+            if (std::filesystem::exists(candidate / "LatoLatin-Regular.ttf", error)) {
+                return candidate;
+            }
+        }
+        std::cerr << "No font directory found, looked in:" << std::endl;
+        for (auto const &candidate : candidates) {
+            std::cerr << "  " << candidate.string() << std::endl;
+        }
+        return candidates.back();
+    }
 
-        struct FontFace {
-            const char *filename;
-            bool fallback_face;
-        };
+    void load_fonts(FontLibrary &font_library) {
+        auto const directory = font_directory();
+
+        using Rml::Style::FontStyle;
+        using Rml::Style::FontWeight;
         auto font_faces = std::array{
-            FontFace{"LatoLatin-Regular.ttf", false},
-            FontFace{"LatoLatin-Italic.ttf", false},
-            FontFace{"LatoLatin-Bold.ttf", false},
-            FontFace{"LatoLatin-BoldItalic.ttf", false},
-            FontFace{"NotoEmoji-Regular.ttf", true},
+            FontFaceInfo{directory / "LatoLatin-Regular.ttf", "LatoLatin", FontStyle::Normal, FontWeight::Normal, false},
+            FontFaceInfo{directory / "LatoLatin-Italic.ttf", "LatoLatin", FontStyle::Italic, FontWeight::Normal, false},
+            FontFaceInfo{directory / "LatoLatin-Bold.ttf", "LatoLatin", FontStyle::Normal, FontWeight::Bold, false},
+            FontFaceInfo{directory / "LatoLatin-BoldItalic.ttf", "LatoLatin", FontStyle::Italic, FontWeight::Bold, false},
+            FontFaceInfo{directory / "NotoEmoji-Regular.ttf", "Noto Emoji", FontStyle::Normal, FontWeight::Normal, true},
         };
 
-        for (const FontFace &face : font_faces) {
-            Rml::LoadFontFace(directory + face.filename, face.fallback_face);
+        for (auto const &face : font_faces) {
+            font_library.load(face);
         }
     }
 
@@ -67,24 +93,32 @@ namespace {
     }
 } // namespace
 
-AppUi::AppUi(daxa::Device device)
-    : app_windows([&]() {
+AppUi::AppUi(daxa::Device device, ThreadPool &thread_pool, std::function<void()> on_texture_loaded, StartupProfiler &startup_profiler)
+    : app_windows(startup_profiler.time("window", [&]() {
         auto result = std::vector<AppWindow>{};
         result.emplace_back(device, daxa_i32vec2{800, 600});
-        return result; }()),
-      render_interface(device, app_windows[0].swapchain.get_format()) {
+        return result; })),
+      render_interface(startup_profiler.time("render interface", [&]() { return RenderInterface_Daxa(device, app_windows[0].swapchain, thread_pool, std::move(on_texture_loaded)); })) {
 
     auto &app_window = app_windows[0];
     app_window.on_close = [&]() { should_close.store(true); };
 
     system_interface.SetWindow(app_window.glfw_window.get());
+    app_window.system_interface = &system_interface;
 
     Rml::SetSystemInterface(&system_interface);
     Rml::SetRenderInterface(&render_interface);
+    Rml::SetFontEngineInterface(&font_engine);
 
-    Rml::Initialise();
-
-    load_fonts();
+    {
+        auto const phase = StartupPhaseScope(startup_profiler, "rmlui");
+        Rml::Initialise();
+    }
+    {
+        auto const phase = StartupPhaseScope(startup_profiler, "fonts");
+        load_fonts(font_library);
+    }
+    auto const documents_phase = StartupPhaseScope(startup_profiler, "documents");
 
     rml_context = Rml::CreateContext("main", Rml::Vector2i(app_window.size.x, app_window.size.y));
     app_window.rml_context = rml_context;
@@ -100,6 +134,30 @@ AppUi::AppUi(daxa::Device device)
     Rml::ElementDocument *document = rml_context->LoadDocument("src/ui/hello_world.rml");
     document->Show();
 
+    if (Rml::DataModelConstructor constructor = rml_context->CreateDataModel("profiler")) {
+        if (auto handle = constructor.RegisterStruct<TaskTimingSummary>()) {
+            handle.RegisterMember("name", &TaskTimingSummary::name);
+            handle.RegisterMember("cpu_ms", &TaskTimingSummary::cpu_ms);
+            handle.RegisterMember("gpu_ms", &TaskTimingSummary::gpu_ms);
+        }
+        constructor.RegisterArray<std::vector<TaskTimingSummary>>();
+        constructor.Bind("frame_ms", &profiler_frame_ms);
+        constructor.Bind("tasks", &profiler_tasks);
+        constructor.Bind("ui_buffer_allocation_count", &ui_buffer_allocation_count);
+        constructor.Bind("ui_draw_count", &ui_draw_count);
+        constructor.Bind("ui_batch_count", &ui_batch_count);
+        constructor.Bind("ui_heap_allocation_count", &ui_heap_allocation_count);
+        constructor.Bind("ui_layer_redraw_count", &ui_layer_redraw_count);
+        constructor.Bind("ui_frame_count", &ui_frame_count);
+        constructor.Bind("loop_frames_per_second", &loop_frames_per_second);
+        constructor.Bind("loop_cpu_percent", &loop_cpu_percent);
+        constructor.Bind("loop_idle", &loop_idle);
+        constructor.Bind("idle_cpu_target_percent", &idle_cpu_target_percent);
+        constructor.Bind("counting_allocations", &counting_allocations);
+        profiler_model = constructor.GetModelHandle();
+    }
+    profiler_document = rml_context->LoadDocument("src/ui/profiler.rml");
+
     // Replace and style some text in the loaded document.
     Rml::Element *element = document->GetElementById("world");
     element->SetInnerRML(reinterpret_cast<const char *>(u8"🌍"));
@@ -112,14 +170,96 @@ AppUi::~AppUi() {
 
 void AppUi::update() {
     for (auto &app_window : app_windows) {
-        app_window.key_down_callback = key_down_callback;
-        app_window.update();
+        app_window.key_down_callback = [this](Rml::Context *context, Rml::Input::KeyIdentifier key, int key_modifier, float native_dp_ratio, bool priority) -> bool {
+            if (priority && key == Rml::Input::KI_F2 && profiler_document != nullptr) {
+                profiler_document->IsVisible() ? profiler_document->Hide() : profiler_document->Show();
+                return false;
+            }
+            if (priority && key == Rml::Input::KI_F12 && on_dump_trace) {
+                on_dump_trace();
+                return false;
+            }
+            if (priority && key == Rml::Input::KI_F5 && on_cycle_shading_mode) {
+                on_cycle_shading_mode();
+                return false;
+            }
+            if (priority && key == Rml::Input::KI_F6 && on_cycle_debug_view) {
+                on_cycle_debug_view();
+                return false;
+            }
+            if (!priority && context != nullptr && (key_modifier & Rml::Input::KM_CTRL) != 0) {
+                if (key == Rml::Input::KI_Z && on_undo) {
+                    on_undo();
+                    return false;
+                }
+                if (key == Rml::Input::KI_Y && on_redo) {
+                    on_redo();
+                    return false;
+                }
+            }
+            return key_down_callback(context, key, key_modifier, native_dp_ratio, priority);
+        };
+        if (app_window.process_events()) {
+            rml_update_needed = true;
+        }
     }
 }
 
+void AppUi::apply_main_thread_requests() {
+    system_interface.apply_requests();
+}
+
+void AppUi::set_profiler_summary(double frame_ms, std::vector<TaskTimingSummary> tasks, FrameSchedulerStats const &scheduler_stats) {
+    profiler_frame_ms = frame_ms;
+    profiler_tasks = std::move(tasks);
+    profiler_model.DirtyVariable("frame_ms");
+    profiler_model.DirtyVariable("tasks");
+    auto const allocation_count = static_cast<int>(render_interface.buffer_allocation_count());
+    if (allocation_count != ui_buffer_allocation_count) {
+        ui_buffer_allocation_count = allocation_count;
+        profiler_model.DirtyVariable("ui_buffer_allocation_count");
+    }
+    auto const render_stats = render_interface.stats();
+    ui_draw_count = static_cast<int>(render_stats.draw_count);
+    ui_batch_count = static_cast<int>(render_stats.batch_count);
+    profiler_model.DirtyVariable("ui_draw_count");
+    profiler_model.DirtyVariable("ui_batch_count");
+    ui_heap_allocation_count = static_cast<int>(render_stats.heap_allocation_count);
+    profiler_model.DirtyVariable("ui_heap_allocation_count");
+    ui_layer_redraw_count = static_cast<int>(render_stats.layer_redraw_count);
+    ui_frame_count = static_cast<int>(render_stats.frame_count);
+    profiler_model.DirtyVariable("ui_layer_redraw_count");
+    profiler_model.DirtyVariable("ui_frame_count");
+    loop_frames_per_second = scheduler_stats.frames_per_second;
+    loop_cpu_percent = scheduler_stats.cpu_percent;
+    loop_idle = scheduler_stats.idle;
+    profiler_model.DirtyVariable("loop_frames_per_second");
+    profiler_model.DirtyVariable("loop_cpu_percent");
+    profiler_model.DirtyVariable("loop_idle");
+    // A hidden overlay picks the values up on the next update that happens
+    // for other reasons.
+    if (profiler_document != nullptr && profiler_document->IsVisible()) {
+        rml_update_needed = true;
+    }
+}
+
+auto AppUi::next_update_delay() const -> double {
+    return rml_context->GetNextUpdateDelay();
+}
+
 void AppUi::render(daxa::CommandRecorder &recorder, daxa::ImageId target_image) {
+    auto const now = std::chrono::steady_clock::now();
+    if (now >= next_rml_update_time || render_interface.has_finished_texture_loads()) {
+        rml_update_needed = true;
+    }
+    if (!rml_update_needed && render_interface.composite_cached_layer(target_image, recorder)) {
+        return;
+    }
     rml_context->Update();
     render_interface.begin_frame(target_image, recorder);
     rml_context->Render();
     render_interface.end_frame(target_image, recorder);
+    rml_update_needed = false;
+    auto const delay = rml_context->GetNextUpdateDelay();
+    next_rml_update_time = std::isinf(delay) ? std::chrono::steady_clock::time_point::max() : now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delay));
 }
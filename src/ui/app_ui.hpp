@@ -2,8 +2,16 @@
 
 #include "rml/system_glfw.hpp"
 #include "rml/render_daxa.hpp"
+#include "rml/font_engine_cached.hpp"
 
 #include "app_window.hpp"
+#include "font_library.hpp"
+
+#include <renderer/frame_profiler.hpp>
+#include <core/startup_profiler.hpp>
+#include <ui/frame_scheduler.hpp>
+
+#include <chrono>
 
 struct AppUi {
     std::atomic_bool should_close = false;
@@ -11,19 +19,62 @@ struct AppUi {
 
     SystemInterface_GLFW system_interface{};
     RenderInterface_Daxa render_interface;
+    FontLibrary font_library{};
+    // Rasterised glyph pages persist here between runs.
+    FontEngineInterface_Cached font_engine{"gvox-editor-cache/fonts"};
     Rml::Context *rml_context{};
 
+    // Ctrl+Z / Ctrl+Y, when no UI element takes the key.
+    std::function<void()> on_undo{};
+    std::function<void()> on_redo{};
+    // F12
+    std::function<void()> on_dump_trace{};
+    // F5 / F6, viewport shading mode and debug view.
+    std::function<void()> on_cycle_shading_mode{};
+    std::function<void()> on_cycle_debug_view{};
+
+    // Frame timing overlay, toggled with F2.
+    Rml::ElementDocument *profiler_document{};
+    Rml::DataModelHandle profiler_model{};
+    double profiler_frame_ms{};
+    std::vector<TaskTimingSummary> profiler_tasks{};
+    int ui_buffer_allocation_count{};
+    int ui_draw_count{};
+    int ui_batch_count{};
+    int ui_heap_allocation_count{};
+    int ui_layer_redraw_count{};
+    int ui_frame_count{};
+    double loop_frames_per_second{};
+    double loop_cpu_percent{};
+    bool loop_idle{};
+    double idle_cpu_target_percent = FrameScheduler::IDLE_CPU_TARGET_PERCENT;
+    bool counting_allocations = ALLOCATION_COUNTING_ENABLED;
+
+    // RmlUi only runs Update and Render when something may have changed:
+    // input, a finished texture load, a visible overlay refresh, or the time
+    // it asked to be updated at. Other frames just composite the cached layer.
+    bool rml_update_needed = true;
+    std::chrono::steady_clock::time_point next_rml_update_time{};
+
     // App state
     bool show_text = true;
     Rml::String animal = "dog";
 
-    explicit AppUi(daxa::Device device);
+    explicit AppUi(daxa::Device device, ThreadPool &thread_pool, std::function<void()> on_texture_loaded, StartupProfiler &startup_profiler);
     ~AppUi();
     AppUi(const AppUi &) = delete;
     AppUi(AppUi &&) = delete;
     auto operator=(const AppUi &) -> AppUi & = delete;
     auto operator=(AppUi &&) -> AppUi & = delete;
 
+    // Render thread. Applies the input queued since the last call.
     void update();
+    // Main thread. Carries out what RmlUi asked of GLFW (cursor, clipboard).
+    void apply_main_thread_requests();
+    void set_profiler_summary(double frame_ms, std::vector<TaskTimingSummary> tasks, FrameSchedulerStats const &scheduler_stats);
+    // Seconds until RmlUi next needs an update, 0 while animating and
+    // infinity when only input can change anything.
+    auto next_update_delay() const -> double;
+    // Render thread, inside the task graph.
     void render(daxa::CommandRecorder &recorder, daxa::ImageId target_image);
 };
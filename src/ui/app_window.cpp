@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 #include <daxa/c/core.h>
 
+#include <optional>
+
 #if defined(_WIN32)
 #define GLFW_EXPOSE_NATIVE_WIN32
 #elif defined(__linux__)
@@ -37,24 +39,28 @@ namespace {
     }
 } // namespace
 
+namespace {
+    auto window_of(GLFWwindow *glfw_window) -> AppWindow & {
+        return *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
+    }
+} // namespace
+
 AppWindow::AppWindow(daxa::Device device, daxa_i32vec2 size)
     : glfw_window{create(size), &glfwDestroyWindow}, size{size} {
     glfwSetWindowUserPointer(this->glfw_window.get(), this);
+
+    // These run on the main thread inside glfwWaitEvents. They only queue the
+    // event for the render thread, which applies it in `process_events`.
     glfwSetWindowSizeCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, int width, int height) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            self.size = {width, height};
-            self.swapchain.resize();
-            if (self.on_resize) {
-                self.on_resize();
-            }
+            window_of(glfw_window).push_event({.type = WindowEventType::RESIZE, .width = width, .height = height});
         });
 
     glfwSetWindowCloseCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
+            auto &self = window_of(glfw_window);
             if (self.on_close) {
                 self.on_close();
             }
@@ -63,101 +69,64 @@ AppWindow::AppWindow(daxa::Device device, daxa_i32vec2 size)
     glfwSetKeyCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, int glfw_key, int /*scancode*/, int glfw_action, int glfw_mods) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            if (context == nullptr) {
-                return;
-            }
-
-            // Store the active modifiers for later because GLFW doesn't provide them in the callbacks to the mouse input events.
-            self.glfw_active_modifiers = glfw_mods;
-
-            // Override the default key event callback to add global shortcuts for the samples.
-            RmlKeyDownCallback &key_down_callback = self.key_down_callback;
-
-            switch (glfw_action) {
-            case GLFW_PRESS:
-            case GLFW_REPEAT: {
-                const Rml::Input::KeyIdentifier key = RmlGLFW::ConvertKey(glfw_key);
-                const int key_modifier = RmlGLFW::ConvertKeyModifiers(glfw_mods);
-                float dp_ratio = 1.f;
-                glfwGetWindowContentScale(glfw_window, &dp_ratio, nullptr);
-
-                // See if we have any global shortcuts that take priority over the context.
-                if (key_down_callback && !key_down_callback(context, key, key_modifier, dp_ratio, true)) {
-                    break;
-                }
-                // Otherwise, hand the event over to the context by calling the input handler as normal.
-                if (!RmlGLFW::ProcessKeyCallback(context, glfw_key, glfw_action, glfw_mods)) {
-                    break;
-                }
-                // The key was not consumed by the context either, try keyboard shortcuts of lower priority.
-                if (key_down_callback && !key_down_callback(context, key, key_modifier, dp_ratio, false)) {
-                    break;
-                }
-            } break;
-            case GLFW_RELEASE:
-                RmlGLFW::ProcessKeyCallback(context, glfw_key, glfw_action, glfw_mods);
-                break;
+            auto &self = window_of(glfw_window);
+            // RmlUi reads the clipboard when handling Ctrl+V, on the render
+            // thread, where GLFW can't be asked for it.
+            if (glfw_action != GLFW_RELEASE && (glfw_mods & GLFW_MOD_CONTROL) != 0 && self.system_interface != nullptr) {
+                self.system_interface->refresh_clipboard();
             }
+            float dp_ratio = 1.f;
+            glfwGetWindowContentScale(glfw_window, &dp_ratio, nullptr);
+            self.push_event({.type = WindowEventType::KEY, .key = glfw_key, .action = glfw_action, .mods = glfw_mods, .scale = dp_ratio});
         });
 
     glfwSetCharCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, unsigned int codepoint) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessCharCallback(context, codepoint);
+            window_of(glfw_window).push_event({.type = WindowEventType::CHAR, .codepoint = codepoint});
         });
 
     glfwSetCursorEnterCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, int entered) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessCursorEnterCallback(context, entered);
+            window_of(glfw_window).push_event({.type = WindowEventType::CURSOR_ENTER, .action = entered});
         });
 
     // Mouse input
     glfwSetCursorPosCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, double xpos, double ypos) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessCursorPosCallback(context, glfw_window, xpos, ypos, self.glfw_active_modifiers);
+            auto &self = window_of(glfw_window);
+            auto const mouse_pos = RmlGLFW::ConvertCursorPos(glfw_window, xpos, ypos);
+            self.push_event({.type = WindowEventType::CURSOR_POS, .mods = self.glfw_active_modifiers, .width = mouse_pos.x, .height = mouse_pos.y});
         });
 
     glfwSetMouseButtonCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, int button, int action, int mods) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
+            auto &self = window_of(glfw_window);
+            // Store the active modifiers for later because GLFW doesn't provide them in the callbacks to the mouse input events.
             self.glfw_active_modifiers = mods;
-            RmlGLFW::ProcessMouseButtonCallback(context, button, action, mods);
+            self.push_event({.type = WindowEventType::MOUSE_BUTTON, .key = button, .action = action, .mods = mods});
         });
 
     glfwSetScrollCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, double /*xoffset*/, double yoffset) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessScrollCallback(context, yoffset, self.glfw_active_modifiers);
+            auto &self = window_of(glfw_window);
+            self.push_event({.type = WindowEventType::SCROLL, .mods = self.glfw_active_modifiers, .offset = yoffset});
         });
 
     glfwSetFramebufferSizeCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, int width, int height) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessFramebufferSizeCallback(context, width, height);
+            window_of(glfw_window).push_event({.type = WindowEventType::FRAMEBUFFER_SIZE, .width = width, .height = height});
         });
 
     glfwSetWindowContentScaleCallback(
         this->glfw_window.get(),
         [](GLFWwindow *glfw_window, float xscale, float /*yscale*/) {
-            auto &self = *reinterpret_cast<AppWindow *>(glfwGetWindowUserPointer(glfw_window));
-            auto *context = self.rml_context;
-            RmlGLFW::ProcessContentScaleCallback(context, xscale);
+            window_of(glfw_window).push_event({.type = WindowEventType::CONTENT_SCALE, .scale = xscale});
         });
 
     this->swapchain = device.create_swapchain({
@@ -170,14 +139,75 @@ AppWindow::AppWindow(daxa::Device device, daxa_i32vec2 size)
             default: return 0;
             }
         },
-        .present_mode = daxa::PresentMode::IMMEDIATE,
+        .present_mode = daxa::PresentMode::FIFO,
         .image_usage = daxa::ImageUsageFlagBits::TRANSFER_DST,
         .max_allowed_frames_in_flight = 1,
         .name = "AppWindowSwapchain",
     });
 }
 
-void AppWindow::update() {
-    glfwSetWindowUserPointer(this->glfw_window.get(), this);
-    glfwPollEvents();
+void AppWindow::push_event(WindowEvent const &event) {
+    if (event.type == WindowEventType::KEY) {
+        glfw_active_modifiers = event.mods;
+    }
+    if (!events->try_push(event)) {
+        // The render thread is badly behind. Dropping input beats stalling
+        // the main thread on it.
+        ++dropped_event_count;
+        return;
+    }
+    if (on_event) {
+        on_event();
+    }
+}
+
+auto AppWindow::process_events() -> bool {
+    auto resized_to = std::optional<daxa_i32vec2>{};
+    auto had_events = false;
+    while (auto event = events->try_pop()) {
+        had_events = true;
+        switch (event->type) {
+        case WindowEventType::KEY: {
+            auto *context = rml_context;
+            if (context == nullptr) {
+                break;
+            }
+            if (event->action == GLFW_RELEASE) {
+                RmlGLFW::ProcessKeyCallback(context, event->key, event->action, event->mods);
+                break;
+            }
+            const Rml::Input::KeyIdentifier key = RmlGLFW::ConvertKey(event->key);
+            const int key_modifier = RmlGLFW::ConvertKeyModifiers(event->mods);
+            // See if we have any global shortcuts that take priority over the context.
+            if (key_down_callback && !key_down_callback(context, key, key_modifier, event->scale, true)) {
+                break;
+            }
+            // Otherwise, hand the event over to the context by calling the input handler as normal.
+            if (!RmlGLFW::ProcessKeyCallback(context, event->key, event->action, event->mods)) {
+                break;
+            }
+            // The key was not consumed by the context either, try keyboard shortcuts of lower priority.
+            if (key_down_callback) {
+                key_down_callback(context, key, key_modifier, event->scale, false);
+            }
+        } break;
+        case WindowEventType::CHAR: RmlGLFW::ProcessCharCallback(rml_context, event->codepoint); break;
+        case WindowEventType::CURSOR_ENTER: RmlGLFW::ProcessCursorEnterCallback(rml_context, event->action); break;
+        case WindowEventType::CURSOR_POS: RmlGLFW::ProcessCursorPosCallback(rml_context, {event->width, event->height}, event->mods); break;
+        case WindowEventType::MOUSE_BUTTON: RmlGLFW::ProcessMouseButtonCallback(rml_context, event->key, event->action, event->mods); break;
+        case WindowEventType::SCROLL: RmlGLFW::ProcessScrollCallback(rml_context, event->offset, event->mods); break;
+        case WindowEventType::FRAMEBUFFER_SIZE: RmlGLFW::ProcessFramebufferSizeCallback(rml_context, event->width, event->height); break;
+        case WindowEventType::CONTENT_SCALE: RmlGLFW::ProcessContentScaleCallback(rml_context, event->scale); break;
+        // A drag queues many of these, only the last size matters.
+        case WindowEventType::RESIZE: resized_to = daxa_i32vec2{event->width, event->height}; break;
+        }
+    }
+    if (resized_to) {
+        size = *resized_to;
+        swapchain.resize();
+        if (on_resize) {
+            on_resize();
+        }
+    }
+    return had_events;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -8,6 +10,38 @@
 
 #include "rml/system_glfw.hpp"
 
+#include <core/spsc_queue.hpp>
+
+enum struct WindowEventType {
+    KEY,
+    CHAR,
+    CURSOR_ENTER,
+    CURSOR_POS,
+    MOUSE_BUTTON,
+    SCROLL,
+    FRAMEBUFFER_SIZE,
+    CONTENT_SCALE,
+    RESIZE,
+};
+
+// A GLFW callback, captured on the main thread. Anything the render thread
+// can't query from GLFW itself (content scale, cursor position in pixels)
+// is resolved when the event is captured.
+struct WindowEvent {
+    WindowEventType type{};
+    // GLFW key or mouse button.
+    int key{};
+    // GLFW action, or whether the cursor entered.
+    int action{};
+    int mods{};
+    unsigned int codepoint{};
+    // Sizes, or the cursor position.
+    int width{};
+    int height{};
+    double offset{};
+    float scale{};
+};
+
 struct AppWindow {
     std::unique_ptr<GLFWwindow, decltype(&glfwDestroyWindow)> glfw_window{nullptr, &glfwDestroyWindow};
     daxa::Swapchain swapchain{};
@@ -15,14 +49,28 @@ struct AppWindow {
 
     int glfw_active_modifiers{};
     Rml::Context *rml_context{};
+    SystemInterface_GLFW *system_interface{};
+
+    // Input goes from the GLFW callbacks on the main thread to the render
+    // thread through this queue.
+    static inline constexpr size_t EVENT_QUEUE_CAPACITY = 4096;
+    std::unique_ptr<SpscQueue<WindowEvent, EVENT_QUEUE_CAPACITY>> events = std::make_unique<SpscQueue<WindowEvent, EVENT_QUEUE_CAPACITY>>();
+    uint64_t dropped_event_count{};
 
+    // Render thread.
     std::function<void()> on_resize{};
+    // Main thread.
     std::function<void()> on_close{};
+    std::function<void()> on_event{};
     using RmlKeyDownCallback = std::function<bool(Rml::Context *context, Rml::Input::KeyIdentifier key, int key_modifier, float native_dp_ratio, bool priority)>;
     RmlKeyDownCallback key_down_callback{};
 
     AppWindow() = default;
     explicit AppWindow(daxa::Device device, daxa_i32vec2 size);
 
-    void update();
+    // Render thread. Applies the queued input to `rml_context`, and handles
+    // the last queued resize. Returns whether there was any.
+    auto process_events() -> bool;
+    // Main thread. Queues the event and calls `on_event`.
+    void push_event(WindowEvent const &event);
 };
@@ -0,0 +1,21 @@
+#include "font_library.hpp"
+
+#include <RmlUi/Core/Core.h>
+
+#include <iostream>
+#include <limits>
+
+auto FontLibrary::load(FontFaceInfo const &face) -> bool {
+    auto mapped_file = MappedFile(face.path);
+    if (!mapped_file.is_open() || mapped_file.size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        std::cerr << "Failed to map font " << face.path.string() << std::endl;
+        return false;
+    }
+    auto const *data = reinterpret_cast<Rml::byte const *>(mapped_file.data);
+    if (!Rml::LoadFontFace(data, static_cast<int>(mapped_file.size), face.family, face.style, face.weight, face.fallback_face)) {
+        return false;
+    }
+    // Moving the mapping doesn't move the mapped memory RmlUi points into.
+    mapped_files.push_back(std::move(mapped_file));
+    return true;
+}
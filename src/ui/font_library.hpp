@@ -0,0 +1,36 @@
+#pragma once
+
+#include <RmlUi/Core/StyleTypes.h>
+#include <RmlUi/Core/Types.h>
+
+#include <filesystem>
+#include <vector>
+
+#include <core/platform.hpp>
+
+struct FontFaceInfo {
+    std::filesystem::path path{};
+    Rml::String family{};
+    Rml::Style::FontStyle style = Rml::Style::FontStyle::Normal;
+    Rml::Style::FontWeight weight = Rml::Style::FontWeight::Auto;
+    bool fallback_face{};
+};
+
+// Registers font files with RmlUi straight from a memory mapping. Loading
+// by path has RmlUi read each whole file into a buffer it keeps for the
+// font's lifetime; here only the pages the font engine touches are ever read.
+// The engine keeps pointing into the mappings, so this must outlive it.
+class FontLibrary {
+  public:
+    FontLibrary() = default;
+    ~FontLibrary() = default;
+    FontLibrary(const FontLibrary &) = delete;
+    FontLibrary(FontLibrary &&) = delete;
+    auto operator=(const FontLibrary &) -> FontLibrary & = delete;
+    auto operator=(FontLibrary &&) -> FontLibrary & = delete;
+
+    auto load(FontFaceInfo const &face) -> bool;
+
+  private:
+    std::vector<MappedFile> mapped_files{};
+};
@@ -0,0 +1,59 @@
+#include "frame_scheduler.hpp"
+
+#include <core/platform.hpp>
+
+#include <algorithm>
+#include <thread>
+
+FrameScheduler::FrameScheduler(double max_frames_per_second)
+    : min_frame_time{std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / max_frames_per_second))},
+      frame_start{Clock::now()},
+      window_start{frame_start},
+      window_cpu_seconds{process_cpu_seconds()} {
+}
+
+void FrameScheduler::wake() {
+    {
+        auto lock = std::lock_guard{wake_mutex};
+        woken = true;
+    }
+    wake_cv.notify_one();
+}
+
+void FrameScheduler::wait(double max_wait_seconds) {
+    // A wake that arrives while sleeping off the cap ends the wait below
+    // right away.
+    std::this_thread::sleep_until(frame_start + min_frame_time);
+    auto waited_idle = false;
+    {
+        auto lock = std::unique_lock{wake_mutex};
+        if (max_wait_seconds > 0.0 && !woken) {
+            auto const timeout = std::chrono::duration<double>(std::min(max_wait_seconds, MAX_IDLE_WAIT_SECONDS));
+            wake_cv.wait_until(lock, Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout), [this]() { return woken; });
+            waited_idle = true;
+        }
+        woken = false;
+    }
+    frame_start = Clock::now();
+    update_stats(waited_idle);
+}
+
+void FrameScheduler::update_stats(bool waited_idle) {
+    ++window_frame_count;
+    window_idle_wait_count += waited_idle ? 1 : 0;
+    auto const elapsed = frame_start - window_start;
+    if (elapsed < STATS_WINDOW) {
+        return;
+    }
+    auto const seconds = std::chrono::duration<double>(elapsed).count();
+    auto const cpu_seconds = process_cpu_seconds();
+    last_stats = {
+        .frames_per_second = static_cast<double>(window_frame_count) / seconds,
+        .cpu_percent = (cpu_seconds - window_cpu_seconds) / seconds * 100.0,
+        .idle = window_idle_wait_count == window_frame_count,
+    };
+    window_start = frame_start;
+    window_cpu_seconds = cpu_seconds;
+    window_frame_count = 0;
+    window_idle_wait_count = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+struct FrameSchedulerStats {
+    // Over the last measurement window.
+    double frames_per_second{};
+    // Process CPU time per second of wall time, in percent of one core.
+    double cpu_percent{};
+    bool idle{};
+};
+
+// Paces the render thread. `wait` holds it to the frame rate cap, and when
+// nothing asked for another frame it sleeps until input is queued, the
+// requested delay runs out, or background work calls `wake`, so an idle
+// editor sleeps instead of spinning.
+class FrameScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static inline constexpr double DEFAULT_MAX_FRAMES_PER_SECOND = 144.0;
+    // Longest an idle loop sleeps, so timed UI like the profiler overlay
+    // still refreshes.
+    static inline constexpr double MAX_IDLE_WAIT_SECONDS = 0.5;
+    // What the idle editor is expected to stay under, as measured by
+    // `stats().cpu_percent`.
+    static inline constexpr double IDLE_CPU_TARGET_PERCENT = 1.0;
+
+    explicit FrameScheduler(double max_frames_per_second = DEFAULT_MAX_FRAMES_PER_SECOND);
+    FrameScheduler(const FrameScheduler &) = delete;
+    FrameScheduler(FrameScheduler &&) = delete;
+    auto operator=(const FrameScheduler &) -> FrameScheduler & = delete;
+    auto operator=(FrameScheduler &&) -> FrameScheduler & = delete;
+
+    // Thread-safe. Ends the current or next wait early, e.g. when input was
+    // queued or background work has results for the render thread.
+    void wake();
+    // Returns when the next frame should start. A `max_wait_seconds` of 0
+    // means something is animating or loading and only the frame cap applies.
+    void wait(double max_wait_seconds);
+
+    auto stats() const -> FrameSchedulerStats { return last_stats; }
+
+  private:
+    static inline constexpr auto STATS_WINDOW = std::chrono::seconds(1);
+
+    Clock::duration min_frame_time;
+    Clock::time_point frame_start{};
+    std::mutex wake_mutex{};
+    std::condition_variable wake_cv{};
+    bool woken{};
+
+    Clock::time_point window_start{};
+    double window_cpu_seconds{};
+    uint32_t window_frame_count{};
+    uint32_t window_idle_wait_count{};
+    FrameSchedulerStats last_stats{};
+
+    void update_stats(bool waited_idle);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <core/range_allocator.hpp>
+#include <core/slab.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Geometry compiled into the UI renderer's arenas, in vertex and index
+// elements.
+struct UiCompiledDraw {
+    uint32_t vertex_offset{};
+    uint32_t vertex_count{};
+    uint32_t index_offset{};
+    uint32_t index_count{};
+    uintptr_t texture{};
+};
+
+// The bookkeeping of RenderInterface_Daxa that doesn't need the GPU, kept
+// apart so it can be checked headlessly: compiled draws and the arena ranges
+// they hold, the draw calls of the current frame, and the batches runs of
+// them merge into. `Call` is the renderer's draw call record, and `BatchKey`
+// what consecutive calls must share to be drawn as one batch.
+//
+// A frame that uploads nothing and has no more calls than a frame before it
+// is steady, and must not touch the heap. The call and batch lists keep their
+// capacity across frames, and compiled draws live in a Slab, for that.
+template <typename Call, typename BatchKey>
+class UiDrawList {
+  public:
+    struct Batch {
+        uint32_t first_call{};
+        uint32_t call_count{};
+        BatchKey key{};
+    };
+
+    // Element ranges of the vertex and index arenas. The renderer grows them
+    // along with its buffers.
+    RangeAllocator vertex_ranges{};
+    RangeAllocator index_ranges{};
+    // Heap allocations made while building the current frame. The renderer
+    // adds its entry points to it with AllocationScope.
+    uint64_t frame_allocation_count{};
+
+    auto add_compiled(UiCompiledDraw const &draw) -> size_t { return compiled_draws.insert(draw); }
+    auto compiled(size_t handle) const -> UiCompiledDraw const & { return compiled_draws[handle]; }
+    // The draw's ranges stay reserved until `timeline_value`, the last frame
+    // that may still draw it, is reached.
+    void release_compiled(size_t handle, uint64_t timeline_value) {
+        retired_draws.push_back({.draw = compiled_draws[handle], .timeline_value = timeline_value});
+        compiled_draws.erase(handle);
+    }
+    void reclaim(uint64_t completed_timeline_value) {
+        std::erase_if(retired_draws, [&](RetiredDraw const &retired) {
+            if (retired.timeline_value > completed_timeline_value) {
+                return false;
+            }
+            vertex_ranges.free(retired.draw.vertex_offset, retired.draw.vertex_count);
+            index_ranges.free(retired.draw.index_offset, retired.draw.index_count);
+            return true;
+        });
+    }
+
+    void push(Call const &call) { frame_calls.push_back(call); }
+    auto calls() const -> std::span<Call const> { return frame_calls; }
+    // Merges runs of consecutive calls whose `key_of(call)` compare equal.
+    // Keys are taken here rather than in `push`, since what they refer to
+    // (a grown arena's buffer, say) may change while the frame is built.
+    template <typename KeyOf>
+    auto build_batches(KeyOf &&key_of) -> std::span<Batch const> {
+        frame_batches.clear();
+        for (uint32_t i = 0; i < frame_calls.size(); ++i) {
+            auto key = key_of(frame_calls[i]);
+            if (!frame_batches.empty() && frame_batches.back().key == key) {
+                ++frame_batches.back().call_count;
+            } else {
+                frame_batches.push_back({.first_call = i, .call_count = 1, .key = key});
+            }
+        }
+        return frame_batches;
+    }
+    auto batches() const -> std::span<Batch const> { return frame_batches; }
+
+    auto is_steady(bool has_uploads) const -> bool { return !has_uploads && frame_calls.size() <= call_high_water; }
+    // Clears the frame's calls and batches, and returns the heap allocations
+    // made while building it.
+    auto end_frame() -> uint64_t {
+        call_high_water = std::max(call_high_water, frame_calls.size());
+        frame_calls.clear();
+        frame_batches.clear();
+        auto const result = frame_allocation_count;
+        frame_allocation_count = 0;
+        return result;
+    }
+
+  private:
+    struct RetiredDraw {
+        UiCompiledDraw draw{};
+        uint64_t timeline_value{};
+    };
+
+    Slab<UiCompiledDraw> compiled_draws{};
+    std::vector<RetiredDraw> retired_draws{};
+    std::vector<Call> frame_calls{};
+    std::vector<Batch> frame_batches{};
+    size_t call_high_water{};
+};
@@ -0,0 +1,630 @@
+#include "font_engine_cached.hpp"
+
+#include <RmlUi/Core/Geometry.h>
+#include <RmlUi/Core/GeometryUtilities.h>
+#include <RmlUi/Core/StringUtilities.h>
+#include <RmlUi/Core/Texture.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+    constexpr uint32_t CACHE_MAGIC = 0x43464747; // "GGFC"
+    constexpr uint32_t FORMAT_VERSION = 1;
+    constexpr uint32_t PAGE_SIZE = 256;
+    constexpr float PAGE_TEXEL = 1.0f / static_cast<float>(PAGE_SIZE);
+    // Empty texels between glyphs, so filtering never picks up a neighbour.
+    constexpr uint32_t GLYPH_PADDING = 1;
+
+    // FNV-1a. Keys only need to tell fonts apart, not resist collisions.
+    void hash_bytes(uint64_t &hash, void const *data, size_t size) {
+        auto const *bytes = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    }
+
+    auto read_u16(std::span<std::byte const> bytes, size_t offset) -> uint16_t {
+        return static_cast<uint16_t>((static_cast<uint32_t>(bytes[offset]) << 8) | static_cast<uint32_t>(bytes[offset + 1]));
+    }
+    auto read_u32(std::span<std::byte const> bytes, size_t offset) -> uint32_t {
+        return (static_cast<uint32_t>(read_u16(bytes, offset)) << 16) | read_u16(bytes, offset + 2);
+    }
+
+    // The table tagged `tag` in the font's table directory, or nothing.
+    auto find_table(std::span<std::byte const> font, char const *tag) -> std::span<std::byte const> {
+        if (font.size() < 12) {
+            return {};
+        }
+        auto const table_count = size_t{read_u16(font, 4)};
+        for (size_t i = 0; i < table_count && 12 + (i + 1) * 16 <= font.size(); ++i) {
+            auto const record = 12 + i * 16;
+            if (std::memcmp(font.data() + record, tag, 4) != 0) {
+                continue;
+            }
+            auto const offset = size_t{read_u32(font, record + 8)};
+            auto const length = size_t{read_u32(font, record + 12)};
+            if (offset > font.size() || length > font.size() - offset) {
+                return {};
+            }
+            return font.subspan(offset, length);
+        }
+        return {};
+    }
+
+    // A name table string from the Windows Unicode entries, as UTF-8.
+    auto font_name(stbtt_fontinfo const &info, int name_id) -> Rml::String {
+        auto length = 0;
+        auto const *utf16 = stbtt_GetFontNameString(&info, &length, STBTT_PLATFORM_ID_MICROSOFT, STBTT_MS_EID_UNICODE_BMP, STBTT_MS_LANG_ENGLISH, name_id);
+        auto result = Rml::String{};
+        for (int i = 0; utf16 != nullptr && i + 1 < length; i += 2) {
+            auto const code_unit = (static_cast<uint32_t>(static_cast<unsigned char>(utf16[i])) << 8) | static_cast<unsigned char>(utf16[i + 1]);
+            result += Rml::StringUtilities::ToUTF8(static_cast<Rml::Character>(code_unit));
+        }
+        return result;
+    }
+
+    auto weight_value(Rml::Style::FontWeight weight) -> int {
+        return weight == Rml::Style::FontWeight::Auto ? static_cast<int>(Rml::Style::FontWeight::Normal) : static_cast<int>(weight);
+    }
+} // namespace
+
+struct FontEngineInterface_Cached::Glyph {
+    uint32_t codepoint{};
+    uint16_t page{};
+    uint16_t x{};
+    uint16_t y{};
+    uint16_t width{};
+    uint16_t height{};
+    // Which of the size's sources it came from, the face or a fallback.
+    uint16_t source{};
+    // Offset of the bitmap's top left corner from the pen on the baseline.
+    int16_t bearing_x{};
+    int16_t bearing_y{};
+    int16_t advance{};
+    int16_t reserved{};
+};
+struct FontEngineInterface_Cached::Face {
+    Rml::String family{};
+    Rml::Style::FontStyle style{};
+    Rml::Style::FontWeight weight{};
+    bool fallback_face{};
+    std::span<std::byte const> data{};
+    stbtt_fontinfo info{};
+    uint64_t hash{};
+};
+
+struct FontEngineInterface_Cached::FaceSize {
+    struct Page {
+        std::vector<uint8_t> alpha = std::vector<uint8_t>(static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE);
+        Rml::Texture texture{};
+        // Glyphs were added since the texture was last set.
+        bool texture_stale = true;
+        bool texture_set{};
+
+        void refresh_texture();
+    };
+    // Written to the cache files as is.
+    static_assert(std::is_trivially_copyable_v<Glyph> && sizeof(Glyph) == 24);
+
+    Face *face{};
+    int size{};
+    // The face first, then the fallback faces in load order.
+    std::vector<Face *> sources{};
+    std::string key{};
+
+    int x_height{};
+    int line_height{};
+    int baseline{};
+    float underline_position{};
+    float underline_thickness{};
+
+    std::unordered_map<char32_t, Glyph> glyphs{};
+    std::vector<std::unique_ptr<Page>> pages{};
+    // Glyphs are placed in rows, left to right, in the last page.
+    uint32_t pen_x{};
+    uint32_t pen_y{};
+    uint32_t row_height{};
+    std::unordered_map<uint64_t, int> kerning{};
+    // Holds glyphs that aren't in the cache file yet.
+    bool dirty{};
+    // Returned by GetVersion. Setting a page texture again releases the
+    // handle that text generated before still holds in its compiled
+    // geometry, so every change has RmlUi generate the size's text again.
+    int version = 1;
+};
+
+namespace {
+    // Everything RmlUi needs of a face size besides the glyphs and pages.
+    struct CacheHeader {
+        uint32_t magic{};
+        uint32_t version{};
+        uint32_t page_size{};
+        uint32_t page_count{};
+        uint32_t glyph_count{};
+        uint32_t pen_x{};
+        uint32_t pen_y{};
+        uint32_t row_height{};
+        int32_t size{};
+        int32_t x_height{};
+        int32_t line_height{};
+        int32_t baseline{};
+        float underline_position{};
+        float underline_thickness{};
+    };
+} // namespace
+
+FontEngineInterface_Cached::FontEngineInterface_Cached(std::filesystem::path a_directory)
+    : directory{std::move(a_directory)} {
+    auto error = std::error_code{};
+    std::filesystem::create_directories(directory, error);
+}
+
+FontEngineInterface_Cached::~FontEngineInterface_Cached() {
+    save();
+}
+
+void FontEngineInterface_Cached::save() {
+    for (auto &face_size : face_sizes) {
+        if (face_size->dirty) {
+            write(*face_size);
+            face_size->dirty = false;
+        }
+    }
+}
+
+auto FontEngineInterface_Cached::LoadFontFace(const Rml::String &file_name, bool fallback_face, Rml::Style::FontWeight weight) -> bool {
+    auto mapped_file = MappedFile(file_name);
+    if (!mapped_file.is_open()) {
+        std::cerr << "Failed to map font " << file_name << std::endl;
+        return false;
+    }
+    auto const *data = reinterpret_cast<Rml::byte const *>(mapped_file.data);
+    auto const offset = stbtt_GetFontOffsetForIndex(data, 0);
+    auto info = stbtt_fontinfo{};
+    if (offset < 0 || stbtt_InitFont(&info, data, offset) == 0) {
+        std::cerr << "Failed to load font " << file_name << std::endl;
+        return false;
+    }
+    // The style comes from the subfamily name, "Bold Italic" and the like.
+    auto const subfamily = font_name(info, 2);
+    auto const style = subfamily.find("Italic") != Rml::String::npos || subfamily.find("Oblique") != Rml::String::npos ? Rml::Style::FontStyle::Italic : Rml::Style::FontStyle::Normal;
+    if (weight == Rml::Style::FontWeight::Auto) {
+        weight = subfamily.find("Bold") != Rml::String::npos ? Rml::Style::FontWeight::Bold : Rml::Style::FontWeight::Normal;
+    }
+    if (!add_face(data, mapped_file.size, font_name(info, 1), style, weight, fallback_face)) {
+        return false;
+    }
+    // Moving the mapping doesn't move the mapped memory the face points into.
+    mapped_files.push_back(std::move(mapped_file));
+    return true;
+}
+
+auto FontEngineInterface_Cached::LoadFontFace(const Rml::byte *data, int data_size, const Rml::String &family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) -> bool {
+    if (data == nullptr || data_size <= 0) {
+        return false;
+    }
+    return add_face(data, static_cast<size_t>(data_size), family, style, weight, fallback_face);
+}
+
+auto FontEngineInterface_Cached::add_face(Rml::byte const *data, size_t data_size, Rml::String family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) -> bool {
+    auto face = std::make_unique<Face>();
+    face->data = {reinterpret_cast<std::byte const *>(data), data_size};
+    auto const offset = stbtt_GetFontOffsetForIndex(data, 0);
+    if (offset < 0 || stbtt_InitFont(&face->info, data, offset) == 0) {
+        std::cerr << "Failed to load font face " << family << std::endl;
+        return false;
+    }
+    face->family = Rml::StringUtilities::ToLower(family);
+    face->style = style;
+    face->weight = weight;
+    face->fallback_face = fallback_face;
+    // The head table carries a checksum of the whole font and its revision,
+    // which tells versions of a font apart without reading all of it.
+    face->hash = 0xcbf29ce484222325;
+    hash_bytes(face->hash, &data_size, sizeof(data_size));
+    auto const head = find_table(face->data, "head");
+    if (!head.empty()) {
+        hash_bytes(face->hash, head.data(), head.size());
+    } else {
+        hash_bytes(face->hash, data, data_size);
+    }
+    faces.push_back(std::move(face));
+    return true;
+}
+
+auto FontEngineInterface_Cached::GetFontFaceHandle(const Rml::String &family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, int size) -> Rml::FontFaceHandle {
+    if (size <= 0) {
+        return 0;
+    }
+    auto const family_name = Rml::StringUtilities::ToLower(family);
+    Face *best_face = nullptr;
+    auto best_score = INT_MAX;
+    for (auto const &face : faces) {
+        if (face->family != family_name) {
+            continue;
+        }
+        // A matching style matters more than a close weight.
+        auto const score = (face->style != style ? 10000 : 0) + std::abs(weight_value(face->weight) - weight_value(weight));
+        if (score < best_score) {
+            best_face = face.get();
+            best_score = score;
+        }
+    }
+    if (best_face == nullptr) {
+        return 0;
+    }
+    for (auto const &face_size : face_sizes) {
+        if (face_size->face == best_face && face_size->size == size) {
+            return reinterpret_cast<Rml::FontFaceHandle>(face_size.get());
+        }
+    }
+    face_sizes.push_back(create_face_size(*best_face, size));
+    return reinterpret_cast<Rml::FontFaceHandle>(face_sizes.back().get());
+}
+
+auto FontEngineInterface_Cached::create_face_size(Face &face, int size) -> std::unique_ptr<FaceSize> {
+    auto face_size = std::make_unique<FaceSize>();
+    face_size->face = &face;
+    face_size->size = size;
+    face_size->sources.push_back(&face);
+    for (auto const &fallback : faces) {
+        if (fallback->fallback_face && fallback.get() != &face) {
+            face_size->sources.push_back(fallback.get());
+        }
+    }
+
+    auto hash = uint64_t{0xcbf29ce484222325};
+    hash_bytes(hash, &FORMAT_VERSION, sizeof(FORMAT_VERSION));
+    hash_bytes(hash, &PAGE_SIZE, sizeof(PAGE_SIZE));
+    hash_bytes(hash, &size, sizeof(size));
+    for (auto const *source : face_size->sources) {
+        hash_bytes(hash, &source->hash, sizeof(source->hash));
+    }
+    face_size->key = std::string(16, '0');
+    std::snprintf(face_size->key.data(), face_size->key.size() + 1, "%016llx", static_cast<unsigned long long>(hash));
+
+    if (load(*face_size)) {
+        ++cache_stats.loaded_size_count;
+        return face_size;
+    }
+
+    auto const &info = face.info;
+    auto const scale = stbtt_ScaleForMappingEmToPixels(&info, static_cast<float>(size));
+    auto ascent = 0;
+    auto descent = 0;
+    auto line_gap = 0;
+    stbtt_GetFontVMetrics(&info, &ascent, &descent, &line_gap);
+    face_size->line_height = static_cast<int>(std::lround(static_cast<float>(ascent - descent + line_gap) * scale));
+    // RmlUi measures the baseline up from the bottom of the line.
+    face_size->baseline = face_size->line_height - static_cast<int>(std::ceil(static_cast<float>(ascent) * scale));
+    auto x0 = 0;
+    auto y0 = 0;
+    auto x1 = 0;
+    auto y1 = 0;
+    face_size->x_height = stbtt_GetCodepointBox(&info, 'x', &x0, &y0, &x1, &y1) != 0 ? static_cast<int>(std::lround(static_cast<float>(y1) * scale)) : size / 2;
+    // The post table has the underline, in font units, up from the baseline.
+    if (auto const post = find_table(face.data, "post"); post.size() >= 12) {
+        face_size->underline_position = -static_cast<float>(static_cast<int16_t>(read_u16(post, 8))) * scale;
+        face_size->underline_thickness = std::max(static_cast<float>(static_cast<int16_t>(read_u16(post, 10))) * scale, 1.0f);
+    } else {
+        face_size->underline_position = static_cast<float>(size) / 10.0f;
+        face_size->underline_thickness = std::max(static_cast<float>(size) / 14.0f, 1.0f);
+    }
+
+    // Printable ASCII and Latin-1 cover almost all of the UI's text.
+    for (char32_t codepoint = 0x20; codepoint < 0x7f; ++codepoint) {
+        bake(*face_size, codepoint);
+    }
+    for (char32_t codepoint = 0xa0; codepoint < 0x100; ++codepoint) {
+        bake(*face_size, codepoint);
+    }
+    write(*face_size);
+    face_size->dirty = false;
+    ++cache_stats.baked_size_count;
+    return face_size;
+}
+
+auto FontEngineInterface_Cached::load(FaceSize &face_size) -> bool {
+    auto const file = MappedFile(directory / (face_size.key + ".bin"));
+    auto header = CacheHeader{};
+    if (!file.is_open() || file.size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data, sizeof(header));
+    auto const page_bytes = static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE;
+    auto const expected_size = sizeof(header) + header.glyph_count * sizeof(Glyph) + header.page_count * page_bytes;
+    if (header.magic != CACHE_MAGIC || header.version != FORMAT_VERSION || header.page_size != PAGE_SIZE || header.size != face_size.size || file.size != expected_size) {
+        return false;
+    }
+    auto const *glyph_data = file.data + sizeof(header);
+    for (uint32_t i = 0; i < header.glyph_count; ++i) {
+        auto glyph = Glyph{};
+        std::memcpy(&glyph, glyph_data + i * sizeof(Glyph), sizeof(Glyph));
+        if ((glyph.width != 0 && glyph.page >= header.page_count) || glyph.source >= face_size.sources.size()) {
+            face_size.glyphs.clear();
+            return false;
+        }
+        face_size.glyphs.emplace(static_cast<char32_t>(glyph.codepoint), glyph);
+    }
+    auto const *page_data = glyph_data + header.glyph_count * sizeof(Glyph);
+    for (uint32_t i = 0; i < header.page_count; ++i) {
+        auto &page = *face_size.pages.emplace_back(std::make_unique<FaceSize::Page>());
+        std::memcpy(page.alpha.data(), page_data + i * page_bytes, page_bytes);
+    }
+    face_size.pen_x = header.pen_x;
+    face_size.pen_y = header.pen_y;
+    face_size.row_height = header.row_height;
+    face_size.x_height = header.x_height;
+    face_size.line_height = header.line_height;
+    face_size.baseline = header.baseline;
+    face_size.underline_position = header.underline_position;
+    face_size.underline_thickness = header.underline_thickness;
+    return true;
+}
+
+void FontEngineInterface_Cached::write(FaceSize const &face_size) const {
+    auto const path = directory / (face_size.key + ".bin");
+    auto const pending_path = directory / (face_size.key + ".bin.pending");
+    {
+        auto file = std::ofstream{pending_path, std::ios::binary | std::ios::trunc};
+        auto const header = CacheHeader{
+            .magic = CACHE_MAGIC,
+            .version = FORMAT_VERSION,
+            .page_size = PAGE_SIZE,
+            .page_count = static_cast<uint32_t>(face_size.pages.size()),
+            .glyph_count = static_cast<uint32_t>(face_size.glyphs.size()),
+            .pen_x = face_size.pen_x,
+            .pen_y = face_size.pen_y,
+            .row_height = face_size.row_height,
+            .size = face_size.size,
+            .x_height = face_size.x_height,
+            .line_height = face_size.line_height,
+            .baseline = face_size.baseline,
+            .underline_position = face_size.underline_position,
+            .underline_thickness = face_size.underline_thickness,
+        };
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        for (auto const &[codepoint, glyph] : face_size.glyphs) {
+            file.write(reinterpret_cast<char const *>(&glyph), sizeof(glyph));
+        }
+        for (auto const &page : face_size.pages) {
+            file.write(reinterpret_cast<char const *>(page->alpha.data()), static_cast<std::streamsize>(page->alpha.size()));
+        }
+        if (!file) {
+            std::cerr << "Failed to write font cache " << pending_path.string() << std::endl;
+            return;
+        }
+    }
+    // Renamed into place, so a reader never sees half a file.
+    auto error = std::error_code{};
+    std::filesystem::rename(pending_path, path, error);
+}
+
+auto FontEngineInterface_Cached::glyph(FaceSize &face_size, char32_t codepoint) -> Glyph const & {
+    auto iter = face_size.glyphs.find(codepoint);
+    if (iter == face_size.glyphs.end()) {
+        bake(face_size, codepoint);
+        iter = face_size.glyphs.find(codepoint);
+    }
+    return iter->second;
+}
+
+auto FontEngineInterface_Cached::kerning(FaceSize &face_size, Glyph const &left, Glyph const &right) -> int {
+    if (left.source != right.source) {
+        return 0;
+    }
+    auto const pair = (static_cast<uint64_t>(left.codepoint) << 32) | right.codepoint;
+    auto [iter, inserted] = face_size.kerning.try_emplace(pair);
+    if (inserted) {
+        auto const &info = face_size.sources[left.source]->info;
+        auto const scale = stbtt_ScaleForMappingEmToPixels(&info, static_cast<float>(face_size.size));
+        auto const advance = stbtt_GetCodepointKernAdvance(&info, static_cast<int>(left.codepoint), static_cast<int>(right.codepoint));
+        iter->second = static_cast<int>(std::lround(static_cast<float>(advance) * scale));
+    }
+    return iter->second;
+}
+
+void FontEngineInterface_Cached::bake(FaceSize &face_size, char32_t codepoint) {
+    auto const character = static_cast<int>(codepoint);
+    // Without any face that has it, the face's own missing glyph is shown.
+    auto source = uint16_t{0};
+    for (size_t i = 0; i < face_size.sources.size(); ++i) {
+        if (stbtt_FindGlyphIndex(&face_size.sources[i]->info, character) != 0) {
+            source = static_cast<uint16_t>(i);
+            break;
+        }
+    }
+    auto const &info = face_size.sources[source]->info;
+    auto const scale = stbtt_ScaleForMappingEmToPixels(&info, static_cast<float>(face_size.size));
+    auto advance = 0;
+    auto left_side_bearing = 0;
+    stbtt_GetCodepointHMetrics(&info, character, &advance, &left_side_bearing);
+    auto x0 = 0;
+    auto y0 = 0;
+    auto x1 = 0;
+    auto y1 = 0;
+    stbtt_GetCodepointBitmapBox(&info, character, scale, scale, &x0, &y0, &x1, &y1);
+    auto glyph = Glyph{
+        .codepoint = static_cast<uint32_t>(codepoint),
+        .source = source,
+        .bearing_x = static_cast<int16_t>(x0),
+        .bearing_y = static_cast<int16_t>(y0),
+        .advance = static_cast<int16_t>(std::lround(static_cast<float>(advance) * scale)),
+    };
+
+    auto const width = static_cast<uint32_t>(std::max(x1 - x0, 0));
+    auto const height = static_cast<uint32_t>(std::max(y1 - y0, 0));
+    if (width != 0 && height != 0 && width + 2 * GLYPH_PADDING <= PAGE_SIZE && height + 2 * GLYPH_PADDING <= PAGE_SIZE) {
+        if (face_size.pen_x + GLYPH_PADDING + width > PAGE_SIZE) {
+            face_size.pen_x = 0;
+            face_size.pen_y += face_size.row_height;
+            face_size.row_height = 0;
+        }
+        if (face_size.pages.empty() || face_size.pen_y + GLYPH_PADDING + height > PAGE_SIZE) {
+            face_size.pages.push_back(std::make_unique<FaceSize::Page>());
+            face_size.pen_x = 0;
+            face_size.pen_y = 0;
+            face_size.row_height = 0;
+        }
+        auto &page = *face_size.pages.back();
+        auto const x = face_size.pen_x + GLYPH_PADDING;
+        auto const y = face_size.pen_y + GLYPH_PADDING;
+        stbtt_MakeCodepointBitmap(&info, page.alpha.data() + y * PAGE_SIZE + x, static_cast<int>(width), static_cast<int>(height), static_cast<int>(PAGE_SIZE), scale, scale, character);
+        page.texture_stale = true;
+        face_size.pen_x = x + width;
+        face_size.row_height = std::max(face_size.row_height, height + GLYPH_PADDING);
+        glyph.page = static_cast<uint16_t>(face_size.pages.size() - 1);
+        glyph.x = static_cast<uint16_t>(x);
+        glyph.y = static_cast<uint16_t>(y);
+        glyph.width = static_cast<uint16_t>(width);
+        glyph.height = static_cast<uint16_t>(height);
+    }
+    face_size.glyphs.emplace(codepoint, glyph);
+    face_size.dirty = true;
+    ++cache_stats.rasterised_glyph_count;
+}
+
+auto FontEngineInterface_Cached::PrepareFontEffects(Rml::FontFaceHandle /*handle*/, const Rml::FontEffectList & /*font_effects*/) -> Rml::FontEffectsHandle {
+    return 0;
+}
+
+auto FontEngineInterface_Cached::GetSize(Rml::FontFaceHandle handle) -> int {
+    return handle != 0 ? reinterpret_cast<FaceSize *>(handle)->size : 0;
+}
+
+auto FontEngineInterface_Cached::GetXHeight(Rml::FontFaceHandle handle) -> int {
+    return handle != 0 ? reinterpret_cast<FaceSize *>(handle)->x_height : 0;
+}
+
+auto FontEngineInterface_Cached::GetLineHeight(Rml::FontFaceHandle handle) -> int {
+    return handle != 0 ? reinterpret_cast<FaceSize *>(handle)->line_height : 0;
+}
+
+auto FontEngineInterface_Cached::GetBaseline(Rml::FontFaceHandle handle) -> int {
+    return handle != 0 ? reinterpret_cast<FaceSize *>(handle)->baseline : 0;
+}
+
+auto FontEngineInterface_Cached::GetUnderline(Rml::FontFaceHandle handle, float &thickness) -> float {
+    if (handle == 0) {
+        thickness = 0.0f;
+        return 0.0f;
+    }
+    auto const &face_size = *reinterpret_cast<FaceSize *>(handle);
+    thickness = face_size.underline_thickness;
+    return face_size.underline_position;
+}
+
+auto FontEngineInterface_Cached::GetStringWidth(Rml::FontFaceHandle handle, const Rml::String &string, Rml::Character prior_character) -> int {
+    if (handle == 0) {
+        return 0;
+    }
+    auto &face_size = *reinterpret_cast<FaceSize *>(handle);
+    auto width = 0;
+    auto const *previous = prior_character != Rml::Character::Null ? &glyph(face_size, static_cast<char32_t>(prior_character)) : nullptr;
+    for (auto iter = Rml::StringIteratorU8(string); iter; ++iter) {
+        auto const &current = glyph(face_size, static_cast<char32_t>(*iter));
+        if (previous != nullptr) {
+            width += kerning(face_size, *previous, current);
+        }
+        width += current.advance;
+        previous = &current;
+    }
+    return width;
+}
+
+auto FontEngineInterface_Cached::GenerateString(Rml::FontFaceHandle face_handle, Rml::FontEffectsHandle /*font_effects_handle*/, const Rml::String &string, const Rml::Vector2f &position, const Rml::Colourb &colour, float opacity, Rml::GeometryList &geometry) -> int {
+    if (face_handle == 0) {
+        return 0;
+    }
+    auto &face_size = *reinterpret_cast<FaceSize *>(face_handle);
+    // New glyphs first, so the pages are final before geometry binds them.
+    for (auto iter = Rml::StringIteratorU8(string); iter; ++iter) {
+        glyph(face_size, static_cast<char32_t>(*iter));
+    }
+    // One geometry per page. The list is shared by every line of an
+    // element, so earlier lines may have bound some already.
+    if (geometry.size() < face_size.pages.size()) {
+        geometry.resize(face_size.pages.size());
+    }
+    for (size_t i = 0; i < face_size.pages.size(); ++i) {
+        auto &page = *face_size.pages[i];
+        if (page.texture_stale) {
+            if (page.texture_set) {
+                ++face_size.version;
+            }
+            page.refresh_texture();
+        }
+        geometry[i].SetTexture(&page.texture);
+    }
+
+    auto text_colour = colour;
+    text_colour.alpha = static_cast<Rml::byte>(static_cast<float>(colour.alpha) * opacity);
+    auto pen_x = position.x;
+    Glyph const *previous = nullptr;
+    for (auto iter = Rml::StringIteratorU8(string); iter; ++iter) {
+        auto const &current = glyph(face_size, static_cast<char32_t>(*iter));
+        if (previous != nullptr) {
+            pen_x += static_cast<float>(kerning(face_size, *previous, current));
+        }
+        if (current.width != 0) {
+            auto &vertices = geometry[current.page].GetVertices();
+            auto &indices = geometry[current.page].GetIndices();
+            auto const vertex_offset = vertices.size();
+            auto const index_offset = indices.size();
+            vertices.resize(vertex_offset + 4);
+            indices.resize(index_offset + 6);
+            Rml::GeometryUtilities::GenerateQuad(
+                &vertices[vertex_offset], &indices[index_offset],
+                Rml::Vector2f{std::round(pen_x + current.bearing_x), std::round(position.y + current.bearing_y)},
+                Rml::Vector2f{static_cast<float>(current.width), static_cast<float>(current.height)},
+                text_colour,
+                Rml::Vector2f{static_cast<float>(current.x) * PAGE_TEXEL, static_cast<float>(current.y) * PAGE_TEXEL},
+                Rml::Vector2f{static_cast<float>(current.x + current.width) * PAGE_TEXEL, static_cast<float>(current.y + current.height) * PAGE_TEXEL},
+                static_cast<int>(vertex_offset));
+        }
+        pen_x += static_cast<float>(current.advance);
+        previous = &current;
+    }
+    return static_cast<int>(pen_x - position.x);
+}
+
+auto FontEngineInterface_Cached::GetVersion(Rml::FontFaceHandle handle) -> int {
+    return handle != 0 ? reinterpret_cast<FaceSize *>(handle)->version : 0;
+}
+
+void FontEngineInterface_Cached::ReleaseFontResources() {
+    save();
+    face_sizes.clear();
+}
+
+// Has RmlUi regenerate the page's texture, as white texels with the glyph
+// coverage in alpha, the next time it is drawn.
+void FontEngineInterface_Cached::FaceSize::Page::refresh_texture() {
+    texture.Set("font-cache-page", [this](const Rml::String & /*name*/, Rml::UniquePtr<const Rml::byte[]> &data, Rml::Vector2i &dimensions) -> bool {
+        auto rgba = Rml::UniquePtr<Rml::byte[]>(new Rml::byte[alpha.size() * 4]);
+        for (size_t i = 0; i < alpha.size(); ++i) {
+            rgba[i * 4 + 0] = 255;
+            rgba[i * 4 + 1] = 255;
+            rgba[i * 4 + 2] = 255;
+            rgba[i * 4 + 3] = alpha[i];
+        }
+        data = std::move(rgba);
+        dimensions = {static_cast<int>(PAGE_SIZE), static_cast<int>(PAGE_SIZE)};
+        return true;
+    });
+    texture_stale = false;
+    texture_set = true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <RmlUi/Core/FontEngineInterface.h>
+#include <RmlUi/Core/StyleTypes.h>
+#include <RmlUi/Core/Types.h>
+
+#include <core/platform.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+struct FontCacheStats {
+    // Face sizes whose glyph pages came from the cache, and ones that had to
+    // be rasterised because there was no usable cache file.
+    uint32_t loaded_size_count{};
+    uint32_t baked_size_count{};
+    // Glyphs rasterised in this run, including ones added to loaded sizes.
+    uint32_t rasterised_glyph_count{};
+};
+
+// Font engine that rasterises glyphs with stb_truetype into alpha pages, and
+// keeps the pages and metrics of each face size in a cache file keyed by the
+// font's hash and the size. A warm start hands the stored pages straight to
+// the render interface without rasterising anything. A cold start bakes the
+// Latin-1 range up front, and any other glyph is added when it is first
+// used, then written out with the rest when the engine is destroyed.
+//
+// Glyphs missing from a face come from the fallback faces, in the order they
+// were loaded. Font effects (shadow, glow, outline) are not drawn.
+//
+// Faces loaded from memory are not copied, and RmlUi keeps using this after
+// Rml::Shutdown, so the engine and the font data must outlive it.
+class FontEngineInterface_Cached : public Rml::FontEngineInterface {
+  public:
+    explicit FontEngineInterface_Cached(std::filesystem::path a_directory);
+    ~FontEngineInterface_Cached() override;
+    FontEngineInterface_Cached(const FontEngineInterface_Cached &) = delete;
+    FontEngineInterface_Cached(FontEngineInterface_Cached &&) = delete;
+    auto operator=(const FontEngineInterface_Cached &) -> FontEngineInterface_Cached & = delete;
+    auto operator=(FontEngineInterface_Cached &&) -> FontEngineInterface_Cached & = delete;
+
+    // Writes the face sizes that gained glyphs since they were loaded.
+    void save();
+    auto stats() const -> FontCacheStats { return cache_stats; }
+
+    // -- Inherited from Rml::FontEngineInterface --
+    auto LoadFontFace(const Rml::String &file_name, bool fallback_face, Rml::Style::FontWeight weight) -> bool override;
+    auto LoadFontFace(const Rml::byte *data, int data_size, const Rml::String &family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) -> bool override;
+    auto GetFontFaceHandle(const Rml::String &family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, int size) -> Rml::FontFaceHandle override;
+    auto PrepareFontEffects(Rml::FontFaceHandle handle, const Rml::FontEffectList &font_effects) -> Rml::FontEffectsHandle override;
+    auto GetSize(Rml::FontFaceHandle handle) -> int override;
+    auto GetXHeight(Rml::FontFaceHandle handle) -> int override;
+    auto GetLineHeight(Rml::FontFaceHandle handle) -> int override;
+    auto GetBaseline(Rml::FontFaceHandle handle) -> int override;
+    auto GetUnderline(Rml::FontFaceHandle handle, float &thickness) -> float override;
+    auto GetStringWidth(Rml::FontFaceHandle handle, const Rml::String &string, Rml::Character prior_character) -> int override;
+    auto GenerateString(Rml::FontFaceHandle face_handle, Rml::FontEffectsHandle font_effects_handle, const Rml::String &string, const Rml::Vector2f &position, const Rml::Colourb &colour, float opacity, Rml::GeometryList &geometry) -> int override;
+    auto GetVersion(Rml::FontFaceHandle handle) -> int override;
+    void ReleaseFontResources() override;
+
+  private:
+    struct Face;
+    struct FaceSize;
+    struct Glyph;
+
+    std::filesystem::path const directory;
+    std::vector<std::unique_ptr<Face>> faces{};
+    std::vector<std::unique_ptr<FaceSize>> face_sizes{};
+    // Files loaded by name, which RmlUi doesn't keep alive for us.
+    std::vector<MappedFile> mapped_files{};
+    FontCacheStats cache_stats{};
+
+    auto add_face(Rml::byte const *data, size_t data_size, Rml::String family, Rml::Style::FontStyle style, Rml::Style::FontWeight weight, bool fallback_face) -> bool;
+    auto create_face_size(Face &face, int size) -> std::unique_ptr<FaceSize>;
+    auto load(FaceSize &face_size) -> bool;
+    void write(FaceSize const &face_size) const;
+    // Looks the glyph up, rasterising it into the size's pages first if it
+    // isn't there yet.
+    auto glyph(FaceSize &face_size, char32_t codepoint) -> Glyph const &;
+    auto kerning(FaceSize &face_size, Glyph const &left, Glyph const &right) -> int;
+    void bake(FaceSize &face_size, char32_t codepoint);
+};
@@ -12,6 +12,8 @@
 #include <utility>
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -25,15 +27,61 @@ static_assert(sizeof(Vertex) == sizeof(Rml::Vertex));
 
 DAXA_DECL_BUFFER_PTR(Vertex)
 
-struct Push {
-    daxa_f32mat4x4 projection;
+// Per-draw state that would otherwise break a batch. Indexed by the draw's
+// first instance, which the indirect draw commands set to the draw's index.
+struct DrawData {
     daxa_BufferPtr(Vertex) vbuffer_ptr;
-    daxa_BufferPtr(daxa_u32) ibuffer_ptr;
+    daxa_f32vec2 pos_offset;
     daxa_ImageViewId texture0_id;
+    // Maps the texture's UVs into its atlas rect (xy offset, zw scale), and
+    // the range they are clamped to so filtering stays inside the rect.
+    daxa_f32vec4 uv_rect;
+    daxa_f32vec4 uv_clamp;
+};
+DAXA_DECL_BUFFER_PTR(DrawData)
+
+struct Push {
+    daxa_f32mat4x4 projection;
+    daxa_BufferPtr(DrawData) draws_ptr;
     daxa_SamplerId sampler0_id;
-    daxa_f32vec2 pos_offset;
 };
 
+struct CompositePush {
+    daxa_ImageViewId layer_id;
+};
+
+namespace {
+    auto same_scissor(std::optional<daxa::Rect2D> const &a, std::optional<daxa::Rect2D> const &b) -> bool {
+        if (!a || !b) {
+            return !a && !b;
+        }
+        return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+    }
+
+    // FNV-1a, enough to tell one frame's draws from the next.
+    void hash_bytes(uint64_t &hash, void const *data, size_t size) {
+        auto const *bytes = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    }
+    template <typename T>
+    void hash_value(uint64_t &hash, T const &value) {
+        hash_bytes(hash, &value, sizeof(T));
+    }
+
+    constexpr auto SHADER_CACHE_DIRECTORY = "gvox-editor-cache/shaders";
+
+    auto shader_compile_options() -> daxa::ShaderCompileOptions {
+        return {
+            .root_paths = {
+                DAXA_SHADER_INCLUDE_DIR,
+            },
+            .language = daxa::ShaderLanguage::GLSL,
+        };
+    }
+} // namespace
+
 constexpr auto SHADER_COMMON = R"glsl(
 #include <daxa/daxa.inl>
 
@@ -44,13 +92,19 @@ struct Vertex {
 };
 DAXA_DECL_BUFFER_PTR(Vertex)
 
-struct Push {
-    daxa_f32mat4x4 projection;
+struct DrawData {
     daxa_BufferPtr(Vertex) vbuffer_ptr;
-    daxa_BufferPtr(daxa_u32) ibuffer_ptr;
+    daxa_f32vec2 pos_offset;
     daxa_ImageViewId texture0_id;
+    daxa_f32vec4 uv_rect;
+    daxa_f32vec4 uv_clamp;
+};
+DAXA_DECL_BUFFER_PTR(DrawData)
+
+struct Push {
+    daxa_f32mat4x4 projection;
+    daxa_BufferPtr(DrawData) draws_ptr;
     daxa_SamplerId sampler0_id;
-    daxa_f32vec2 pos_offset;
 };
 DAXA_DECL_PUSH_CONSTANT(Push, push)
 
@@ -62,29 +116,41 @@ daxa_f32vec4 linear_to_srgb(daxa_f32vec4 srgb) {
 }
 )glsl";
 
-RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device device, daxa::Format format) : device(std::move(device)) {
+constexpr auto COMPOSITE_SHADER_COMMON = R"glsl(
+#include <daxa/daxa.inl>
+
+struct CompositePush {
+    daxa_ImageViewId layer_id;
+};
+DAXA_DECL_PUSH_CONSTANT(CompositePush, push)
+)glsl";
+
+RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device a_device, daxa::Swapchain a_swapchain, ThreadPool &a_thread_pool, std::function<void()> a_on_texture_loaded)
+    : device(std::move(a_device)),
+      swapchain(std::move(a_swapchain)),
+      thread_pool(a_thread_pool),
+      on_texture_loaded(std::move(a_on_texture_loaded)),
+      staging_ring(device, size_t{1} << 20, "rml staging ring"),
+      shader_cache(device, SHADER_CACHE_DIRECTORY, shader_compile_options()) {
     pipeline_manager = daxa::PipelineManager({
         .device = this->device,
-        .shader_compile_options = {
-            .root_paths = {
-                DAXA_SHADER_INCLUDE_DIR,
-            },
-            .language = daxa::ShaderLanguage::GLSL,
-        },
+        .shader_compile_options = shader_compile_options(),
         .name = "pipeline_manager",
     });
-    auto compile_result = pipeline_manager.add_raster_pipeline(daxa::RasterPipelineCompileInfo{
+    auto compile_result = shader_cache.add_raster_pipeline(pipeline_manager, daxa::RasterPipelineCompileInfo{
         .vertex_shader_info = daxa::ShaderCompileInfo{
             .source = daxa::ShaderCode{std::string{SHADER_COMMON} + R"glsl(
                 layout(location = 0) out struct {
                     daxa_f32vec4 Color;
                     daxa_f32vec2 UV;
                 } Out;
+                layout(location = 2) flat out daxa_u32 out_draw_index;
 
                 void main() {
-                    Vertex vert = deref(push.vbuffer_ptr[gl_VertexIndex]);
+                    DrawData draw = deref(push.draws_ptr[gl_InstanceIndex]);
+                    Vertex vert = deref(draw.vbuffer_ptr[gl_VertexIndex]);
 
-                    daxa_f32vec2 aPos = vert.pos + push.pos_offset;
+                    daxa_f32vec2 aPos = vert.pos + draw.pos_offset;
                     daxa_f32vec2 aUV = vert.tex;
                     daxa_u32 aColor = vert.col;
 
@@ -93,7 +159,8 @@ RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device device, daxa::Format for
                     Out.Color.b = ((aColor >> 0x10) & 0xff) * 1.0 / 255.0;
                     Out.Color.a = ((aColor >> 0x18) & 0xff) * 1.0 / 255.0;
                     Out.Color = srgb_to_linear(Out.Color);
-                    Out.UV = aUV;
+                    Out.UV = aUV * draw.uv_rect.zw + draw.uv_rect.xy;
+                    out_draw_index = gl_InstanceIndex;
 
                     gl_Position = push.projection * vec4(aPos, 0, 1);
                     gl_Position.z += 0.5;
@@ -111,8 +178,11 @@ RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device device, daxa::Format for
                     daxa_f32vec4 Color;
                     daxa_f32vec2 UV;
                 } In;
+                layout(location = 2) flat in daxa_u32 in_draw_index;
                 void main() {
-                    vec4 tex_color = texture(daxa_sampler2D(push.texture0_id, push.sampler0_id), In.UV.st).rgba;
+                    DrawData draw = deref(push.draws_ptr[in_draw_index]);
+                    vec2 uv = clamp(In.UV.st, draw.uv_clamp.xy, draw.uv_clamp.zw);
+                    vec4 tex_color = texture(daxa_sampler2D(draw.texture0_id, push.sampler0_id), uv).rgba;
                     fColor = linear_to_srgb(In.Color.rgba * tex_color);
                 }
             )glsl"},
@@ -122,10 +192,14 @@ RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device device, daxa::Format for
             },
         },
         .color_attachments = {{
-            .format = format,
+            .format = swapchain.get_format(),
+            // The layer starts out transparent, so this leaves it holding
+            // premultiplied color for the composite.
             .blend = daxa::BlendInfo{
                 .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA,
                 .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA,
+                .src_alpha_blend_factor = daxa::BlendFactor::ONE,
+                .dst_alpha_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA,
             },
         }},
         .raster = {},
@@ -137,295 +211,628 @@ RenderInterface_Daxa::RenderInterface_Daxa(daxa::Device device, daxa::Format for
 
     raster_pipeline = compile_result.value();
 
-    recreate_vbuffer(4096);
-    recreate_ibuffer(4096);
+    auto composite_result = shader_cache.add_raster_pipeline(pipeline_manager, daxa::RasterPipelineCompileInfo{
+        .vertex_shader_info = daxa::ShaderCompileInfo{
+            .source = daxa::ShaderCode{std::string{COMPOSITE_SHADER_COMMON} + R"glsl(
+                void main() {
+                    daxa_f32vec2 uv = daxa_f32vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+                    gl_Position = daxa_f32vec4(uv * 2.0 - 1.0, 0.5, 1.0);
+                }
+            )glsl"},
+            .compile_options = {
+                .language = daxa::ShaderLanguage::GLSL,
+            },
+        },
+        .fragment_shader_info = daxa::ShaderCompileInfo{
+            .source = daxa::ShaderCode{std::string{COMPOSITE_SHADER_COMMON} + R"glsl(
+                layout(location = 0) out daxa_f32vec4 fColor;
+                void main() {
+                    fColor = texelFetch(daxa_texture2D(push.layer_id), daxa_i32vec2(gl_FragCoord.xy), 0);
+                }
+            )glsl"},
+            .compile_options = daxa::ShaderCompileOptions{
+                .language = daxa::ShaderLanguage::GLSL,
+            },
+        },
+        .color_attachments = {{
+            .format = swapchain.get_format(),
+            .blend = daxa::BlendInfo{
+                .src_color_blend_factor = daxa::BlendFactor::ONE,
+                .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA,
+                .src_alpha_blend_factor = daxa::BlendFactor::ONE,
+                .dst_alpha_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA,
+            },
+        }},
+        .raster = {},
+        .push_constant_size = sizeof(CompositePush),
+        .name = "rml_composite_pipeline",
+    });
+
+    assert(composite_result.is_ok());
+
+    composite_pipeline = composite_result.value();
+
+    create_arena(vertex_arena, draw_list.vertex_ranges, sizeof(Vertex), 16384, "rml vertex arena");
+    create_arena(index_arena, draw_list.index_ranges, sizeof(int), 32768, "rml index arena");
 
     this->default_sampler = this->device.create_sampler({.name = "rml default sampler"});
 
+    // Set once up front, the flag is global and decoding runs on the pool.
+    stbi_set_flip_vertically_on_load(0);
+
     auto source_bytes = 0xffffffff;
-    GenerateTexture(*reinterpret_cast<Rml::TextureHandle *>(&default_texture), reinterpret_cast<Rml::byte *>(&source_bytes), {1, 1});
+    GenerateTexture(default_texture, reinterpret_cast<Rml::byte *>(&source_bytes), {1, 1});
 }
 
 RenderInterface_Daxa::~RenderInterface_Daxa() {
+    thread_pool.wait(texture_load_tasks);
     device.wait_idle();
     device.collect_garbage();
-    device.destroy_image(default_texture);
+    textures.for_each([&](Texture const &texture) {
+        if (texture.pending_load_id == 0 && !texture.atlas_page) {
+            device.destroy_image(texture.image);
+        }
+    });
+    for (auto const &page : atlas_pages) {
+        if (!page.image.is_empty()) {
+            device.destroy_image(page.image);
+        }
+    }
     device.destroy_sampler(default_sampler);
-    device.destroy_buffer(vbuffer);
-    device.destroy_buffer(ibuffer);
+    if (!layer_image.is_empty()) {
+        device.destroy_image(layer_image);
+    }
+    for (auto *arena : {&vertex_arena, &index_arena}) {
+        device.destroy_buffer(arena->buffer);
+        if (!arena->migrate_from.is_empty()) {
+            device.destroy_buffer(arena->migrate_from);
+        }
+    }
 }
 
-void RenderInterface_Daxa::recreate_vbuffer(size_t vbuffer_new_size) {
-    vbuffer = device.create_buffer({
-        .size = static_cast<uint32_t>(vbuffer_new_size),
-        .name = std::string("rml vertex buffer"),
+void RenderInterface_Daxa::create_arena(GeometryArena &arena, RangeAllocator &allocator, size_t element_size, uint32_t capacity, char const *name) {
+    arena.element_size = element_size;
+    arena.name = name;
+    arena.allocator = &allocator;
+    allocator = RangeAllocator{capacity};
+    arena.buffer = device.create_buffer({
+        .size = static_cast<uint32_t>(element_size * capacity),
+        .name = std::string(name),
     });
+    ++arena_allocation_count;
 }
 
-void RenderInterface_Daxa::recreate_ibuffer(size_t ibuffer_new_size) {
-    ibuffer = device.create_buffer({
-        .size = static_cast<uint32_t>(ibuffer_new_size),
-        .name = std::string("rml index buffer"),
+auto RenderInterface_Daxa::arena_allocate(GeometryArena &arena, void const *data, uint32_t count) -> uint32_t {
+    auto offset = arena.allocator->allocate(count);
+    if (!offset) {
+        auto const old_capacity = arena.allocator->capacity();
+        auto const new_capacity = std::max(old_capacity * 2, old_capacity + count);
+        auto new_buffer = device.create_buffer({
+            .size = static_cast<uint32_t>(arena.element_size * new_capacity),
+            .name = std::string(arena.name),
+        });
+        ++arena_allocation_count;
+        if (arena.migrate_from.is_empty()) {
+            arena.migrate_from = arena.buffer;
+            arena.migrate_size = arena.element_size * old_capacity;
+        } else {
+            // Already grown this frame, so no command has used this buffer yet.
+            device.destroy_buffer(arena.buffer);
+        }
+        arena.buffer = new_buffer;
+        arena.allocator->grow(new_capacity);
+        offset = arena.allocator->allocate(count);
+    }
+    auto const byte_count = arena.element_size * count;
+    auto const staging = staging_ring.allocate(byte_count);
+    std::memcpy(staging.host_address, data, byte_count);
+    geometry_uploads.push_back({
+        .arena = &arena,
+        .staging = staging,
+        .dst_offset = arena.element_size * *offset,
+        .size = byte_count,
     });
+    return *offset;
+}
+
+void RenderInterface_Daxa::record_geometry_uploads(daxa::CommandRecorder &recorder) {
+    auto migrated = false;
+    for (auto *arena : {&vertex_arena, &index_arena}) {
+        if (!arena->migrate_from.is_empty()) {
+            recorder.copy_buffer_to_buffer({
+                .src_buffer = arena->migrate_from,
+                .dst_buffer = arena->buffer,
+                .size = arena->migrate_size,
+            });
+            recorder.destroy_buffer_deferred(arena->migrate_from);
+            arena->migrate_from = {};
+            migrated = true;
+        }
+    }
+    if (geometry_uploads.empty()) {
+        return;
+    }
+    if (migrated) {
+        // The uploads may land in the free space the migration just copied.
+        recorder.pipeline_barrier({
+            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .dst_access = daxa::AccessConsts::TRANSFER_WRITE,
+        });
+    }
+    for (auto const &upload : geometry_uploads) {
+        recorder.copy_buffer_to_buffer({
+            .src_buffer = upload.staging.buffer,
+            .dst_buffer = upload.arena->buffer,
+            .src_offset = upload.staging.offset,
+            .dst_offset = upload.dst_offset,
+            .size = upload.size,
+        });
+    }
+    geometry_uploads.clear();
 }
 
 void RenderInterface_Daxa::begin_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder) {
     using namespace std::literals;
+    auto const allocation_scope = AllocationScope{draw_list.frame_allocation_count};
 
     auto target_image_extent = device.info_image(target_image).value().size;
 
     projection = Rml::Matrix4f::ProjectOrtho(0, (float)target_image_extent.x, 0, (float)target_image_extent.y, -10000, 10000);
     SetTransform(nullptr);
-    bound_texture = std::bit_cast<Rml::TextureHandle>(default_texture);
-}
+    bound_texture = default_texture;
+    frame_signature = 0xcbf29ce484222325;
 
-void RenderInterface_Daxa::end_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder) {
-    auto vbuffer_current_size = device.info_buffer(vbuffer).value().size;
-    auto vbuffer_needed_size = vertex_cache.size() * sizeof(Vertex);
-    auto ibuffer_current_size = device.info_buffer(ibuffer).value().size;
-    auto ibuffer_needed_size = index_cache.size() * sizeof(int);
+    if (layer_image.is_empty() || layer_width != target_image_extent.x || layer_height != target_image_extent.y) {
+        if (!layer_image.is_empty()) {
+            recorder.destroy_image_deferred(layer_image);
+        }
+        layer_width = target_image_extent.x;
+        layer_height = target_image_extent.y;
+        layer_image = device.create_image({
+            .format = swapchain.get_format(),
+            .size = {layer_width, layer_height, 1},
+            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_SAMPLED,
+            .name = "rml layer",
+        });
+        layer_signature.reset();
+    }
 
-    if (!this->image_uploads.empty()) {
-        auto const upload_size = image_upload_data.size() * sizeof(uint8_t);
+    reclaim_completed_frames();
+    finish_texture_loads();
+}
 
-        auto texture_staging_buffer = this->device.create_buffer({
-            .size = static_cast<uint32_t>(upload_size),
-            .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-        });
-        recorder.destroy_buffer_deferred(texture_staging_buffer);
-
-        auto *staging_buffer_data = this->device.get_host_address_as<Rml::byte>(texture_staging_buffer).value();
-        std::memcpy(staging_buffer_data, image_upload_data.data(), upload_size);
-
-        for (auto const &image_upload : image_uploads) {
-            recorder.pipeline_barrier_image_transition({
-                .src_access = daxa::AccessConsts::HOST_WRITE,
-                .dst_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
-                .dst_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-                .image_slice = {
-                    .base_mip_level = 0,
-                    .level_count = 1,
-                    .base_array_layer = 0,
-                    .layer_count = 1,
-                },
-                .image_id = image_upload.image_id,
-            });
-        }
-        for (auto const &image_upload : image_uploads) {
-            recorder.copy_buffer_to_image({
-                .buffer = texture_staging_buffer,
-                .buffer_offset = image_upload.data,
-                .image = image_upload.image_id,
-                .image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-                .image_slice = {
-                    .mip_level = 0,
-                    .base_array_layer = 0,
-                    .layer_count = 1,
-                },
-                .image_offset = {0, 0, 0},
-                .image_extent = {static_cast<uint32_t>(image_upload.size.x), static_cast<uint32_t>(image_upload.size.y), 1},
-            });
-        }
-        for (auto const &image_upload : image_uploads) {
-            recorder.pipeline_barrier_image_transition({
-                .src_access = daxa::AccessConsts::TRANSFER_WRITE,
-                .dst_access = daxa::AccessConsts::FRAGMENT_SHADER_READ,
-                .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
-                .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
-                .image_slice = {
-                    .base_mip_level = 0,
-                    .level_count = 1,
-                    .base_array_layer = 0,
-                    .layer_count = 1,
-                },
-                .image_id = image_upload.image_id,
-            });
-        }
+auto RenderInterface_Daxa::composite_cached_layer(daxa::ImageId target_image, daxa::CommandRecorder &recorder) -> bool {
+    auto const target_image_extent = device.info_image(target_image).value().size;
+    if (!layer_signature || layer_width != target_image_extent.x || layer_height != target_image_extent.y || !image_uploads.empty() || !geometry_uploads.empty()) {
+        return false;
     }
+    reclaim_completed_frames();
+    record_composite(target_image, recorder);
+    ++composited_frame_count;
+    return true;
+}
+
+auto RenderInterface_Daxa::has_finished_texture_loads() -> bool {
+    auto lock = std::lock_guard{finished_texture_loads_mutex};
+    return !finished_texture_loads.empty();
+}
+
+void RenderInterface_Daxa::reclaim_completed_frames() {
+    auto const completed_timeline_value = swapchain.gpu_timeline_semaphore().value();
+    staging_ring.reclaim(completed_timeline_value);
+    draw_list.reclaim(completed_timeline_value);
+    reclaim_retired_atlas_entries(completed_timeline_value);
+}
 
-    if (vbuffer_needed_size > vbuffer_current_size) {
-        auto vbuffer_new_size = vbuffer_needed_size + 4096;
-        device.destroy_buffer(vbuffer);
-        recreate_vbuffer(vbuffer_new_size);
+void RenderInterface_Daxa::end_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder) {
+    auto const steady_frame = draw_list.is_steady(!image_uploads.empty() || !geometry_uploads.empty());
+    {
+        auto const allocation_scope = AllocationScope{draw_list.frame_allocation_count};
+        record_frame(target_image, recorder);
     }
-    if (ibuffer_needed_size > ibuffer_current_size) {
-        auto ibuffer_new_size = ibuffer_needed_size + 4096;
-        device.destroy_buffer(ibuffer);
-        recreate_ibuffer(ibuffer_new_size);
+    last_frame_stats.heap_allocation_count = draw_list.end_frame();
+    if (ALLOCATION_COUNTING_ENABLED && steady_frame && last_frame_stats.heap_allocation_count != 0) {
+        std::cerr << "RmlUi render interface made " << last_frame_stats.heap_allocation_count << " heap allocations in a steady-state frame" << std::endl;
     }
+}
 
-    auto staging_vbuffer = device.create_buffer({
-        .size = static_cast<uint32_t>(vbuffer_needed_size),
-        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-        .name = std::string("rml vertex staging buffer"),
-    });
-    auto *vtx_dst = device.get_host_address_as<Rml::Vertex>(staging_vbuffer).value();
-    std::copy(vertex_cache.begin(), vertex_cache.end(), vtx_dst);
-    recorder.destroy_buffer_deferred(staging_vbuffer);
-    auto staging_ibuffer = device.create_buffer({
-        .size = static_cast<uint32_t>(ibuffer_needed_size),
-        .allocate_info = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-        .name = std::string("rml index staging buffer"),
-    });
-    auto *idx_dst = device.get_host_address_as<int>(staging_ibuffer).value();
-    std::copy(index_cache.begin(), index_cache.end(), idx_dst);
-    recorder.destroy_buffer_deferred(staging_ibuffer);
+void RenderInterface_Daxa::record_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder) {
+    // Uploads always go out, the staging memory they read from is only
+    // valid for this frame. Any of them may change what a cached draw shows.
+    auto const layer_current = layer_signature == frame_signature && image_uploads.empty() && geometry_uploads.empty();
+    if (layer_current) {
+        last_frame_stats = {.draw_count = static_cast<uint32_t>(draw_list.calls().size())};
+    } else {
+        build_batches();
+    }
+
+    // Everything this frame reads from the staging ring was written by the
+    // host: uploads, and the streamed geometry, draw data and indirect
+    // commands that are read straight from it.
     recorder.pipeline_barrier({
         .src_access = daxa::AccessConsts::HOST_WRITE,
-        .dst_access = daxa::AccessConsts::TRANSFER_READ,
-    });
-    recorder.copy_buffer_to_buffer({
-        .src_buffer = staging_ibuffer,
-        .dst_buffer = ibuffer,
-        .size = ibuffer_needed_size,
-    });
-    recorder.copy_buffer_to_buffer({
-        .src_buffer = staging_vbuffer,
-        .dst_buffer = vbuffer,
-        .size = vbuffer_needed_size,
-    });
-    recorder.pipeline_barrier({
-        .src_access = daxa::AccessConsts::TRANSFER_WRITE,
-        .dst_access = daxa::AccessConsts::VERTEX_SHADER_READ | daxa::AccessConsts::INDEX_INPUT_READ,
+        .dst_access = daxa::AccessConsts::TRANSFER_READ | daxa::AccessConsts::INDIRECT_COMMAND_READ | daxa::AccessConsts::VERTEX_SHADER_READ | daxa::AccessConsts::INDEX_INPUT_READ | daxa::AccessConsts::FRAGMENT_SHADER_READ,
     });
 
-    auto target_image_extent = device.info_image(target_image).value().size;
+    record_image_uploads(recorder);
+    record_geometry_uploads(recorder);
+
+    if (!layer_current) {
+        recorder.pipeline_barrier({
+            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .dst_access = daxa::AccessConsts::VERTEX_SHADER_READ | daxa::AccessConsts::INDEX_INPUT_READ,
+        });
+        record_layer(recorder);
+        layer_signature = frame_signature;
+        ++layer_redraw_count;
+    }
+    record_composite(target_image, recorder);
+    ++composited_frame_count;
+
+    scissor_enabled = false;
+
+    staging_ring.end_frame(swapchain.current_cpu_timeline_value());
+}
+
+void RenderInterface_Daxa::record_layer(daxa::CommandRecorder &recorder) {
+    auto const full_slice = daxa::ImageMipArraySlice{
+        .base_mip_level = 0,
+        .level_count = 1,
+        .base_array_layer = 0,
+        .layer_count = 1,
+    };
+    // Cleared below, so the previous contents can go.
+    recorder.pipeline_barrier_image_transition({
+        .src_access = daxa::AccessConsts::FRAGMENT_SHADER_READ,
+        .dst_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_READ_WRITE,
+        .src_layout = daxa::ImageLayout::UNDEFINED,
+        .dst_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+        .image_slice = full_slice,
+        .image_id = layer_image,
+    });
 
-    auto default_scissor = daxa::Rect2D{.x = 0, .y = 0, .width = target_image_extent.x, .height = target_image_extent.y};
+    auto default_scissor = daxa::Rect2D{.x = 0, .y = 0, .width = layer_width, .height = layer_height};
 
     auto render_recorder = std::move(recorder).begin_renderpass({
-        .color_attachments = std::array{daxa::RenderAttachmentInfo{.image_view = target_image.default_view(), .load_op = daxa::AttachmentLoadOp::LOAD}},
+        .color_attachments = std::array{daxa::RenderAttachmentInfo{
+            .image_view = layer_image.default_view(),
+            .load_op = daxa::AttachmentLoadOp::CLEAR,
+            .clear_value = std::array<daxa::f32, 4>{0.0f, 0.0f, 0.0f, 0.0f},
+        }},
         .render_area = default_scissor,
     });
 
     render_recorder.set_pipeline(*raster_pipeline);
-    render_recorder.set_index_buffer({
-        .id = ibuffer,
-        .offset = 0,
-        .index_type = daxa::IndexType::uint32,
-    });
-
-    auto push = Push{};
-    push.vbuffer_ptr = device.get_device_address(vbuffer).value();
-    push.ibuffer_ptr = device.get_device_address(ibuffer).value();
 
-    for (auto const &draw_handle : draw_order) {
-        auto const &draw = draws[draw_handle - 1];
-        if (draw.indices.empty()) {
-            continue;
-        }
-        push.projection = *reinterpret_cast<daxa_f32mat4x4 const *>(&draw.transform);
-        push.pos_offset = {draw.translation.x, draw.translation.y};
-        auto texture_image = draw.actual_image;
-        push.texture0_id = texture_image.default_view();
-        push.sampler0_id = default_sampler;
-        if (draw.scissor) {
-            render_recorder.set_scissor(*draw.scissor);
-        } else {
-            render_recorder.set_scissor(default_scissor);
+    auto bound_index_buffer = daxa::BufferId{};
+    for (auto const &batch : draw_list.batches()) {
+        if (batch.key.index_buffer != bound_index_buffer) {
+            render_recorder.set_index_buffer({
+                .id = batch.key.index_buffer,
+                .offset = 0,
+                .index_type = daxa::IndexType::uint32,
+            });
+            bound_index_buffer = batch.key.index_buffer;
         }
-        assert(device.is_id_valid(texture_image));
-        assert(device.is_id_valid(std::bit_cast<daxa::ImageViewId>(push.texture0_id)));
-        assert(device.is_id_valid(std::bit_cast<daxa::SamplerId>(push.sampler0_id)));
-        render_recorder.push_constant(push);
-        render_recorder.draw_indexed({
-            .index_count = static_cast<uint32_t>(draw.indices.size()),
-            .first_index = static_cast<uint32_t>(draw.index_offset),
-            .vertex_offset = static_cast<int32_t>(draw.vertex_offset),
+        render_recorder.set_scissor(batch.key.scissor.value_or(default_scissor));
+        render_recorder.push_constant(Push{
+            .projection = *reinterpret_cast<daxa_f32mat4x4 const *>(&batch.key.transform),
+            .draws_ptr = draw_data_staging.device_address,
+            .sampler0_id = default_sampler,
+        });
+        render_recorder.draw_indirect({
+            .draw_command_info_buffer_id = draw_command_staging.buffer,
+            .draw_command_info_buffer_offset = draw_command_staging.offset + batch.first_call * sizeof(daxa::DrawIndexedIndirectStruct),
+            .draw_count = batch.call_count,
+            .draw_command_stride = sizeof(daxa::DrawIndexedIndirectStruct),
+            .is_indexed = true,
         });
     }
 
     recorder = std::move(render_recorder).end_renderpass();
 
-    image_uploads.clear();
-    image_upload_data.clear();
-    draw_order.clear();
+    recorder.pipeline_barrier_image_transition({
+        .src_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+        .dst_access = daxa::AccessConsts::FRAGMENT_SHADER_READ,
+        .src_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+        .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+        .image_slice = full_slice,
+        .image_id = layer_image,
+    });
+}
 
-    vertex_cache_offset = 0;
-    index_cache_offset = 0;
-    scissor_enabled = false;
+void RenderInterface_Daxa::record_composite(daxa::ImageId target_image, daxa::CommandRecorder &recorder) {
+    auto render_recorder = std::move(recorder).begin_renderpass({
+        .color_attachments = std::array{daxa::RenderAttachmentInfo{.image_view = target_image.default_view(), .load_op = daxa::AttachmentLoadOp::LOAD}},
+        .render_area = {.x = 0, .y = 0, .width = layer_width, .height = layer_height},
+    });
+    render_recorder.set_pipeline(*composite_pipeline);
+    render_recorder.push_constant(CompositePush{.layer_id = layer_image.default_view()});
+    render_recorder.draw({.vertex_count = 3});
+    recorder = std::move(render_recorder).end_renderpass();
+}
+
+auto RenderInterface_Daxa::BatchKey::operator==(BatchKey const &other) const -> bool {
+    return index_buffer == other.index_buffer && transform == other.transform && same_scissor(scissor, other.scissor);
+}
 
-    for (auto handle : deferred_draw_releases) {
-        ReleaseCompiledGeometry(handle);
+void RenderInterface_Daxa::build_batches() {
+    auto const draw_calls = draw_list.calls();
+    last_frame_stats = {.draw_count = static_cast<uint32_t>(draw_calls.size())};
+    if (draw_calls.empty()) {
+        return;
+    }
+    draw_data_staging = staging_ring.allocate(draw_calls.size() * sizeof(DrawData));
+    draw_command_staging = staging_ring.allocate(draw_calls.size() * sizeof(daxa::DrawIndexedIndirectStruct));
+    auto *draw_data = reinterpret_cast<DrawData *>(draw_data_staging.host_address);
+    auto *draw_commands = reinterpret_cast<daxa::DrawIndexedIndirectStruct *>(draw_command_staging.host_address);
+    auto const arena_vertex_address = device.get_device_address(vertex_arena.buffer).value();
+    constexpr auto ATLAS_TEXEL = 1.0f / static_cast<float>(ATLAS_PAGE_SIZE);
+
+    for (uint32_t draw_index = 0; draw_index < draw_calls.size(); ++draw_index) {
+        auto const &draw_call = draw_calls[draw_index];
+        auto const &texture = draw_call.actual_texture;
+        assert(device.is_id_valid(texture.image));
+        auto uv_rect = daxa_f32vec4{0.0f, 0.0f, 1.0f, 1.0f};
+        auto uv_clamp = daxa_f32vec4{0.0f, 0.0f, 1.0f, 1.0f};
+        if (texture.atlas_page) {
+            auto const x = static_cast<float>(texture.rect.x);
+            auto const y = static_cast<float>(texture.rect.y);
+            auto const w = static_cast<float>(texture.rect.width);
+            auto const h = static_cast<float>(texture.rect.height);
+            uv_rect = {x * ATLAS_TEXEL, y * ATLAS_TEXEL, w * ATLAS_TEXEL, h * ATLAS_TEXEL};
+            uv_clamp = {(x + 0.5f) * ATLAS_TEXEL, (y + 0.5f) * ATLAS_TEXEL, (x + w - 0.5f) * ATLAS_TEXEL, (y + h - 0.5f) * ATLAS_TEXEL};
+        }
+        draw_data[draw_index] = DrawData{
+            .vbuffer_ptr = draw_call.streamed ? draw_call.stream_vertices.device_address : arena_vertex_address,
+            .pos_offset = {draw_call.translation.x, draw_call.translation.y},
+            .texture0_id = texture.image.default_view(),
+            .uv_rect = uv_rect,
+            .uv_clamp = uv_clamp,
+        };
+        draw_commands[draw_index] = daxa::DrawIndexedIndirectStruct{
+            .index_count = draw_call.index_count,
+            .instance_count = 1,
+            .first_index = draw_call.streamed ? static_cast<uint32_t>(draw_call.stream_indices.offset / sizeof(int)) : draw_call.index_offset,
+            .vertex_offset = draw_call.streamed ? 0 : static_cast<int32_t>(draw_call.vertex_offset),
+            .first_instance = draw_index,
+        };
     }
-    deferred_draw_releases.clear();
+
+    // Texture, translation and vertex source are per draw, so only the
+    // index buffer, transform and scissor can split a batch.
+    auto const batches = draw_list.build_batches([&](DrawCall const &draw_call) {
+        return BatchKey{
+            .index_buffer = draw_call.streamed ? draw_call.stream_indices.buffer : index_arena.buffer,
+            .transform = draw_call.transform,
+            .scissor = draw_call.scissor,
+        };
+    });
+    last_frame_stats.batch_count = static_cast<uint32_t>(batches.size());
 }
 
 void RenderInterface_Daxa::RenderGeometry(Rml::Vertex *vertices, int num_vertices, int *indices, int num_indices, const Rml::TextureHandle texture, const Rml::Vector2f &translation) {
-    if (vertices == nullptr) {
+    auto const allocation_scope = AllocationScope{draw_list.frame_allocation_count};
+    if (vertices == nullptr || num_indices == 0) {
         return;
     }
 
-    auto geometry = CompileGeometry(vertices, num_vertices, indices, num_indices, texture);
-    if (geometry != 0) {
-        RenderCompiledGeometry(geometry, translation);
-        deferred_draw_releases.push_back(geometry);
-    }
+    // Drawn straight from the staging ring, so this is the only copy.
+    auto const vertex_bytes = static_cast<size_t>(num_vertices) * sizeof(Vertex);
+    auto const index_bytes = static_cast<size_t>(num_indices) * sizeof(int);
+    auto const stream_vertices = staging_ring.allocate(vertex_bytes);
+    auto const stream_indices = staging_ring.allocate(index_bytes);
+    std::memcpy(stream_vertices.host_address, vertices, vertex_bytes);
+    std::memcpy(stream_indices.host_address, indices, index_bytes);
+    hash_bytes(frame_signature, vertices, vertex_bytes);
+    hash_bytes(frame_signature, indices, index_bytes);
+    push_draw_call(
+        DrawCall{
+            .streamed = true,
+            .stream_vertices = stream_vertices,
+            .stream_indices = stream_indices,
+            .index_count = static_cast<uint32_t>(num_indices),
+            .translation = translation,
+        },
+        texture);
 }
 
 auto RenderInterface_Daxa::CompileGeometry(Rml::Vertex *vertices, int num_vertices, int *indices, int num_indices, const Rml::TextureHandle texture) -> Rml::CompiledGeometryHandle {
-    if (vertices == nullptr) {
+    if (vertices == nullptr || num_vertices == 0 || num_indices == 0) {
         return {};
     }
 
-    auto draw = Draw{
-        .vertices = std::vector<Rml::Vertex>(vertices, vertices + num_vertices),
-        .indices = std::vector<int>(indices, indices + num_indices),
+    // Uploaded once here, then drawn from the arenas until released.
+    auto const vertex_count = static_cast<uint32_t>(num_vertices);
+    auto const index_count = static_cast<uint32_t>(num_indices);
+    auto draw = UiCompiledDraw{
+        .vertex_offset = arena_allocate(vertex_arena, vertices, vertex_count),
+        .vertex_count = vertex_count,
+        .index_offset = arena_allocate(index_arena, indices, index_count),
+        .index_count = index_count,
         .texture = texture,
     };
 
-    size_t draw_id = 0;
-    if (draw_free_list.empty()) {
-        draw_id = draws.size() + 1;
-        draws.emplace_back(draw);
-    } else {
-        draw_id = draw_free_list.top();
-        draw_free_list.pop();
-        draws.at(draw_id - 1) = draw;
-    }
-
-    return draw_id;
+    return draw_list.add_compiled(draw);
 }
 
 void RenderInterface_Daxa::RenderCompiledGeometry(Rml::CompiledGeometryHandle handle, const Rml::Vector2f &translation) {
-    auto &draw = draws.at(handle - 1);
-    draw.translation = translation;
-    auto num_vertices = draw.vertices.size();
-    draw.vertex_offset = vertex_cache_offset;
-    auto necessary_size = draw.vertex_offset + num_vertices;
-    if (vertex_cache.size() < necessary_size) {
-        vertex_cache.resize(necessary_size);
-    }
-    std::copy(draw.vertices.begin(), draw.vertices.end(), vertex_cache.begin() + draw.vertex_offset);
-    auto num_indices = draw.indices.size();
-    draw.index_offset = index_cache_offset;
-    auto index_necessary_size = draw.index_offset + num_indices;
-    if (index_cache.size() < index_necessary_size) {
-        index_cache.resize(index_necessary_size);
-    }
-    std::copy(draw.indices.begin(), draw.indices.end(), index_cache.begin() + draw.index_offset);
-    draw.transform = transform;
-    if (scissor_enabled) {
-        draw.scissor = current_scissor;
+    auto const allocation_scope = AllocationScope{draw_list.frame_allocation_count};
+    auto const &draw = draw_list.compiled(handle);
+    push_draw_call(
+        DrawCall{
+            .vertex_offset = draw.vertex_offset,
+            .index_offset = draw.index_offset,
+            .index_count = draw.index_count,
+            .translation = translation,
+        },
+        draw.texture);
+}
+
+void RenderInterface_Daxa::ReleaseCompiledGeometry(Rml::CompiledGeometryHandle handle) {
+    // The ranges stay reserved until frames that may draw them are done.
+    draw_list.release_compiled(handle, swapchain.current_cpu_timeline_value());
+}
+
+auto RenderInterface_Daxa::resolve_texture(Rml::TextureHandle texture) -> Texture {
+    if (texture == 0) {
+        return textures[default_texture];
+    }
+    if (texture != static_cast<Rml::TextureHandle>(-1)) {
+        bound_texture = texture;
     }
+    return textures[bound_texture];
+}
 
-    if (draw.texture == 0) {
-        draw.actual_image = default_texture;
-    } else {
-        if (draw.texture != -1) {
-            bound_texture = draw.texture;
+auto RenderInterface_Daxa::allocate_atlas_entry(uint32_t width, uint32_t height) -> std::optional<Texture> {
+    auto empty_page = std::optional<uint32_t>{};
+    for (uint32_t page_index = 0; page_index < atlas_pages.size(); ++page_index) {
+        auto &page = atlas_pages[page_index];
+        if (page.image.is_empty()) {
+            empty_page = page_index;
+            continue;
+        }
+        if (auto rect = page.allocator.allocate(width, height)) {
+            ++page.entry_count;
+            return Texture{.image = page.image, .atlas_page = page_index, .rect = *rect};
+        }
+    }
+    auto const page_index = empty_page.value_or(static_cast<uint32_t>(atlas_pages.size()));
+    if (page_index == atlas_pages.size()) {
+        atlas_pages.emplace_back();
+    }
+    auto &page = atlas_pages[page_index];
+    page = AtlasPage{
+        .image = device.create_image({
+            .format = daxa::Format::R8G8B8A8_SRGB,
+            .size = {ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 1},
+            .usage = daxa::ImageUsageFlagBits::TRANSFER_DST | daxa::ImageUsageFlagBits::SHADER_SAMPLED,
+            .name = "rml atlas page",
+        }),
+        .allocator = AtlasAllocator{ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE},
+    };
+    auto rect = page.allocator.allocate(width, height);
+    if (!rect) {
+        return std::nullopt;
+    }
+    ++page.entry_count;
+    return Texture{.image = page.image, .atlas_page = page_index, .rect = *rect};
+}
+
+void RenderInterface_Daxa::reclaim_retired_atlas_entries(uint64_t completed_timeline_value) {
+    std::erase_if(retired_atlas_entries, [&](RetiredAtlasEntry const &entry) {
+        if (entry.timeline_value > completed_timeline_value) {
+            return false;
+        }
+        auto &page = atlas_pages[entry.atlas_page];
+        page.allocator.free(entry.rect);
+        // The first page stays, it is about to be needed again anyway.
+        if (--page.entry_count == 0 && entry.atlas_page != 0) {
+            device.destroy_image(page.image);
+            page = {};
+        }
+        return true;
+    });
+}
+
+void RenderInterface_Daxa::record_image_uploads(daxa::CommandRecorder &recorder) {
+    if (image_uploads.empty()) {
+        return;
+    }
+    // Atlas pages take many uploads per frame, so each image is transitioned
+    // once around all of its copies.
+    upload_images.clear();
+    for (auto const &image_upload : image_uploads) {
+        auto const already_listed = std::any_of(upload_images.begin(), upload_images.end(), [&](auto const &entry) { return entry.first == image_upload.image_id; });
+        if (!already_listed) {
+            upload_images.emplace_back(image_upload.image_id, image_upload.atlas_page);
+        }
+    }
+    auto const full_slice = daxa::ImageMipArraySlice{
+        .base_mip_level = 0,
+        .level_count = 1,
+        .base_array_layer = 0,
+        .layer_count = 1,
+    };
+    for (auto const &[image_id, atlas_page] : upload_images) {
+        auto const keep_contents = atlas_page && atlas_pages[*atlas_page].initialized;
+        recorder.pipeline_barrier_image_transition({
+            .src_access = daxa::AccessConsts::HOST_WRITE | daxa::AccessConsts::FRAGMENT_SHADER_READ,
+            .dst_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+            .src_layout = keep_contents ? daxa::ImageLayout::READ_ONLY_OPTIMAL : daxa::ImageLayout::UNDEFINED,
+            .dst_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .image_slice = full_slice,
+            .image_id = image_id,
+        });
+    }
+    for (auto const &image_upload : image_uploads) {
+        recorder.copy_buffer_to_image({
+            .buffer = image_upload.staging.buffer,
+            .buffer_offset = image_upload.staging.offset,
+            .image = image_upload.image_id,
+            .image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .image_slice = {
+                .mip_level = 0,
+                .base_array_layer = 0,
+                .layer_count = 1,
+            },
+            .image_offset = {image_upload.offset.x, image_upload.offset.y, 0},
+            .image_extent = {static_cast<uint32_t>(image_upload.size.x), static_cast<uint32_t>(image_upload.size.y), 1},
+        });
+    }
+    for (auto const &[image_id, atlas_page] : upload_images) {
+        recorder.pipeline_barrier_image_transition({
+            .src_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .dst_access = daxa::AccessConsts::FRAGMENT_SHADER_READ,
+            .src_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .dst_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+            .image_slice = full_slice,
+            .image_id = image_id,
+        });
+        if (atlas_page) {
+            atlas_pages[*atlas_page].initialized = true;
         }
-        draw.actual_image = std::bit_cast<daxa::ImageId>(bound_texture);
     }
+    image_uploads.clear();
+}
 
-    draw_order.push_back(handle);
-    vertex_cache_offset += num_vertices;
-    index_cache_offset += num_indices;
+void RenderInterface_Daxa::push_draw_call(DrawCall draw_call, Rml::TextureHandle texture) {
+    draw_call.actual_texture = resolve_texture(texture);
+    draw_call.transform = transform;
+    if (scissor_enabled) {
+        draw_call.scissor = current_scissor;
+    }
+    draw_list.push(draw_call);
+
+    // Streamed draws hash their contents instead, their offsets are into
+    // this frame's staging memory.
+    hash_value(frame_signature, draw_call.streamed);
+    if (!draw_call.streamed) {
+        hash_value(frame_signature, draw_call.vertex_offset);
+        hash_value(frame_signature, draw_call.index_offset);
+    }
+    hash_value(frame_signature, draw_call.index_count);
+    hash_value(frame_signature, draw_call.actual_texture.image);
+    hash_value(frame_signature, draw_call.actual_texture.rect);
+    hash_value(frame_signature, draw_call.translation);
+    hash_bytes(frame_signature, draw_call.transform.data(), sizeof(float) * 16);
+    auto const scissor = draw_call.scissor.value_or(daxa::Rect2D{});
+    hash_value(frame_signature, draw_call.scissor.has_value());
+    hash_value(frame_signature, scissor.x);
+    hash_value(frame_signature, scissor.y);
+    hash_value(frame_signature, scissor.width);
+    hash_value(frame_signature, scissor.height);
 }
 
-void RenderInterface_Daxa::ReleaseCompiledGeometry(Rml::CompiledGeometryHandle handle) {
-    draws.at(handle - 1) = {};
-    draw_free_list.push(handle);
+auto RenderInterface_Daxa::stats() const -> RenderInterfaceStats {
+    auto result = last_frame_stats;
+    result.layer_redraw_count = layer_redraw_count;
+    result.frame_count = composited_frame_count;
+    return result;
+}
+
+auto RenderInterface_Daxa::buffer_allocation_count() const -> uint64_t {
+    return staging_ring.stats().buffer_allocation_count + arena_allocation_count;
 }
 
 void RenderInterface_Daxa::EnableScissorRegion(bool enable) {
@@ -470,48 +877,158 @@ void RenderInterface_Daxa::SetScissorRegion(int x, int y, int width, int height)
 }
 
 auto RenderInterface_Daxa::LoadTexture(Rml::TextureHandle &texture_handle, Rml::Vector2i &texture_dimensions, const Rml::String &source) -> bool {
+    auto error = std::error_code{};
+    auto const write_time = std::filesystem::last_write_time(source, error);
+    if (error) {
+        return false;
+    }
+
+    auto cache_iter = texture_cache.find(source);
+    if (cache_iter != texture_cache.end() && cache_iter->second.write_time == write_time) {
+        cache_iter->second.last_use = ++texture_cache_clock;
+        auto const &image = *cache_iter->second.image;
+        texture_handle = add_texture(create_texture(image.pixels.data(), image.size));
+        texture_dimensions = image.size;
+        return true;
+    }
+
+    // Only the header is read here, layout needs the size right away. The
+    // handle shows the default texture until the pixels are decoded.
     auto size_x = 0;
     auto size_y = 0;
-    stbi_set_flip_vertically_on_load(0);
-    auto image_data = stbi_load(source.c_str(), &size_x, &size_y, nullptr, 4);
-    if (!image_data || size_x == 0 || size_y == 0) {
+    if (stbi_info(source.c_str(), &size_x, &size_y, nullptr) == 0 || size_x == 0 || size_y == 0) {
         return false;
     }
-    auto result = GenerateTexture(texture_handle, reinterpret_cast<Rml::byte *>(image_data), {size_x, size_y});
-    stbi_image_free(image_data);
-    texture_dimensions.x = size_x;
-    texture_dimensions.y = size_y;
+    auto placeholder = textures[default_texture];
+    placeholder.pending_load_id = next_texture_load_id++;
+    texture_handle = add_texture(placeholder);
+    texture_dimensions = {size_x, size_y};
+
+    auto load = TextureLoad{
+        .handle = texture_handle,
+        .load_id = placeholder.pending_load_id,
+        .path = source,
+        .write_time = write_time,
+    };
+    thread_pool.submit(
+        [this, load = std::move(load)]() mutable {
+            auto size = Rml::Vector2i{};
+            auto *pixels = stbi_load(load.path.c_str(), &size.x, &size.y, nullptr, 4);
+            if (pixels != nullptr) {
+                auto image = std::make_shared<DecodedImage>();
+                image->pixels.assign(pixels, pixels + static_cast<size_t>(4) * static_cast<size_t>(size.x) * static_cast<size_t>(size.y));
+                image->size = size;
+                stbi_image_free(pixels);
+                load.image = std::move(image);
+            }
+            {
+                auto lock = std::lock_guard{finished_texture_loads_mutex};
+                finished_texture_loads.push_back(std::move(load));
+            }
+            if (on_texture_loaded) {
+                on_texture_loaded();
+            }
+        },
+        &texture_load_tasks);
+    return true;
+}
 
-    return result;
+void RenderInterface_Daxa::finish_texture_loads() {
+    auto loads = std::vector<TextureLoad>{};
+    {
+        auto lock = std::lock_guard{finished_texture_loads_mutex};
+        loads.swap(finished_texture_loads);
+    }
+    for (auto &load : loads) {
+        if (load.image == nullptr) {
+            std::cerr << "Failed to decode texture " << load.path << std::endl;
+            continue;
+        }
+        cache_texture(load.path, load.write_time, load.image);
+        // The handle may have been released, or even reused, in the meantime.
+        if (!textures.contains(load.handle) || textures[load.handle].pending_load_id != load.load_id) {
+            continue;
+        }
+        textures[load.handle] = create_texture(load.image->pixels.data(), load.image->size);
+    }
 }
 
-auto RenderInterface_Daxa::GenerateTexture(Rml::TextureHandle &texture_handle, const Rml::byte *source, const Rml::Vector2i &source_dimensions) -> bool {
-    auto image_id = device.create_image({
-        .format = daxa::Format::R8G8B8A8_SRGB,
-        .size = {static_cast<uint32_t>(source_dimensions.x), static_cast<uint32_t>(source_dimensions.y), 1},
-        .usage = daxa::ImageUsageFlagBits::TRANSFER_DST | daxa::ImageUsageFlagBits::SHADER_SAMPLED,
-        .name = "rml texture",
-    });
+void RenderInterface_Daxa::cache_texture(std::string const &path, std::filesystem::file_time_type write_time, std::shared_ptr<DecodedImage const> image) {
+    auto &entry = texture_cache[path];
+    if (entry.image != nullptr) {
+        texture_cache_bytes -= entry.image->pixels.size();
+    }
+    texture_cache_bytes += image->pixels.size();
+    entry = {.write_time = write_time, .image = std::move(image), .last_use = ++texture_cache_clock};
+    // Evicting by a scan is fine for the few images a UI loads. The newest
+    // entry stays, even if it alone is over the cap.
+    while (texture_cache_bytes > TEXTURE_CACHE_MAX_BYTES && texture_cache.size() > 1) {
+        auto oldest = std::min_element(texture_cache.begin(), texture_cache.end(), [](auto const &a, auto const &b) {
+            return a.second.last_use < b.second.last_use;
+        });
+        texture_cache_bytes -= oldest->second.image->pixels.size();
+        texture_cache.erase(oldest);
+    }
+}
 
-    auto prev_byte_count = image_upload_data.size();
+auto RenderInterface_Daxa::create_texture(Rml::byte const *source, Rml::Vector2i const &size) -> Texture {
+    auto const width = static_cast<uint32_t>(size.x);
+    auto const height = static_cast<uint32_t>(size.y);
+    auto texture = std::optional<Texture>{};
+    if (size.x <= ATLAS_MAX_ENTRY_SIZE && size.y <= ATLAS_MAX_ENTRY_SIZE) {
+        texture = allocate_atlas_entry(width, height);
+    }
+    if (!texture) {
+        texture = Texture{
+            .image = device.create_image({
+                .format = daxa::Format::R8G8B8A8_SRGB,
+                .size = {width, height, 1},
+                .usage = daxa::ImageUsageFlagBits::TRANSFER_DST | daxa::ImageUsageFlagBits::SHADER_SAMPLED,
+                .name = "rml texture",
+            }),
+        };
+    }
+
+    auto const byte_count = static_cast<size_t>(4) * width * height;
+    auto const staging = staging_ring.allocate(byte_count);
+    std::memcpy(staging.host_address, source, byte_count);
 
     image_uploads.push_back(ImageUpload{
-        .image_id = image_id,
-        .data = prev_byte_count,
-        .size = source_dimensions,
+        .image_id = texture->image,
+        .atlas_page = texture->atlas_page,
+        .staging = staging,
+        .offset = {static_cast<int32_t>(texture->rect.x), static_cast<int32_t>(texture->rect.y)},
+        .size = size,
     });
+    return *texture;
+}
 
-    auto const byte_count = static_cast<size_t>(4) * source_dimensions.x * source_dimensions.y;
-    image_upload_data.resize(prev_byte_count + byte_count);
-    auto in_bytes = std::span<Rml::byte const>{source, byte_count};
-    std::copy(in_bytes.begin(), in_bytes.end(), image_upload_data.begin() + prev_byte_count);
+auto RenderInterface_Daxa::add_texture(Texture const &texture) -> Rml::TextureHandle {
+    return textures.insert(texture);
+}
 
-    texture_handle = std::bit_cast<Rml::TextureHandle>(image_id);
+auto RenderInterface_Daxa::GenerateTexture(Rml::TextureHandle &texture_handle, const Rml::byte *source, const Rml::Vector2i &source_dimensions) -> bool {
+    texture_handle = add_texture(create_texture(source, source_dimensions));
     return true;
 }
 
 void RenderInterface_Daxa::ReleaseTexture(Rml::TextureHandle texture_handle) {
-    device.destroy_image(std::bit_cast<daxa::ImageId>(texture_handle));
+    auto const &texture = textures[texture_handle];
+    // A texture still waiting on its decode shows the default texture, which
+    // it does not own.
+    auto const owns_image = texture.pending_load_id == 0;
+    if (owns_image && texture.atlas_page) {
+        // Frames in flight may still sample the rect, so it is only reused
+        // once they are done.
+        retired_atlas_entries.push_back({
+            .atlas_page = *texture.atlas_page,
+            .rect = texture.rect,
+            .timeline_value = swapchain.current_cpu_timeline_value(),
+        });
+    } else if (owns_image) {
+        device.destroy_image(texture.image);
+    }
+    textures.erase(texture_handle);
 }
 
 void RenderInterface_Daxa::SetTransform(const Rml::Matrix4f *new_transform) {
@@ -6,18 +6,66 @@
 #include <daxa/command_recorder.hpp>
 #include <daxa/daxa.hpp>
 
+#include <core/allocation_counter.hpp>
+#include <core/atlas_allocator.hpp>
+#include <core/range_allocator.hpp>
+#include <core/slab.hpp>
+#include <core/thread_pool.hpp>
+#include <renderer/shader_cache.hpp>
+#include <renderer/staging_ring.hpp>
+#include <ui/rml/draw_list.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+struct RenderInterfaceStats {
+    // Geometry RmlUi asked to draw last frame, and the indirect draws that
+    // were actually issued for it.
+    uint32_t draw_count{};
+    uint32_t batch_count{};
+    // Heap allocations made while rendering last frame. Only counted in
+    // builds with GVOX_EDITOR_COUNT_ALLOCATIONS.
+    uint64_t heap_allocation_count{};
+    // Times the cached UI layer had to be redrawn, out of `frame_count`
+    // frames composited so far.
+    uint64_t layer_redraw_count{};
+    uint64_t frame_count{};
+};
+
 class RenderInterface_Daxa : public Rml::RenderInterface {
   public:
-    explicit RenderInterface_Daxa(daxa::Device device, daxa::Format format);
+    // `a_on_texture_loaded` is called from a pool thread whenever a texture
+    // finished decoding, so the main loop can wake up to show it.
+    explicit RenderInterface_Daxa(daxa::Device a_device, daxa::Swapchain a_swapchain, ThreadPool &a_thread_pool, std::function<void()> a_on_texture_loaded);
     ~RenderInterface_Daxa() override;
     RenderInterface_Daxa(const RenderInterface_Daxa &) = delete;
     RenderInterface_Daxa(RenderInterface_Daxa &&) = delete;
     auto operator=(const RenderInterface_Daxa &) -> RenderInterface_Daxa & = delete;
     auto operator=(RenderInterface_Daxa &&) -> RenderInterface_Daxa & = delete;
 
-    // Sets up OpenGL states for taking rendering commands from RmlUi.
+    // RmlUi's draws are rendered into a persistent layer image, which is then
+    // composited onto `target_image`. The layer is only redrawn when the
+    // draws RmlUi issued, or the geometry and textures they use, changed.
     void begin_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder);
     void end_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder);
+    // Composites the layer as the last frame left it, for frames in which
+    // RmlUi has nothing new to draw. Returns false, having recorded nothing,
+    // if there is no layer of the target's size yet or uploads are pending.
+    auto composite_cached_layer(daxa::ImageId target_image, daxa::CommandRecorder &recorder) -> bool;
+    // Whether textures finished decoding since the last `begin_frame`, and
+    // need a frame to show up.
+    auto has_finished_texture_loads() -> bool;
+
+    // GPU buffers created so far, including staging and arena growth. Stops
+    // changing once the UI reaches a steady state.
+    auto buffer_allocation_count() const -> uint64_t;
+    auto stats() const -> RenderInterfaceStats;
+    auto shader_cache_stats() const -> ShaderCacheStats { return shader_cache.stats(); }
 
     // -- Inherited from Rml::RenderInterface --
     void RenderGeometry(Rml::Vertex *vertices, int num_vertices, int *indices, int num_indices, Rml::TextureHandle texture, const Rml::Vector2f &translation) override;
@@ -32,41 +80,148 @@ class RenderInterface_Daxa : public Rml::RenderInterface {
     void SetTransform(const Rml::Matrix4f *transform) override;
 
     daxa::Device device;
+    daxa::Swapchain swapchain;
+    ThreadPool &thread_pool;
+    std::function<void()> const on_texture_loaded;
 
   private:
-    struct Draw {
-        std::vector<Rml::Vertex> vertices{};
-        std::vector<int> indices{};
+    static inline constexpr uint32_t ATLAS_PAGE_SIZE = 2048;
+    // Textures up to this size on both axes, which covers font glyph pages
+    // and icons, are packed into atlas pages instead of getting an image.
+    static inline constexpr int32_t ATLAS_MAX_ENTRY_SIZE = 512;
+    // Decoded pixels kept by `texture_cache`, past which the least recently
+    // loaded images are dropped.
+    static inline constexpr size_t TEXTURE_CACHE_MAX_BYTES = size_t{64} << 20;
+
+    // Device-local buffer that compiled geometry is sub-allocated from, in
+    // units of `element_size` bytes. Grows by reallocating and copying the
+    // old contents on the GPU. Its ranges are kept by the draw list.
+    struct GeometryArena {
+        daxa::BufferId buffer{};
+        RangeAllocator *allocator{};
+        size_t element_size{};
+        char const *name{};
+        // Buffer to copy into `buffer` before this frame's uploads.
+        daxa::BufferId migrate_from{};
+        size_t migrate_size{};
+    };
+    struct AtlasPage {
+        daxa::ImageId image{};
+        AtlasAllocator allocator{};
+        uint32_t entry_count{};
+        // False until an upload has taken the image out of the undefined
+        // layout. Later uploads must keep the other entries' texels.
+        bool initialized{};
+    };
+    // What a texture handle refers to. Atlas entries cover `rect` of an atlas
+    // page, other textures own their whole image.
+    struct Texture {
+        daxa::ImageId image{};
+        std::optional<uint32_t> atlas_page{};
+        AtlasRect rect{};
+        // Non-zero while the handle shows the default texture in place of an
+        // image that is still being decoded.
+        uint64_t pending_load_id{};
+    };
+    struct DecodedImage {
+        std::vector<Rml::byte> pixels{};
+        Rml::Vector2i size{};
+    };
+    struct TextureCacheEntry {
+        std::filesystem::file_time_type write_time{};
+        std::shared_ptr<DecodedImage const> image{};
+        // `texture_cache_clock` as of the last load that used the entry.
+        uint64_t last_use{};
+    };
+    struct TextureLoad {
+        Rml::TextureHandle handle{};
+        uint64_t load_id{};
+        std::string path{};
+        std::filesystem::file_time_type write_time{};
+        // Null if decoding failed.
+        std::shared_ptr<DecodedImage const> image{};
+    };
+    struct RetiredAtlasEntry {
+        uint32_t atlas_page{};
+        AtlasRect rect{};
+        uint64_t timeline_value{};
+    };
+    // One draw of this frame, with everything needed to record it.
+    struct DrawCall {
+        // Streamed draws read straight from their staging ring allocations,
+        // compiled ones from the arenas.
+        bool streamed{};
+        StagingAllocation stream_vertices{};
+        StagingAllocation stream_indices{};
         uint32_t vertex_offset{};
         uint32_t index_offset{};
-        Rml::TextureHandle texture{};
-        daxa::ImageId actual_image{};
+        uint32_t index_count{};
+        Texture actual_texture{};
         Rml::Vector2f translation{};
         Rml::Matrix4f transform{};
         std::optional<daxa::Rect2D> scissor{};
     };
+    // What consecutive draw calls share to be recorded as one multi-draw.
+    struct BatchKey {
+        daxa::BufferId index_buffer{};
+        Rml::Matrix4f transform{};
+        std::optional<daxa::Rect2D> scissor{};
+
+        auto operator==(BatchKey const &other) const -> bool;
+    };
+    struct GeometryUpload {
+        GeometryArena *arena{};
+        StagingAllocation staging{};
+        // In bytes.
+        size_t dst_offset{};
+        size_t size{};
+    };
     struct ImageUpload {
         daxa::ImageId image_id{};
-        size_t data{};
+        std::optional<uint32_t> atlas_page{};
+        StagingAllocation staging{};
+        Rml::Vector2i offset{};
         Rml::Vector2i size{};
     };
 
-    std::vector<Rml::CompiledGeometryHandle> draw_order{};
-    std::vector<Rml::CompiledGeometryHandle> deferred_draw_releases{};
-    std::vector<Draw> draws{};
-    size_t vertex_cache_offset{};
-    size_t index_cache_offset{};
-    std::vector<Rml::Vertex> vertex_cache{};
-    std::vector<int> index_cache{};
+    UiDrawList<DrawCall, BatchKey> draw_list{};
+    StagingAllocation draw_data_staging{};
+    StagingAllocation draw_command_staging{};
+    RenderInterfaceStats last_frame_stats{};
+    GeometryArena vertex_arena{};
+    GeometryArena index_arena{};
+    std::vector<GeometryUpload> geometry_uploads{};
+    uint64_t arena_allocation_count{};
     std::vector<ImageUpload> image_uploads{};
-    std::vector<Rml::byte> image_upload_data{};
-    std::stack<size_t> draw_free_list{};
+    Slab<Texture> textures{};
+    std::vector<AtlasPage> atlas_pages{};
+    std::vector<RetiredAtlasEntry> retired_atlas_entries{};
+    std::vector<std::pair<daxa::ImageId, std::optional<uint32_t>>> upload_images{};
+
+    daxa::ImageId layer_image{};
+    uint32_t layer_width{};
+    uint32_t layer_height{};
+    // Hash of the draws the layer holds, and of the ones issued this frame.
+    std::optional<uint64_t> layer_signature{};
+    uint64_t frame_signature{};
+    uint64_t layer_redraw_count{};
+    uint64_t composited_frame_count{};
+
+    // Decoded images by path, valid while the file's write time matches.
+    std::unordered_map<std::string, TextureCacheEntry> texture_cache{};
+    size_t texture_cache_bytes{};
+    uint64_t texture_cache_clock{};
+    ThreadPool::TaskGroup texture_load_tasks{};
+    std::mutex finished_texture_loads_mutex{};
+    std::vector<TextureLoad> finished_texture_loads{};
+    uint64_t next_texture_load_id = 1;
+    StagingRing staging_ring;
 
+    ShaderCache shader_cache;
     daxa::PipelineManager pipeline_manager{};
     std::shared_ptr<daxa::RasterPipeline> raster_pipeline{};
-    daxa::BufferId vbuffer{};
-    daxa::BufferId ibuffer{};
-    daxa::ImageId default_texture{};
+    std::shared_ptr<daxa::RasterPipeline> composite_pipeline{};
+    Rml::TextureHandle default_texture{};
     daxa::SamplerId default_sampler{};
     Rml::TextureHandle bound_texture{};
     daxa::Rect2D current_scissor{};
@@ -76,6 +231,21 @@ class RenderInterface_Daxa : public Rml::RenderInterface {
     Rml::Matrix4f transform{};
     bool transform_enabled = false;
 
-    void recreate_vbuffer(size_t vbuffer_new_size);
-    void recreate_ibuffer(size_t ibuffer_new_size);
+    void create_arena(GeometryArena &arena, RangeAllocator &allocator, size_t element_size, uint32_t capacity, char const *name);
+    auto arena_allocate(GeometryArena &arena, void const *data, uint32_t count) -> uint32_t;
+    void record_geometry_uploads(daxa::CommandRecorder &recorder);
+    auto resolve_texture(Rml::TextureHandle texture) -> Texture;
+    auto allocate_atlas_entry(uint32_t width, uint32_t height) -> std::optional<Texture>;
+    void reclaim_retired_atlas_entries(uint64_t completed_timeline_value);
+    void record_image_uploads(daxa::CommandRecorder &recorder);
+    auto create_texture(Rml::byte const *source, Rml::Vector2i const &size) -> Texture;
+    auto add_texture(Texture const &texture) -> Rml::TextureHandle;
+    void finish_texture_loads();
+    void cache_texture(std::string const &path, std::filesystem::file_time_type write_time, std::shared_ptr<DecodedImage const> image);
+    void reclaim_completed_frames();
+    void record_frame(daxa::ImageId target_image, daxa::CommandRecorder &recorder);
+    void build_batches();
+    void record_layer(daxa::CommandRecorder &recorder);
+    void record_composite(daxa::ImageId target_image, daxa::CommandRecorder &recorder);
+    void push_draw_call(DrawCall draw_call, Rml::TextureHandle texture);
 };
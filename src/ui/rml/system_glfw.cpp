@@ -76,18 +76,47 @@ void SystemInterface_GLFW::SetMouseCursor(const Rml::String &cursor_name) {
     else if (Rml::StringUtilities::StartsWith(cursor_name, "rmlui-scroll"))
         cursor = cursor_pointer;
 
-    if (window)
-        glfwSetCursor(window, cursor);
+    if (requested_cursor.exchange(cursor) != cursor)
+        glfwPostEmptyEvent();
 }
 
 void SystemInterface_GLFW::SetClipboardText(const Rml::String &text_utf8) {
-    if (window)
-        glfwSetClipboardString(window, text_utf8.c_str());
+    {
+        auto lock = std::lock_guard{clipboard_mutex};
+        clipboard_text = text_utf8;
+        pending_clipboard_text = text_utf8;
+    }
+    glfwPostEmptyEvent();
 }
 
 void SystemInterface_GLFW::GetClipboardText(Rml::String &text) {
-    if (window)
-        text = Rml::String(glfwGetClipboardString(window));
+    auto lock = std::lock_guard{clipboard_mutex};
+    text = clipboard_text;
+}
+
+void SystemInterface_GLFW::apply_requests() {
+    if (!window)
+        return;
+    auto *const cursor = requested_cursor.load();
+    if (cursor != applied_cursor) {
+        glfwSetCursor(window, cursor);
+        applied_cursor = cursor;
+    }
+    auto text = std::optional<Rml::String>{};
+    {
+        auto lock = std::lock_guard{clipboard_mutex};
+        text.swap(pending_clipboard_text);
+    }
+    if (text)
+        glfwSetClipboardString(window, text->c_str());
+}
+
+void SystemInterface_GLFW::refresh_clipboard() {
+    if (!window)
+        return;
+    auto const *text = glfwGetClipboardString(window);
+    auto lock = std::lock_guard{clipboard_mutex};
+    clipboard_text = text != nullptr ? Rml::String(text) : Rml::String();
 }
 
 auto RmlGLFW::ProcessKeyCallback(Rml::Context *context, int key, int action, int mods) -> bool {
@@ -126,23 +155,27 @@ auto RmlGLFW::ProcessCursorEnterCallback(Rml::Context *context, int entered) ->
     return result;
 }
 
-auto RmlGLFW::ProcessCursorPosCallback(Rml::Context *context, GLFWwindow *window, double xpos, double ypos, int mods) -> bool {
+auto RmlGLFW::ProcessCursorPosCallback(Rml::Context *context, Rml::Vector2i mouse_pos, int mods) -> bool {
     if (!context)
         return true;
 
+    bool result = context->ProcessMouseMove(mouse_pos.x, mouse_pos.y, RmlGLFW::ConvertKeyModifiers(mods));
+    return result;
+}
+
+auto RmlGLFW::ConvertCursorPos(GLFWwindow *window, double xpos, double ypos) -> Rml::Vector2i {
     using Rml::Vector2i;
     using Vector2d = Rml::Vector2<double>;
 
     Vector2i window_size, framebuffer_size;
     glfwGetWindowSize(window, &window_size.x, &window_size.y);
     glfwGetFramebufferSize(window, &framebuffer_size.x, &framebuffer_size.y);
+    if (window_size.x == 0 || window_size.y == 0)
+        return {};
 
     // Convert from mouse position in GLFW screen coordinates to framebuffer coordinates (pixels) used by RmlUi.
     const Vector2d mouse_pos = Vector2d(xpos, ypos) * (Vector2d(framebuffer_size) / Vector2d(window_size));
-    const Vector2i mouse_pos_round = {int(std::round(mouse_pos.x)), int(std::round(mouse_pos.y))};
-
-    bool result = context->ProcessMouseMove(mouse_pos_round.x, mouse_pos_round.y, RmlGLFW::ConvertKeyModifiers(mods));
-    return result;
+    return {int(std::round(mouse_pos.x)), int(std::round(mouse_pos.y))};
 }
 
 auto RmlGLFW::ProcessMouseButtonCallback(Rml::Context *context, int button, int action, int mods) -> bool {
@@ -5,6 +5,14 @@
 #include <RmlUi/Core/Types.h>
 #include <GLFW/glfw3.h>
 
+#include <atomic>
+#include <mutex>
+#include <optional>
+
+// RmlUi calls into this from the render thread, but GLFW's cursor and
+// clipboard functions may only be called on the main thread. Requests are
+// kept here and carried out by `apply_requests` on the main thread, and the
+// clipboard is read ahead of time by `refresh_clipboard`.
 class SystemInterface_GLFW : public Rml::SystemInterface {
   public:
     SystemInterface_GLFW();
@@ -26,9 +34,19 @@ class SystemInterface_GLFW : public Rml::SystemInterface {
     void SetClipboardText(const Rml::String &text) override;
     void GetClipboardText(Rml::String &text) override;
 
+    // Main thread only.
+    void apply_requests();
+    void refresh_clipboard();
+
   private:
     GLFWwindow *window = nullptr;
 
+    std::atomic<GLFWcursor *> requested_cursor{};
+    GLFWcursor *applied_cursor = nullptr;
+    std::mutex clipboard_mutex{};
+    Rml::String clipboard_text{};
+    std::optional<Rml::String> pending_clipboard_text{};
+
     GLFWcursor *cursor_pointer = nullptr;
     GLFWcursor *cursor_cross = nullptr;
     GLFWcursor *cursor_text = nullptr;
@@ -44,12 +62,16 @@ namespace RmlGLFW {
     auto ProcessKeyCallback(Rml::Context *context, int key, int action, int mods) -> bool;
     auto ProcessCharCallback(Rml::Context *context, unsigned int codepoint) -> bool;
     auto ProcessCursorEnterCallback(Rml::Context *context, int entered) -> bool;
-    auto ProcessCursorPosCallback(Rml::Context *context, GLFWwindow *window, double xpos, double ypos, int mods) -> bool;
+    auto ProcessCursorPosCallback(Rml::Context *context, Rml::Vector2i mouse_pos, int mods) -> bool;
     auto ProcessMouseButtonCallback(Rml::Context *context, int button, int action, int mods) -> bool;
     auto ProcessScrollCallback(Rml::Context *context, double yoffset, int mods) -> bool;
     void ProcessFramebufferSizeCallback(Rml::Context *context, int width, int height);
     void ProcessContentScaleCallback(Rml::Context *context, float xscale);
 
+    // Converts a cursor position from GLFW screen coordinates to the framebuffer
+    // pixels RmlUi uses. Main thread only.
+    auto ConvertCursorPos(GLFWwindow *window, double xpos, double ypos) -> Rml::Vector2i;
+
     // Converts the GLFW key to RmlUi key.
     auto ConvertKey(int glfw_key) -> Rml::Input::KeyIdentifier;
 